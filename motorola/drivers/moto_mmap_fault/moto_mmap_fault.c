@@ -15,11 +15,123 @@
 #include <trace/hooks/mm.h>
 #include <linux/pagemap.h>
 #include <linux/version.h>
+#include <linux/hash.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 static int max_ra_pages = -1;
 module_param(max_ra_pages, int, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(max_ra_pages, "Max read ahead pages");
 
+static bool adaptive_ra = true;
+module_param(adaptive_ra, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(adaptive_ra, "Adapt the read around window per file");
+
+#define MMAP_RA_TABLE_BITS	8
+#define MMAP_RA_MIN_PAGES	4
+
+/*
+ * Read around state of one address_space. The table is direct mapped and
+ * tagged with the mapping and inode number, so a recycled mapping or a
+ * collision simply restarts learning from max_ra_pages.
+ */
+struct mmap_ra_state {
+	spinlock_t lock;
+	struct address_space *mapping;
+	unsigned long ino;
+	pgoff_t start;
+	unsigned int size;
+	unsigned int window;
+	unsigned long hit;
+	unsigned long miss;
+};
+
+static struct mmap_ra_state mmap_ra_table[1 << MMAP_RA_TABLE_BITS];
+static atomic_long_t mmap_ra_faults;
+static atomic_long_t mmap_ra_grow;
+static atomic_long_t mmap_ra_shrink;
+static atomic_long_t mmap_ra_evict;
+static struct dentry *mmap_ra_debugfs;
+
+/*
+ * Pick the read around window for a fault at @pgoff. A fault that lands
+ * right behind the previous window means that window was consumed, so it
+ * doubles; a fault anywhere else means the read around was wasted, so it
+ * halves. The window is bounded by MMAP_RA_MIN_PAGES and @max_window.
+ */
+static unsigned int mmap_ra_window(struct address_space *mapping,
+		pgoff_t pgoff, unsigned int max_window)
+{
+	struct mmap_ra_state *st;
+	unsigned long ino = mapping->host ? mapping->host->i_ino : 0;
+	unsigned int window;
+
+	atomic_long_inc(&mmap_ra_faults);
+	if (!adaptive_ra || max_window <= MMAP_RA_MIN_PAGES)
+		return min_t(unsigned int, max_ra_pages, max_window);
+
+	st = &mmap_ra_table[hash_ptr(mapping, MMAP_RA_TABLE_BITS)];
+	spin_lock(&st->lock);
+	if (st->mapping != mapping || st->ino != ino) {
+		if (st->mapping)
+			atomic_long_inc(&mmap_ra_evict);
+		st->mapping = mapping;
+		st->ino = ino;
+		st->size = 0;
+		st->window = max_ra_pages;
+		st->hit = 0;
+		st->miss = 0;
+	} else if (st->size) {
+		if (pgoff >= st->start + st->size &&
+				pgoff < st->start + 2 * st->size) {
+			st->hit++;
+			if (st->window < max_window) {
+				st->window <<= 1;
+				atomic_long_inc(&mmap_ra_grow);
+			}
+		} else if (pgoff < st->start || pgoff >= st->start + st->size) {
+			st->miss++;
+			if (st->window > MMAP_RA_MIN_PAGES) {
+				st->window >>= 1;
+				atomic_long_inc(&mmap_ra_shrink);
+			}
+		}
+	}
+
+	window = clamp_t(unsigned int, st->window, MMAP_RA_MIN_PAGES, max_window);
+	st->start = max_t(long, 0, pgoff - window / 2);
+	st->size = window;
+	spin_unlock(&st->lock);
+
+	return window;
+}
+
+static int mmap_ra_stats_show(struct seq_file *m, void *v)
+{
+	struct mmap_ra_state *st;
+	int i;
+
+	seq_printf(m, "adaptive_ra: %d\n", adaptive_ra);
+	seq_printf(m, "max_ra_pages: %d\n", max_ra_pages);
+	seq_printf(m, "faults: %ld\n", atomic_long_read(&mmap_ra_faults));
+	seq_printf(m, "grow: %ld\n", atomic_long_read(&mmap_ra_grow));
+	seq_printf(m, "shrink: %ld\n", atomic_long_read(&mmap_ra_shrink));
+	seq_printf(m, "evict: %ld\n", atomic_long_read(&mmap_ra_evict));
+	seq_puts(m, "ino window hit miss\n");
+
+	for (i = 0; i < ARRAY_SIZE(mmap_ra_table); i++) {
+		st = &mmap_ra_table[i];
+		spin_lock(&st->lock);
+		if (st->mapping)
+			seq_printf(m, "%lu %u %lu %lu\n", st->ino,
+					st->window, st->hit, st->miss);
+		spin_unlock(&st->lock);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mmap_ra_stats);
+
 #if LINUX_VERSION_CODE > KERNEL_VERSION(5, 15, 104) || (LINUX_VERSION_CODE > KERNEL_VERSION(5, 10, 177) && LINUX_VERSION_CODE < KERNEL_VERSION(5, 15, 0))
 #ifndef TUNE_MMAP_READAROUND
 #define TUNE_MMAP_READAROUND
@@ -30,9 +142,29 @@ MODULE_PARM_DESC(max_ra_pages, "Max read ahead pages");
 static void __nocfi tune_mmap_readaround(void *p, unsigned int ra_pages, pgoff_t pgoff,
 		pgoff_t *start, unsigned int *size, unsigned int *async_size)
 {
-	*start = max_t(long, 0, pgoff - max_ra_pages / 2);
-	*size = max_ra_pages;
-	*async_size = max_ra_pages / 4;
+	/*
+	 * The only caller is trace_android_vh_tune_mmap_readaround() in
+	 * do_sync_mmap_readahead() (mm/filemap.c), which passes the start,
+	 * size and async_size fields of ra = &file->f_ra of the faulting
+	 * file. Check the three pointers belong to one file_ra_state before
+	 * walking back to the file, and leave the window alone otherwise.
+	 */
+	struct file_ra_state *ra = container_of(start, struct file_ra_state, start);
+	struct file *file;
+	unsigned int window;
+
+	if (size != &ra->size || async_size != &ra->async_size)
+		return;
+
+	file = container_of(ra, struct file, f_ra);
+	if (!file->f_mapping)
+		return;
+
+	window = mmap_ra_window(file->f_mapping, pgoff,
+			max_t(unsigned int, ra_pages, max_ra_pages));
+	*start = max_t(long, 0, pgoff - window / 2);
+	*size = window;
+	*async_size = window / 4;
 	return;
 }
 #else
@@ -45,6 +177,7 @@ static void __nocfi filemap_fault_get_page(void *p, struct vm_fault *vmf, struct
 	struct address_space *mapping = NULL;
 	unsigned int mmap_miss;
 	unsigned int old_ra_pages = 0;
+	unsigned int window;
 
 	if (!file)
 		return;
@@ -67,10 +200,11 @@ static void __nocfi filemap_fault_get_page(void *p, struct vm_fault *vmf, struct
 			return;
 		} else {
 			old_ra_pages = ra->ra_pages;
-			if (ra->ra_pages > max_ra_pages) {
-				ra->ra_pages = max_ra_pages; // reduce the read ahead limit to 8 pages
+			window = mmap_ra_window(mapping, offset, ra->ra_pages);
+			if (ra->ra_pages > window) {
+				ra->ra_pages = window; // reduce the read ahead limit
 				vmf->android_oem_data1[0] = old_ra_pages;
-				vmf->android_oem_data1[1] = max_ra_pages;
+				vmf->android_oem_data1[1] = window;
 			}
 			return;
 		}
@@ -93,8 +227,8 @@ static void __nocfi filemap_fault_cache_page(void *p, struct vm_fault *vmf, stru
 	if(!ra)
 		return;
 
-	if ((ra->ra_pages == max_ra_pages) && (vmf->android_oem_data1[0] != 0)
-			&& (vmf->android_oem_data1[1] == max_ra_pages)) {
+	if ((vmf->android_oem_data1[0] != 0)
+			&& (ra->ra_pages == vmf->android_oem_data1[1])) {
 			ra->ra_pages = (unsigned int)vmf->android_oem_data1[0]; //restore the old ra_pages
 			vmf->android_oem_data1[0] = 0;
 			vmf->android_oem_data1[1] = 0;
@@ -106,6 +240,7 @@ static int __nocfi __init moto_mmap_fault_init(void)
 {
 	int ret = 0;
 	int ramsize_GB = (totalram_pages() >> (30 - PAGE_SHIFT)) + 1;
+	int i;
 
 	if (max_ra_pages == -1) {
 		/* Set 8 pages for < 8G RAM and set 16 pages for >= 8G RAM */
@@ -115,6 +250,9 @@ static int __nocfi __init moto_mmap_fault_init(void)
 			max_ra_pages = 16;
 	}
 
+	for (i = 0; i < ARRAY_SIZE(mmap_ra_table); i++)
+		spin_lock_init(&mmap_ra_table[i].lock);
+
 #if defined(TUNE_MMAP_READAROUND)
 	pr_info("Using the new mmap fault driver, totalram size=%dGB", ramsize_GB);
 	ret = register_trace_android_vh_tune_mmap_readaround(tune_mmap_readaround, NULL);
@@ -125,11 +263,16 @@ static int __nocfi __init moto_mmap_fault_init(void)
 #endif
 	if (ret != 0)
 		return -ENXIO;
-	else
-		return 0;
+
+	mmap_ra_debugfs = debugfs_create_dir("moto_mmap_fault", NULL);
+	debugfs_create_file("stats", 0444, mmap_ra_debugfs, NULL,
+			&mmap_ra_stats_fops);
+
+	return 0;
 }
 static void __nocfi __exit moto_mmap_fault_exit(void)
 {
+	debugfs_remove_recursive(mmap_ra_debugfs);
 #if defined(TUNE_MMAP_READAROUND)
 	unregister_trace_android_vh_tune_mmap_readaround(tune_mmap_readaround, NULL);
 #else
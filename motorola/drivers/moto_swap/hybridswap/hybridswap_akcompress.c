@@ -10,6 +10,8 @@
 #include <linux/atomic.h>
 #include <linux/idr.h>
 #include <linux/freezer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #ifdef CONFIG_ZRAM_5_4
 #include "../zram-5.4/zram_drv.h"
@@ -47,6 +49,10 @@ static struct task_struct *akc_task[MAX_AKCOMPRESSD_THREADS];
 static atomic64_t akc_cnt[MAX_AKCOMPRESSD_THREADS];
 static int akcompressd_threads = 0;
 static atomic64_t cached_cnt;
+static atomic64_t akc_batch_cnt;
+static atomic64_t akc_batch_pages;
+static atomic64_t akc_batch_ns;
+static atomic64_t akc_batch_max_ns;
 static struct zram *zram_info;
 static DEFINE_MUTEX(akcompress_init_lock);
 
@@ -263,6 +269,62 @@ try_again:
 	return page;
 }
 
+static int fetch_anon_pages(struct zram *zram,
+		struct cgroup_cache_page *cache, struct page **pages)
+{
+	int nr = 0;
+
+	while (nr < ASYNC_COMPRESS_BATCH) {
+		pages[nr] = fetch_anon_page(zram, cache);
+		if (!pages[nr])
+			break;
+		nr++;
+	}
+
+	return nr;
+}
+
+static void akcompress_batch_account(int nr, u64 ns)
+{
+	u64 max = atomic64_read(&akc_batch_max_ns);
+
+	atomic64_inc(&akc_batch_cnt);
+	atomic64_add(nr, &akc_batch_pages);
+	atomic64_add(ns, &akc_batch_ns);
+	while (ns > max) {
+		u64 old = atomic64_cmpxchg(&akc_batch_max_ns, max, ns);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+int akcompress_batch_stat_show(char *buf, int size)
+{
+	u64 batches = atomic64_read(&akc_batch_cnt);
+	u64 pages = atomic64_read(&akc_batch_pages);
+	u64 ns = atomic64_read(&akc_batch_ns);
+	u64 avg_us = batches ? div64_u64(ns, batches * NSEC_PER_USEC) : 0;
+	u64 mbps = ns ? mul_u64_u64_div_u64(pages << PAGE_SHIFT,
+			NSEC_PER_SEC, ns) >> 20 : 0;
+	int len = 0;
+
+	len += scnprintf(buf + len, size - len, "%-32s %12llu\n",
+			"akcompress_batches", batches);
+	len += scnprintf(buf + len, size - len, "%-32s %12llu\n",
+			"akcompress_batch_pages", pages);
+	len += scnprintf(buf + len, size - len, "%-32s %12llu\n",
+			"akcompress_batch_avg_us", avg_us);
+	len += scnprintf(buf + len, size - len, "%-32s %12llu\n",
+			"akcompress_batch_max_us",
+			div64_u64(atomic64_read(&akc_batch_max_ns), NSEC_PER_USEC));
+	len += scnprintf(buf + len, size - len, "%-32s %12llu\n",
+			"akcompress_throughput_mbps", mbps);
+
+	return len;
+}
+
 int add_anon_page2cache(struct zram * zram, u32 index, struct page *page)
 {
 	struct page *dst_page;
@@ -321,8 +383,10 @@ static inline void akcompressd_try_to_sleep(wait_queue_head_t *waitq)
 
 static int akcompressd_func(void *data)
 {
-	struct page *page;
-	int ret, thread_index;
+	struct page *pages[ASYNC_COMPRESS_BATCH];
+	int rets[ASYNC_COMPRESS_BATCH];
+	int i, nr, stored, thread_index;
+	ktime_t start;
 	struct list_head compress_fail_list;
 	struct cgroup_cache_page *cache = NULL;
 
@@ -343,19 +407,22 @@ static int akcompressd_func(void *data)
 
 finish_last_jobs:
 		INIT_LIST_HEAD(&compress_fail_list);
-		page = fetch_anon_page(zram_info, cache);
-		while (page) {
-			ret = async_compress_page(zram_info, page);
-			put_memcg_cache(container_of(cache, memcg_hybs_t, cache));
-
-			if (ret)
-				list_add(&page->lru, &compress_fail_list);
-			else {
-				atomic64_inc(&akc_cnt[thread_index]);
-				page->mem_cgroup = NULL;
-				put_free_page(page);
+		while ((nr = fetch_anon_pages(zram_info, cache, pages)) > 0) {
+			start = ktime_get();
+			stored = async_compress_pages(zram_info, pages, rets, nr);
+			akcompress_batch_account(nr,
+				ktime_to_ns(ktime_sub(ktime_get(), start)));
+			atomic64_add(stored, &akc_cnt[thread_index]);
+
+			for (i = 0; i < nr; i++) {
+				put_memcg_cache(container_of(cache, memcg_hybs_t, cache));
+				if (rets[i])
+					list_add(&pages[i]->lru, &compress_fail_list);
+				else {
+					pages[i]->mem_cgroup = NULL;
+					put_free_page(pages[i]);
+				}
 			}
-			page = fetch_anon_page(zram_info, cache);
 		}
 
 		if (!list_empty(&compress_fail_list))
@@ -515,6 +582,10 @@ void __init akcompressd_pre_init(void)
 	init_waitqueue_head(&akcompressd_wait);
 
 	atomic64_set(&cached_cnt, 0);
+	atomic64_set(&akc_batch_cnt, 0);
+	atomic64_set(&akc_batch_pages, 0);
+	atomic64_set(&akc_batch_ns, 0);
+	atomic64_set(&akc_batch_max_ns, 0);
 	for (i = 0; i < MAX_AKCOMPRESSD_THREADS; i++)
 		atomic64_set(&akc_cnt[i], 0);
 
@@ -24,6 +24,7 @@
 #elif defined CONFIG_ZRAM_5_15
 #include "../zram-5.15/zram_drv.h"
 #include "../zram-5.15/zram_drv_internal.h"
+#include "../zram-5.15/zram_dedup.h"
 #define BIO_MAX_PAGES BIO_MAX_VECS
 #define MEMCG_OEM_DATA(memcg) ((memcg)->android_oem_data1[0])
 #else
@@ -603,6 +604,17 @@ static inline ssize_t meminfo_show(struct hybstatus *stat, char *buf, ssize_t le
 	return size;
 }
 
+/* percentage of pages brought in with an extent that were read later */
+static u64 hybridswap_prefetch_hit_rate(struct hybstatus *stat)
+{
+	u64 pages = atomic64_read(&stat->prefetch_pages);
+
+	if (!pages)
+		return 0;
+
+	return div64_u64(atomic64_read(&stat->prefetch_hit) * 100, pages);
+}
+
 ssize_t hybridswap_stat_snap_show(struct device *dev,
 	struct device_attribute *attr, char *buf)
 {
@@ -644,6 +656,12 @@ ssize_t hybridswap_stat_snap_show(struct device *dev,
 		"fault_cnt:", atomic64_read(&stat->fault_cnt));
 	size += scnprintf(buf + size, PAGE_SIZE - size, "%-32s %12llu\n",
 		"hybridswap_fault_cnt:", atomic64_read(&stat->hybridswap_fault_cnt));
+	size += scnprintf(buf + size, PAGE_SIZE - size, "%-32s %12llu\n",
+		"prefetch_pages:", atomic64_read(&stat->prefetch_pages));
+	size += scnprintf(buf + size, PAGE_SIZE - size, "%-32s %12llu\n",
+		"prefetch_hit:", atomic64_read(&stat->prefetch_hit));
+	size += scnprintf(buf + size, PAGE_SIZE - size, "%-32s %12llu\n",
+		"prefetch_hit_rate:", hybridswap_prefetch_hit_rate(stat));
 	size += scnprintf(buf + size, PAGE_SIZE - size, "%-32s %12llu KB\n",
 		"reout_pages:", atomic64_read(&stat->reout_pages) * PAGE_SIZE / SZ_1K);
 	size += scnprintf(buf + size, PAGE_SIZE - size, "%-32s %12llu KB\n",
@@ -1914,9 +1932,18 @@ static void move_to_hybridswap(struct zram *zram, u32 index,
 	size = zram_get_obj_size(zram, index);
 
 	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+	zram_clear_flag(zram, index, ZRAM_PREFETCHED);
 
-	zs_free(zram->mem_pool, zram_get_handle(zram, index));
-	atomic64_sub(size, &zram->stats.compr_data_size);
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	/* a shared object stays in zram for the other slots */
+	if (zram_test_flag(zram, index, ZRAM_DEDUP))
+		zram_dedup_release(zram, index);
+	else
+#endif
+	{
+		zs_free(zram->mem_pool, zram_get_handle(zram, index));
+		atomic64_sub(size, &zram->stats.compr_data_size);
+	}
 	atomic64_dec(&zram->stats.pages_stored);
 
 	zram_set_mcg(zram, index, mcg->id.id);
@@ -1960,6 +1987,9 @@ static void __move_to_zram(struct zram *zram, u32 index, unsigned long handle,
 	if (mcg)
 		swap_sorted_list_add(zram, index, mcg);
 	zram_set_flag(zram, index, ZRAM_FROM_HYBRIDSWAP);
+	/* a faulting slot is BATCHING_OUT, everything else came along */
+	if (!zram_test_flag(zram, index, ZRAM_BATCHING_OUT))
+		zram_set_flag(zram, index, ZRAM_PREFETCHED);
 	atomic64_add(size, &zram->stats.compr_data_size);
 	atomic64_inc(&zram->stats.pages_stored);
 	zram_clear_flag(zram, index, ZRAM_IN_BD);
@@ -2078,6 +2108,25 @@ out:
 	return real_load;
 }
 
+/*
+ * A fault reads the whole extent holding the object, so every other
+ * object in it lands in zram ahead of its own fault. Batch and preload
+ * swap-in bring the whole extent in speculatively.
+ */
+static void hybridswap_prefetch_account(int cnt,
+		enum hybridswap_class class)
+{
+	struct hybstatus *stat = hybridswap_fetch_stat_obj();
+
+	if (unlikely(!stat))
+		return;
+
+	if (class == HYB_FAULT_OUT)
+		cnt--;
+	if (cnt > 0)
+		atomic64_add(cnt, &stat->prefetch_pages);
+}
+
 static void eswap_add(struct io_eswapent *io_eswap,
 		       enum hybridswap_class class)
 {
@@ -2116,6 +2165,7 @@ static void eswap_add(struct io_eswapent *io_eswap,
 			goto out;
 	}
 	hybp(HYB_DEBUG, "eswap add OK, free eswapid = %d.\n", eswapid);
+	hybridswap_prefetch_account(io_eswap->cnt, class);
 	hybridswap_free_eswap(zram->infos, io_eswap->eswapid);
 	io_eswap->eswapid = -EINVAL;
 	if (mcg) {
@@ -2441,6 +2491,7 @@ void hybridswap_swap_sorted_list_del(struct zram *zram, u32 index)
 	}
 
 	zram_clear_flag(zram, index, ZRAM_FROM_HYBRIDSWAP);
+	zram_clear_flag(zram, index, ZRAM_PREFETCHED);
 	if (zram_test_flag(zram, index, ZRAM_MCGID_CLEAR)) {
 		zram_clear_flag(zram, index, ZRAM_MCGID_CLEAR);
 		atomic64_dec(&stat->memcgid_clear);
@@ -4209,6 +4260,8 @@ void hybstatus_init(struct hybstatus *stat)
 	atomic64_set(&stat->batchout_inflight, 0);
 	atomic64_set(&stat->fault_cnt, 0);
 	atomic64_set(&stat->hybridswap_fault_cnt, 0);
+	atomic64_set(&stat->prefetch_pages, 0);
+	atomic64_set(&stat->prefetch_hit, 0);
 	atomic64_set(&stat->reout_pages, 0);
 	atomic64_set(&stat->reout_bytes, 0);
 	atomic64_set(&stat->zram_stored_pages, 0);
@@ -5228,6 +5281,47 @@ int hybridswap_batches(struct mem_cgroup *mcg,
 	return ret;
 }
 
+static void hybridswap_batches_work(struct work_struct *work)
+{
+	struct async_req *rq = container_of(work, struct async_req, work);
+	int old_nice = task_nice(current);
+
+	set_user_nice(current, rq->nice);
+	hybridswap_batches(rq->mcg, rq->size, rq->preload);
+	set_user_nice(current, old_nice);
+	css_put(&rq->mcg->css);
+	hybridswap_free(rq);
+}
+
+/*
+ * Queue a memcg wide swap-in so the caller, usually the framework moving
+ * an app to the foreground, does not wait for the extents to be read.
+ */
+int hybridswap_batches_async(struct mem_cgroup *mcg, unsigned long size)
+{
+	struct async_req *rq = NULL;
+
+	if (!hybridswap_core_enabled() || !mcg || !size)
+		return 0;
+
+	rq = hybridswap_malloc(sizeof(struct async_req), false, true);
+	if (unlikely(!rq)) {
+		hybp(HYB_ERR, "alloc async req fail!\n");
+		hybstatus_alloc_fail(HYB_PRE_OUT, -ENOMEM);
+		return -ENOMEM;
+	}
+
+	css_get(&mcg->css);
+	rq->mcg = mcg;
+	rq->size = size;
+	rq->preload = true;
+	rq->nice = task_nice(current);
+	INIT_WORK(&rq->work, hybridswap_batches_work);
+	queue_work(hybridswap_fetch_reclaim_workqueue(), &rq->work);
+
+	return 0;
+}
+
 static void hybridswap_fault_stat(struct zram *zram, u32 index)
 {
 	struct mem_cgroup *mcg = NULL;
@@ -5258,6 +5352,14 @@ static void hybridswap_fault2_stat(struct zram *zram, u32 index)
 		atomic64_inc(&MEMCGRP_ITEM(mcg, hybridswap_faultcnt));
 }
 
+static void hybridswap_prefetch_hit_stat(void)
+{
+	struct hybstatus *stat = hybridswap_fetch_stat_obj();
+
+	if (likely(stat))
+		atomic64_inc(&stat->prefetch_hit);
+}
+
 static bool hybridswap_page_fault_check(struct zram *zram,
 		u32 index, unsigned long *zentry)
 {
@@ -5266,8 +5368,14 @@ static bool hybridswap_page_fault_check(struct zram *zram,
 
 	hybridswap_fault_stat(zram, index);
 
-	if (!zram_test_flag(zram, index, ZRAM_WB))
+	if (!zram_test_flag(zram, index, ZRAM_WB)) {
+		/* only the first access to a prefetched object is a hit */
+		if (zram_test_flag(zram, index, ZRAM_PREFETCHED)) {
+			zram_clear_flag(zram, index, ZRAM_PREFETCHED);
+			hybridswap_prefetch_hit_stat();
+		}
 		return false;
+	}
 
 	zram_set_flag(zram, index, ZRAM_BATCHING_OUT);
 	*zentry = zram_get_handle(zram, index);
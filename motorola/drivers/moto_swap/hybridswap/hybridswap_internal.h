@@ -166,6 +166,8 @@ struct hybstatus {
 	atomic64_t batchout_inflight;
 	atomic64_t fault_cnt;
 	atomic64_t hybridswap_fault_cnt;
+	atomic64_t prefetch_pages;
+	atomic64_t prefetch_hit;
 	atomic64_t reout_pages;
 	atomic64_t reout_bytes;
 	atomic64_t zram_stored_pages;
@@ -289,6 +291,8 @@ struct cgroup_cache_page {
 	char compressing;
 	char dead;
 };
+
+extern int akcompress_batch_stat_show(char *buf, int size);
 #endif
 
 typedef struct mem_cgroup_hybridswap {
@@ -481,6 +485,8 @@ extern void hybridswap_mem_cgroup_deinit(struct mem_cgroup *memcg);
 extern unsigned long hybridswap_out_to_eswap(unsigned long size);
 extern int hybridswap_batches(struct mem_cgroup *mcg,
 		unsigned long size, bool preload);
+extern int hybridswap_batches_async(struct mem_cgroup *mcg,
+		unsigned long size);
 extern unsigned long zram_zsmalloc(struct zs_pool *zs_pool,
 		size_t size, gfp_t gfp);
 extern struct task_struct *fetch_task_from_proc(struct inode *inode);
@@ -178,6 +178,9 @@ ssize_t hybridswap_vmstat_show(struct device *dev,
 		if (len == PAGE_SIZE)
 			break;
 	}
+#ifdef CONFIG_HYBRIDSWAP_ASYNC_COMPRESS
+	len += akcompress_batch_stat_show(buf + len, PAGE_SIZE - len);
+#endif
 	kfree(vm_buf);
 
 	return len;
@@ -769,23 +772,31 @@ static s64 mem_cgroup_ufs2zram_scale_read(struct cgroup_subsys_state *css,
 	return atomic64_read(&MEMCGRP_ITEM(memcg, ufs2zram_scale));
 }
 
+static unsigned long mem_cgroup_force_eswapin_size(memcg_hybs_t *hybs)
+{
+	unsigned long size = 0;
+	const unsigned int scale = 100;
+
+#ifdef	CONFIG_HYBRIDSWAP_CORE
+	size = atomic64_read(&hybs->hybridswap_stored_size);
+#endif
+	size = atomic64_read(&hybs->ufs2zram_scale) * size / scale;
+
+	return ESWAP_ALIGN_UP(size);
+}
+
 static int mem_cgroup_force_eswapin_write(struct cgroup_subsys_state *css,
 		struct cftype *cft, s64 val)
 {
 	struct mem_cgroup *memcg = mem_cgroup_from_css(css);
 	memcg_hybs_t *hybs;
-	unsigned long size = 0;
-	const unsigned int scale = 100;
+	unsigned long size;
 
 	hybs = MEMCGRP_ITEM_DATA(memcg);
 	if (!hybs)
 		return -EPERM;
 
-#ifdef	CONFIG_HYBRIDSWAP_CORE
-	size = atomic64_read(&hybs->hybridswap_stored_size);
-#endif
-	size = atomic64_read(&hybs->ufs2zram_scale) * size / scale;
-	size = ESWAP_ALIGN_UP(size);
+	size = mem_cgroup_force_eswapin_size(hybs);
 
 #ifdef CONFIG_HYBRIDSWAP_CORE
 	hybridswap_batches(memcg, size, val ? true : false);
@@ -794,6 +805,28 @@ static int mem_cgroup_force_eswapin_write(struct cgroup_subsys_state *css,
 	return 0;
 }
 
+/* Same preload as force_eswapin, run from the reclaim workqueue */
+static int mem_cgroup_force_eswapin_async_write(
+		struct cgroup_subsys_state *css, struct cftype *cft, s64 val)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(css);
+	memcg_hybs_t *hybs;
+	unsigned long size;
+
+	hybs = MEMCGRP_ITEM_DATA(memcg);
+	if (!hybs)
+		return -EPERM;
+
+	size = mem_cgroup_force_eswapin_size(hybs);
+
+#ifdef CONFIG_HYBRIDSWAP_CORE
+	if (val)
+		return hybridswap_batches_async(memcg, size);
+#endif
+
+	return 0;
+}
+
 static int mem_cgroup_force_eswapout_write(struct cgroup_subsys_state *css,
 		struct cftype *cft, s64 val)
 {
@@ -889,6 +922,10 @@ static struct cftype mem_cgroup_hybridswap_legacy_files[] = {
 		.name = "force_eswapin",
 		.write_s64 = mem_cgroup_force_eswapin_write,
 	},
+	{
+		.name = "force_eswapin_async",
+		.write_s64 = mem_cgroup_force_eswapin_async_write,
+	},
 	{
 		.name = "force_eswapout",
 		.write_s64 = mem_cgroup_force_eswapout_write,
@@ -1228,7 +1228,8 @@ void update_zram_index(struct zram *zram, u32 index, unsigned long page)
 	zram_slot_unlock(zram, index);
 }
 
-int async_compress_page(struct zram *zram, struct page* page)
+static int async_compress_one(struct zram *zram, struct page *page,
+		unsigned long *phandle, unsigned int *pcomp_len)
 {
 	int ret = 0;
 	unsigned long alloced_pages;
@@ -1238,10 +1239,13 @@ int async_compress_page(struct zram *zram, struct page* page)
 	struct zcomp_strm *zstrm;
 	int index = get_zram_index(page);
 
+	*phandle = 0;
 compress_again:
 	zram_slot_lock(zram, index);
 	if (!zram_test_flag(zram, index, ZRAM_CACHED_COMPRESS)) {
 		zram_slot_unlock(zram, index);
+		if (handle)
+			zs_free(zram->mem_pool, handle);
 		return 0;
 	}
 	zram_slot_unlock(zram, index);
@@ -1301,6 +1305,17 @@ compress_again:
 	zs_unmap_object(zram->mem_pool, handle);
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
 
+	*phandle = handle;
+	*pcomp_len = comp_len;
+
+	return 0;
+}
+
+static void async_publish_page(struct zram *zram, struct page *page,
+		unsigned long handle, unsigned int comp_len)
+{
+	int index = get_zram_index(page);
+
 	/*
 	 * Free memory associated with this sector
 	 * before overwriting unused sectors.
@@ -1310,7 +1325,7 @@ compress_again:
 		atomic64_sub(comp_len, &zram->stats.compr_data_size);
 		zs_free(zram->mem_pool, handle);
 		zram_slot_unlock(zram, index);
-		return 0;
+		return;
 	}
 	zram_free_page(zram, index);
 
@@ -1328,8 +1343,51 @@ compress_again:
 
 	/* Update stats */
 	atomic64_inc(&zram->stats.pages_stored);
+}
 
-	return ret;
+int async_compress_page(struct zram *zram, struct page* page)
+{
+	unsigned long handle;
+	unsigned int comp_len;
+	int ret;
+
+	ret = async_compress_one(zram, page, &handle, &comp_len);
+	if (ret || !handle)
+		return ret;
+
+	async_publish_page(zram, page, handle, comp_len);
+
+	return 0;
+}
+
+/*
+ * Compress up to ASYNC_COMPRESS_BATCH cached pages, then publish all of
+ * them to the slot table in a second pass so the slot locks are only
+ * taken once per page after the expensive work is done.
+ * rets[i] receives the status of pages[i].
+ */
+int async_compress_pages(struct zram *zram, struct page **pages,
+		int *rets, int nr)
+{
+	unsigned long handles[ASYNC_COMPRESS_BATCH];
+	unsigned int comp_lens[ASYNC_COMPRESS_BATCH];
+	int i, stored = 0;
+
+	if (nr > ASYNC_COMPRESS_BATCH)
+		nr = ASYNC_COMPRESS_BATCH;
+
+	for (i = 0; i < nr; i++)
+		rets[i] = async_compress_one(zram, pages[i],
+				&handles[i], &comp_lens[i]);
+
+	for (i = 0; i < nr; i++) {
+		if (rets[i] || !handles[i])
+			continue;
+		async_publish_page(zram, pages[i], handles[i], comp_lens[i]);
+		stored++;
+	}
+
+	return stored;
 }
 #endif
 
@@ -33,7 +33,10 @@
 } while(0)
 
 #ifdef CONFIG_HYBRIDSWAP_ASYNC_COMPRESS
+#define ASYNC_COMPRESS_BATCH 32
 extern int async_compress_page(struct zram *zram, struct page* page);
+extern int async_compress_pages(struct zram *zram, struct page **pages,
+		int *rets, int nr);
 extern void update_zram_index(struct zram *zram, u32 index, unsigned long page);
 #endif
 #endif
@@ -0,0 +1,320 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Content based deduplication of zram slots.
+ *
+ * Every compressed object stored while dedup is enabled gets a
+ * zram_entry, hashed by a checksum of the uncompressed page. A write
+ * whose checksum matches an existing entry is verified with memcmp
+ * against the decompressed object and, on a match, the slot takes a
+ * reference on that entry instead of storing its own copy. Slots that
+ * share an entry carry ZRAM_DEDUP and point at the entry instead of at
+ * the zsmalloc handle; zram_get_handle() resolves the indirection.
+ */
+
+#define KMSG_COMPONENT "zram"
+#define pr_fmt(fmt) KMSG_COMPONENT ": " fmt
+
+#include <linux/jhash.h>
+#include <linux/highmem.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/rbtree.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+#include "zram_drv.h"
+#include "zram_drv_internal.h"
+#include "zram_dedup.h"
+
+/* Candidates with a matching checksum that are compared per write */
+#define ZRAM_DEDUP_MAX_PROBE	4
+
+#define ZRAM_HASH_SHIFT		4
+#define ZRAM_HASH_SIZE_MIN	(1 << 10)
+#define ZRAM_HASH_SIZE_MAX	(1 << 16)
+
+u64 zram_dedup_dup_size(struct zram *zram)
+{
+	return (u64)atomic64_read(&zram->stats.dup_data_size);
+}
+
+u64 zram_dedup_meta_size(struct zram *zram)
+{
+	return (u64)atomic64_read(&zram->stats.meta_data_size);
+}
+
+u32 zram_dedup_checksum(struct page *page)
+{
+	void *mem;
+	u32 checksum;
+
+	mem = kmap_atomic(page);
+	checksum = jhash(mem, PAGE_SIZE, 0);
+	kunmap_atomic(mem);
+
+	return checksum;
+}
+
+static struct zram_hash *zram_dedup_hash(struct zram *zram, u32 checksum)
+{
+	return &zram->hash[checksum & (zram->hash_size - 1)];
+}
+
+static void zram_dedup_insert(struct zram *zram, struct zram_entry *new)
+{
+	struct zram_hash *hash = zram_dedup_hash(zram, new->checksum);
+	struct rb_node **rb_node, *parent = NULL;
+	struct zram_entry *entry;
+
+	spin_lock(&hash->lock);
+	rb_node = &hash->rb_root.rb_node;
+	while (*rb_node) {
+		parent = *rb_node;
+		entry = rb_entry(parent, struct zram_entry, rb_node);
+		if (new->checksum < entry->checksum)
+			rb_node = &parent->rb_left;
+		else
+			rb_node = &parent->rb_right;
+	}
+
+	rb_link_node(&new->rb_node, parent, rb_node);
+	rb_insert_color(&new->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+}
+
+static bool zram_dedup_match(struct zram *zram, struct zram_entry *entry,
+				struct page *page)
+{
+	bool match = false;
+	unsigned char *cmem, *mem;
+	struct zcomp_strm *zstrm;
+
+	cmem = zs_map_object(zram->mem_pool, entry->handle, ZS_MM_RO);
+	if (entry->len == PAGE_SIZE) {
+		mem = kmap_atomic(page);
+		match = !memcmp(mem, cmem, PAGE_SIZE);
+		kunmap_atomic(mem);
+	} else {
+		zstrm = zcomp_stream_get(zram->comp);
+		if (!zcomp_decompress(zstrm, cmem, entry->len, zstrm->buffer)) {
+			mem = kmap_atomic(page);
+			match = !memcmp(mem, zstrm->buffer, PAGE_SIZE);
+			kunmap_atomic(mem);
+		}
+		zcomp_stream_put(zram->comp);
+	}
+	zs_unmap_object(zram->mem_pool, entry->handle);
+
+	return match;
+}
+
+/* Return the first entry carrying @checksum, called with hash->lock held */
+static struct zram_entry *zram_dedup_first(struct zram_hash *hash,
+				u32 checksum)
+{
+	struct rb_node *rb_node = hash->rb_root.rb_node, *prev;
+	struct zram_entry *entry;
+
+	while (rb_node) {
+		entry = rb_entry(rb_node, struct zram_entry, rb_node);
+		if (checksum == entry->checksum)
+			break;
+		if (checksum < entry->checksum)
+			rb_node = rb_node->rb_left;
+		else
+			rb_node = rb_node->rb_right;
+	}
+	if (!rb_node)
+		return NULL;
+
+	/* step back to the first of the entries sharing this checksum */
+	while ((prev = rb_prev(rb_node)) &&
+	       rb_entry(prev, struct zram_entry, rb_node)->checksum == checksum)
+		rb_node = prev;
+
+	return rb_entry(rb_node, struct zram_entry, rb_node);
+}
+
+static void zram_dedup_free(struct zram *zram, struct zram_entry *entry)
+{
+	atomic64_sub(entry->len, &zram->stats.compr_data_size);
+	atomic64_sub(sizeof(*entry), &zram->stats.meta_data_size);
+	zs_free(zram->mem_pool, entry->handle);
+	kmem_cache_free(zram->entry_cache, entry);
+}
+
+/* Drop the reference zram_dedup_find() holds on a candidate */
+static void zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	struct zram_hash *hash = zram_dedup_hash(zram, entry->checksum);
+	unsigned long refcount;
+
+	spin_lock(&hash->lock);
+	refcount = --entry->refcount;
+	if (!refcount)
+		rb_erase(&entry->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+
+	if (refcount)
+		return;
+
+	/*
+	 * The last slot went away while we were comparing and took our
+	 * reference for a sharer's, give back its dup_data_size.
+	 */
+	atomic64_add(entry->len, &zram->stats.dup_data_size);
+	zram_dedup_free(zram, entry);
+}
+
+/*
+ * Look for an object with the same content as @page. On success the
+ * entry is returned with a reference held for the caller's slot.
+ *
+ * Candidates are pinned with a reference and compared with the bucket
+ * lock dropped, since that takes a decompression and a page memcmp.
+ */
+struct zram_entry *zram_dedup_find(struct zram *zram, struct page *page,
+				u32 checksum)
+{
+	struct zram_hash *hash = zram_dedup_hash(zram, checksum);
+	struct zram_entry *entry, *next, *found = NULL;
+	struct rb_node *rb_node;
+	ktime_t start = ktime_get();
+	int probe = 0;
+
+	spin_lock(&hash->lock);
+	entry = zram_dedup_first(hash, checksum);
+	if (entry)
+		entry->refcount++;
+	spin_unlock(&hash->lock);
+
+	while (entry) {
+		if (zram_dedup_match(zram, entry, page)) {
+			found = entry;
+			break;
+		}
+		atomic64_inc(&zram->stats.dedup_collisions);
+
+		/* @entry is pinned, so it is still linked in the tree */
+		next = NULL;
+		spin_lock(&hash->lock);
+		rb_node = rb_next(&entry->rb_node);
+		if (++probe < ZRAM_DEDUP_MAX_PROBE && rb_node) {
+			next = rb_entry(rb_node, struct zram_entry, rb_node);
+			if (next->checksum == checksum)
+				next->refcount++;
+			else
+				next = NULL;
+		}
+		spin_unlock(&hash->lock);
+
+		zram_dedup_put(zram, entry);
+		entry = next;
+	}
+
+	if (found) {
+		atomic64_inc(&zram->stats.dedup_hits);
+		atomic64_add(found->len, &zram->stats.dup_data_size);
+	}
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+			&zram->stats.dedup_ns);
+
+	return found;
+}
+
+/*
+ * Wrap a freshly stored object in an entry so later writes can share it.
+ * Returns NULL if the entry cannot be allocated, in which case the caller
+ * keeps the plain handle in its slot.
+ */
+struct zram_entry *zram_dedup_new(struct zram *zram, unsigned long handle,
+				unsigned int len, u32 checksum)
+{
+	struct zram_entry *entry;
+
+	entry = kmem_cache_alloc(zram->entry_cache,
+			GFP_NOIO | __GFP_NOWARN | __GFP_NORETRY);
+	if (!entry)
+		return NULL;
+
+	entry->handle = handle;
+	entry->len = len;
+	entry->checksum = checksum;
+	entry->refcount = 1;
+	RB_CLEAR_NODE(&entry->rb_node);
+	zram_dedup_insert(zram, entry);
+	atomic64_add(sizeof(*entry), &zram->stats.meta_data_size);
+
+	return entry;
+}
+
+/*
+ * Drop the reference a slot holds on its entry. The caller holds the slot
+ * lock; compr_data_size only shrinks once the last sharer goes away.
+ */
+void zram_dedup_release(struct zram *zram, u32 index)
+{
+	struct zram_entry *entry = zram_get_entry(zram, index);
+	struct zram_hash *hash = zram_dedup_hash(zram, entry->checksum);
+	unsigned long refcount;
+
+	zram_clear_flag(zram, index, ZRAM_DEDUP);
+
+	spin_lock(&hash->lock);
+	refcount = --entry->refcount;
+	if (!refcount)
+		rb_erase(&entry->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+
+	if (refcount) {
+		atomic64_sub(entry->len, &zram->stats.dup_data_size);
+		return;
+	}
+
+	zram_dedup_free(zram, entry);
+}
+
+int zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	int i;
+
+	if (!zram->use_dedup)
+		return 0;
+
+	zram->hash_size = roundup_pow_of_two(clamp_t(size_t,
+			num_pages >> ZRAM_HASH_SHIFT,
+			ZRAM_HASH_SIZE_MIN, ZRAM_HASH_SIZE_MAX));
+	zram->hash = vzalloc(zram->hash_size * sizeof(struct zram_hash));
+	if (!zram->hash) {
+		pr_err("Error allocating zram entry hash\n");
+		return -ENOMEM;
+	}
+
+	zram->entry_cache = kmem_cache_create(zram->disk->disk_name,
+			sizeof(struct zram_entry), 0, 0, NULL);
+	if (!zram->entry_cache) {
+		vfree(zram->hash);
+		zram->hash = NULL;
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < zram->hash_size; i++) {
+		spin_lock_init(&zram->hash[i].lock);
+		zram->hash[i].rb_root = RB_ROOT;
+	}
+
+	return 0;
+}
+
+/* All slots have been freed by the time this is called */
+void zram_dedup_fini(struct zram *zram)
+{
+	if (!zram->hash)
+		return;
+
+	kmem_cache_destroy(zram->entry_cache);
+	zram->entry_cache = NULL;
+	vfree(zram->hash);
+	zram->hash = NULL;
+	zram->hash_size = 0;
+}
@@ -38,6 +38,7 @@
 
 #include "zram_drv.h"
 #include "zram_drv_internal.h"
+#include "zram_dedup.h"
 #ifdef CONFIG_HYBRIDSWAP
 #include "../hybridswap/hybridswap.h"
 #endif
@@ -979,6 +980,42 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", (int)val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+
+	return len;
+}
+#endif
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -1035,7 +1072,7 @@ static ssize_t mm_stat_show(struct device *dev,
 	max_used = atomic_long_read(&zram->stats.max_used_pages);
 
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu %8llu\n",
+			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu %8llu",
 			orig_size << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.compr_data_size),
 			mem_used << PAGE_SHIFT,
@@ -1045,6 +1082,12 @@ static ssize_t mm_stat_show(struct device *dev,
 			atomic_long_read(&pool_stats.pages_compacted),
 			(u64)atomic64_read(&zram->stats.huge_pages),
 			(u64)atomic64_read(&zram->stats.huge_pages_since));
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	ret += scnprintf(buf + ret, PAGE_SIZE - ret, " %8llu %8llu",
+			zram_dedup_dup_size(zram),
+			zram_dedup_meta_size(zram));
+#endif
+	ret += scnprintf(buf + ret, PAGE_SIZE - ret, "\n");
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1083,6 +1126,13 @@ static ssize_t debug_stat_show(struct device *dev,
 			version,
 			(u64)atomic64_read(&zram->stats.writestall),
 			(u64)atomic64_read(&zram->stats.miss_free));
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	ret += scnprintf(buf + ret, PAGE_SIZE - ret,
+			"dedup: %8llu %8llu %8llu\n",
+			(u64)atomic64_read(&zram->stats.dedup_hits),
+			(u64)atomic64_read(&zram->stats.dedup_collisions),
+			(u64)atomic64_read(&zram->stats.dedup_ns) / NSEC_PER_USEC);
+#endif
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1104,6 +1154,7 @@ static void zram_meta_free(struct zram *zram, u64 disksize)
 	for (index = 0; index < num_pages; index++)
 		zram_free_page(zram, index);
 
+	zram_dedup_fini(zram);
 	zs_destroy_pool(zram->mem_pool);
 	vfree(zram->table);
 }
@@ -1123,6 +1174,12 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
 		return false;
 	}
 
+	if (zram_dedup_init(zram, num_pages)) {
+		zs_destroy_pool(zram->mem_pool);
+		vfree(zram->table);
+		return false;
+	}
+
 	if (!huge_class_size)
 		huge_class_size = zs_huge_class_size(zram->mem_pool);
 	return true;
@@ -1170,6 +1227,14 @@ static void zram_free_page(struct zram *zram, size_t index)
 		goto out;
 	}
 
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	if (zram_test_flag(zram, index, ZRAM_DEDUP)) {
+		zram_dedup_release(zram, index);
+		atomic64_dec(&zram->stats.pages_stored);
+		goto out;
+	}
+#endif
+
 	handle = zram_get_handle(zram, index);
 	if (!handle)
 		return;
@@ -1308,6 +1373,10 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	struct page *page = bvec->bv_page;
 	unsigned long element = 0;
 	enum zram_pageflags flags = 0;
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	struct zram_entry *entry = NULL;
+	u32 checksum = 0;
+#endif
 
 	mem = kmap_atomic(page);
 	if (page_same_filled(mem, &element)) {
@@ -1319,6 +1388,17 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	}
 	kunmap_atomic(mem);
 
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	if (zram->use_dedup) {
+		checksum = zram_dedup_checksum(page);
+		entry = zram_dedup_find(zram, page, checksum);
+		if (entry) {
+			comp_len = entry->len;
+			goto out;
+		}
+	}
+#endif
+
 compress_again:
 	zstrm = zcomp_stream_get(zram->comp);
 	src = kmap_atomic(page);
@@ -1386,6 +1466,10 @@ compress_again:
 	zcomp_stream_put(zram->comp);
 	zs_unmap_object(zram->mem_pool, handle);
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	if (zram->use_dedup)
+		entry = zram_dedup_new(zram, handle, comp_len, checksum);
+#endif
 out:
 	/*
 	 * Free memory associated with this sector
@@ -1403,6 +1487,12 @@ out:
 	if (flags) {
 		zram_set_flag(zram, index, flags);
 		zram_set_element(zram, index, element);
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	} else if (entry) {
+		zram_set_flag(zram, index, ZRAM_DEDUP);
+		zram_set_entry(zram, index, entry);
+		zram_set_obj_size(zram, index, comp_len);
+#endif
 	}  else {
 		zram_set_handle(zram, index, handle);
 		zram_set_obj_size(zram, index, comp_len);
@@ -1832,6 +1922,9 @@ static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
 static DEVICE_ATTR_RW(comp_algorithm);
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+static DEVICE_ATTR_RW(use_dedup);
+#endif
 #ifdef CONFIG_HYBRIDSWAP_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
@@ -1867,6 +1960,9 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
 	&dev_attr_comp_algorithm.attr,
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	&dev_attr_use_dedup.attr,
+#endif
 #ifdef CONFIG_HYBRIDSWAP_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 	&dev_attr_writeback.attr,
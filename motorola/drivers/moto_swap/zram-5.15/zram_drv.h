@@ -16,6 +16,8 @@
 #define _ZRAM_DRV_H_
 
 #include <linux/rwsem.h>
+#include <linux/rbtree.h>
+#include <linux/spinlock.h>
 #include <linux/zsmalloc.h>
 #include <linux/crypto.h>
 
@@ -56,12 +58,32 @@ enum zram_pageflags {
 	ZRAM_FROM_HYBRIDSWAP,
 	ZRAM_MCGID_CLEAR,
 	ZRAM_IN_BD, /* zram stored in back device */
+	ZRAM_PREFETCHED, /* read in with an extent, not yet accessed */
+#endif
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	ZRAM_DEDUP,	/* slot holds a shared zram_entry, not a handle */
 #endif
 	__NR_ZRAM_PAGEFLAGS,
 };
 
 /*-- Data structures */
 
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+/* Compressed object shared by every slot with the same content */
+struct zram_entry {
+	struct rb_node rb_node;
+	u32 len;
+	u32 checksum;
+	unsigned long refcount;	/* protected by the zram_hash lock */
+	unsigned long handle;
+};
+
+struct zram_hash {
+	spinlock_t lock;
+	struct rb_root rb_root;
+};
+#endif
+
 /* Allocated for each disk page */
 struct zram_table_entry {
 	union {
@@ -94,6 +116,13 @@ struct zram_stats {
 	atomic64_t bd_reads;		/* no. of reads from backing device */
 	atomic64_t bd_writes;		/* no. of writes from backing device */
 #endif
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	atomic64_t dup_data_size;	/* compressed size of pages duplicated */
+	atomic64_t meta_data_size;	/* size of zram_entries */
+	atomic64_t dedup_hits;		/* no. of writes served by an entry */
+	atomic64_t dedup_collisions;	/* no. of checksum matches with different data */
+	atomic64_t dedup_ns;		/* time spent looking up duplicates */
+#endif
 };
 
 struct zram {
@@ -140,5 +169,11 @@ struct zram {
 #ifdef CONFIG_HYBRIDSWAP_CORE
 	struct hyb_info *infos;
 #endif
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+	bool use_dedup;
+	struct zram_hash *hash;
+	size_t hash_size;
+	struct kmem_cache *entry_cache;
+#endif
 };
 #endif
@@ -13,7 +13,16 @@
 
 #define dev_to_zram(dev) ((struct zram *)dev_to_disk(dev)->private_data)
 
+#ifdef CONFIG_HYBRIDSWAP_ZRAM_DEDUP
+#define zram_get_entry(zram, index) ((struct zram_entry *)zram->table[index].handle)
+
+#define zram_set_entry(zram, index, entry) (zram->table[index].handle = (unsigned long)(entry))
+
+#define zram_get_handle(zram, index) (zram_test_flag(zram, index, ZRAM_DEDUP) ? \
+		zram_get_entry(zram, index)->handle : zram->table[index].handle)
+#else
 #define zram_get_handle(zram, index) (zram->table[index].handle)
+#endif
 
 #define zram_set_handle(zram, index, handle_val) (zram->table[index].handle = handle_val)
 
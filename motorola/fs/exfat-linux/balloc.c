@@ -9,37 +9,260 @@
 
 #include "exfat_fs.h"
 
-static const unsigned char free_bit[] = {
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2,/*  0 ~  19*/
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5, 0, 1, 0, 2, 0, 1, 0, 3,/* 20 ~  39*/
-	0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2,/* 40 ~  59*/
-	0, 1, 0, 6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,/* 60 ~  79*/
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5, 0, 1, 0, 2,/* 80 ~  99*/
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3,/*100 ~ 119*/
-	0, 1, 0, 2, 0, 1, 0, 7, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2,/*120 ~ 139*/
-	0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5,/*140 ~ 159*/
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2,/*160 ~ 179*/
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 6, 0, 1, 0, 2, 0, 1, 0, 3,/*180 ~ 199*/
-	0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2,/*200 ~ 219*/
-	0, 1, 0, 5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,/*220 ~ 239*/
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0                /*240 ~ 254*/
+struct exfat_free_extent {
+	struct rb_node start_node; /* node in free_ext_by_start */
+	struct rb_node len_node; /* node in free_ext_by_len */
+	unsigned int start; /* first free cluster */
+	unsigned int len; /* num of contiguous free clusters */
 };
 
-static const unsigned char used_bit[] = {
-	0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 1, 2, 2, 3,/*  0 ~  19*/
-	2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 1, 2, 2, 3, 2, 3, 3, 4,/* 20 ~  39*/
-	2, 3, 3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5,/* 40 ~  59*/
-	4, 5, 5, 6, 1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,/* 60 ~  79*/
-	2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 2, 3, 3, 4,/* 80 ~  99*/
-	3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6,/*100 ~ 119*/
-	4, 5, 5, 6, 5, 6, 6, 7, 1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4,/*120 ~ 139*/
-	3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,/*140 ~ 159*/
-	2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5,/*160 ~ 179*/
-	4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, 2, 3, 3, 4, 3, 4, 4, 5,/*180 ~ 199*/
-	3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6,/*200 ~ 219*/
-	5, 6, 6, 7, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,/*220 ~ 239*/
-	4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8             /*240 ~ 255*/
-};
+/*
+ *  Allocation Bitmap Scan Functions
+ */
+
+/*
+ * Return the first bitmap entry in [start, end) whose bit is clear (or set, if
+ * @used is true), or @end if there is none. The bitmap is searched a long
+ * word at a time inside each vol_amap buffer.
+ */
+static unsigned int exfat_find_next_ent(struct super_block *sb,
+		unsigned int start, unsigned int end, bool used)
+{
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+	unsigned int map_i, base, limit, b;
+	void *data;
+
+	while (start < end) {
+		map_i = BITMAP_OFFSET_SECTOR_INDEX(sb, start);
+		base = start & ~BITS_PER_SECTOR_MASK(sb);
+		limit = min_t(unsigned int, end - base, BITS_PER_SECTOR(sb));
+		data = sbi->vol_amap[map_i]->b_data;
+
+		if (used)
+			b = find_next_bit_le(data, limit, start - base);
+		else
+			b = find_next_zero_bit_le(data, limit, start - base);
+		if (b < limit)
+			return base + b;
+
+		start = base + BITS_PER_SECTOR(sb);
+	}
+
+	return end;
+}
+
+/*
+ *  Free Extent Index Functions
+ */
+static struct exfat_free_extent *exfat_free_ext_lookup(
+		struct exfat_sb_info *sbi, unsigned int clu)
+{
+	struct rb_node *node = sbi->free_ext_by_start.rb_node;
+	struct exfat_free_extent *ext, *prev = NULL;
+
+	/* find the last extent starting at or before clu */
+	while (node) {
+		ext = rb_entry(node, struct exfat_free_extent, start_node);
+		if (clu < ext->start) {
+			node = node->rb_left;
+		} else {
+			prev = ext;
+			node = node->rb_right;
+		}
+	}
+
+	return prev;
+}
+
+static void exfat_free_ext_insert_len(struct exfat_sb_info *sbi,
+		struct exfat_free_extent *new)
+{
+	struct rb_node **p = &sbi->free_ext_by_len.rb_node, *parent = NULL;
+	struct exfat_free_extent *ext;
+
+	while (*p) {
+		parent = *p;
+		ext = rb_entry(parent, struct exfat_free_extent, len_node);
+		if (new->len < ext->len ||
+		    (new->len == ext->len && new->start < ext->start))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&new->len_node, parent, p);
+	rb_insert_color(&new->len_node, &sbi->free_ext_by_len);
+}
+
+static void exfat_free_ext_insert_start(struct exfat_sb_info *sbi,
+		struct exfat_free_extent *new)
+{
+	struct rb_node **p = &sbi->free_ext_by_start.rb_node, *parent = NULL;
+	struct exfat_free_extent *ext;
+
+	while (*p) {
+		parent = *p;
+		ext = rb_entry(parent, struct exfat_free_extent, start_node);
+		if (new->start < ext->start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&new->start_node, parent, p);
+	rb_insert_color(&new->start_node, &sbi->free_ext_by_start);
+}
+
+static void exfat_free_ext_destroy(struct exfat_sb_info *sbi,
+		unsigned char state)
+{
+	struct exfat_free_extent *ext, *n;
+
+	rbtree_postorder_for_each_entry_safe(ext, n, &sbi->free_ext_by_start,
+			start_node)
+		kfree(ext);
+
+	sbi->free_ext_by_start = RB_ROOT;
+	sbi->free_ext_by_len = RB_ROOT;
+	sbi->nr_free_ext = 0;
+	sbi->free_ext_state = state;
+}
+
+static int exfat_free_ext_add(struct exfat_sb_info *sbi, unsigned int start,
+		unsigned int len)
+{
+	struct exfat_free_extent *ext;
+
+	if (sbi->nr_free_ext >= EXFAT_MAX_FREE_EXT)
+		return -ENOSPC;
+
+	ext = kmalloc(sizeof(*ext), GFP_NOFS);
+	if (!ext)
+		return -ENOMEM;
+
+	ext->start = start;
+	ext->len = len;
+	exfat_free_ext_insert_start(sbi, ext);
+	exfat_free_ext_insert_len(sbi, ext);
+	sbi->nr_free_ext++;
+	return 0;
+}
+
+static void exfat_free_ext_del(struct exfat_sb_info *sbi,
+		struct exfat_free_extent *ext)
+{
+	rb_erase(&ext->start_node, &sbi->free_ext_by_start);
+	rb_erase(&ext->len_node, &sbi->free_ext_by_len);
+	sbi->nr_free_ext--;
+	kfree(ext);
+}
+
+/* The start order is unaffected, only the length key needs to be updated */
+static void exfat_free_ext_resize(struct exfat_sb_info *sbi,
+		struct exfat_free_extent *ext, unsigned int start,
+		unsigned int len)
+{
+	rb_erase(&ext->len_node, &sbi->free_ext_by_len);
+	ext->start = start;
+	ext->len = len;
+	exfat_free_ext_insert_len(sbi, ext);
+}
+
+/* This function must be called with bitmap_lock held */
+static int exfat_free_ext_build(struct super_block *sb)
+{
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+	unsigned int total_ents = EXFAT_DATA_CLUSTER_COUNT(sbi);
+	unsigned int ent = 0, used;
+	int err;
+
+	while (ent < total_ents) {
+		ent = exfat_find_next_ent(sb, ent, total_ents, false);
+		if (ent >= total_ents)
+			break;
+
+		used = exfat_find_next_ent(sb, ent, total_ents, true);
+		err = exfat_free_ext_add(sbi, BITMAP_ENT_TO_CLUSTER(ent),
+				used - ent);
+		if (err) {
+			/*
+			 * Too fragmented to be worth indexing (or out of
+			 * memory), keep using the bitmap scan for this mount.
+			 */
+			exfat_free_ext_destroy(sbi, EXFAT_FREE_EXT_DISABLED);
+			return err;
+		}
+		ent = used;
+	}
+
+	sbi->free_ext_state = EXFAT_FREE_EXT_VALID;
+	return 0;
+}
+
+/* Cluster @clu was allocated, remove it from the free extent index */
+static void exfat_free_ext_set(struct exfat_sb_info *sbi, unsigned int clu)
+{
+	struct exfat_free_extent *ext;
+	unsigned int end;
+
+	if (sbi->free_ext_state != EXFAT_FREE_EXT_VALID)
+		return;
+
+	ext = exfat_free_ext_lookup(sbi, clu);
+	if (!ext || clu >= ext->start + ext->len)
+		return;
+
+	end = ext->start + ext->len;
+	if (ext->len == 1) {
+		exfat_free_ext_del(sbi, ext);
+	} else if (clu == ext->start) {
+		exfat_free_ext_resize(sbi, ext, clu + 1, ext->len - 1);
+	} else if (clu == end - 1) {
+		exfat_free_ext_resize(sbi, ext, ext->start, ext->len - 1);
+	} else {
+		exfat_free_ext_resize(sbi, ext, ext->start, clu - ext->start);
+		if (exfat_free_ext_add(sbi, clu + 1, end - clu - 1))
+			exfat_free_ext_destroy(sbi, EXFAT_FREE_EXT_DISABLED);
+	}
+}
+
+/* Cluster @clu was freed, merge it into the free extent index */
+static void exfat_free_ext_clear(struct exfat_sb_info *sbi, unsigned int clu)
+{
+	struct exfat_free_extent *prev, *next = NULL;
+	struct rb_node *node;
+
+	if (sbi->free_ext_state != EXFAT_FREE_EXT_VALID)
+		return;
+
+	prev = exfat_free_ext_lookup(sbi, clu);
+	if (prev) {
+		/* already free */
+		if (clu < prev->start + prev->len)
+			return;
+		node = rb_next(&prev->start_node);
+	} else {
+		node = rb_first(&sbi->free_ext_by_start);
+	}
+	if (node)
+		next = rb_entry(node, struct exfat_free_extent, start_node);
+
+	if (prev && prev->start + prev->len == clu) {
+		if (next && next->start == clu + 1) {
+			unsigned int len = prev->len + 1 + next->len;
+
+			exfat_free_ext_del(sbi, next);
+			exfat_free_ext_resize(sbi, prev, prev->start, len);
+		} else {
+			exfat_free_ext_resize(sbi, prev, prev->start,
+					prev->len + 1);
+		}
+	} else if (next && next->start == clu + 1) {
+		exfat_free_ext_resize(sbi, next, clu, next->len + 1);
+	} else if (exfat_free_ext_add(sbi, clu, 1)) {
+		exfat_free_ext_destroy(sbi, EXFAT_FREE_EXT_DISABLED);
+	}
+}
 
 /*
  *  Allocation Bitmap Management Functions
@@ -89,6 +312,10 @@ static int exfat_allocate_bitmap(struct super_block *sb,
 		}
 	}
 
+	sbi->free_ext_by_start = RB_ROOT;
+	sbi->free_ext_by_len = RB_ROOT;
+	sbi->nr_free_ext = 0;
+	sbi->free_ext_state = EXFAT_FREE_EXT_NONE;
 	return 0;
 }
 
@@ -138,6 +365,7 @@ void exfat_free_bitmap(struct exfat_sb_info *sbi)
 		__brelse(sbi->vol_amap[i]);
 
 	kfree(sbi->vol_amap);
+	exfat_free_ext_destroy(sbi, EXFAT_FREE_EXT_NONE);
 }
 
 int exfat_set_bitmap(struct inode *inode, unsigned int clu,bool sync)
@@ -154,6 +382,7 @@ int exfat_set_bitmap(struct inode *inode, unsigned int clu,bool sync)
 
 	set_bit_le(b, sbi->vol_amap[i]->b_data);
 	exfat_update_bh( sbi->vol_amap[i], sync);
+	exfat_free_ext_set(sbi, clu);
 	return 0;
 }
 
@@ -172,6 +401,7 @@ void exfat_clear_bitmap(struct inode *inode, unsigned int clu, bool sync)
 
 	clear_bit_le(b, sbi->vol_amap[i]->b_data);
 	exfat_update_bh(sbi->vol_amap[i], sync);
+	exfat_free_ext_clear(sbi, clu);
 
 	if (opts->discard) {
 		int ret_discard;
@@ -193,71 +423,86 @@ void exfat_clear_bitmap(struct inode *inode, unsigned int clu, bool sync)
  */
 unsigned int exfat_find_free_bitmap(struct super_block *sb, unsigned int clu)
 {
-	unsigned int i, map_i, map_b, ent_idx;
-	unsigned int clu_base, clu_free;
-	unsigned char k, clu_mask;
+	unsigned int ent_idx, free_ent;
 	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+	unsigned int total_ents = EXFAT_DATA_CLUSTER_COUNT(sbi);
 
 	WARN_ON(clu < EXFAT_FIRST_CLUSTER);
 	ent_idx = CLUSTER_TO_BITMAP_ENT(clu);
-	clu_base = BITMAP_ENT_TO_CLUSTER(ent_idx & ~(BITS_PER_BYTE_MASK));
-	clu_mask = IGNORED_BITS_REMAINED(clu, clu_base);
-
-	map_i = BITMAP_OFFSET_SECTOR_INDEX(sb, ent_idx);
-	map_b = BITMAP_OFFSET_BYTE_IN_SECTOR(sb, ent_idx);
-
-	for (i = EXFAT_FIRST_CLUSTER; i < sbi->num_clusters;
-	     i += BITS_PER_BYTE) {
-		k = *(sbi->vol_amap[map_i]->b_data + map_b);
-		if (clu_mask > 0) {
-			k |= clu_mask;
-			clu_mask = 0;
-		}
-		if (k < 0xFF) {
-			clu_free = clu_base + free_bit[k];
-			if (clu_free < sbi->num_clusters)
-				return clu_free;
-		}
-		clu_base += BITS_PER_BYTE;
+	if (ent_idx >= total_ents)
+		ent_idx = 0;
+
+	free_ent = exfat_find_next_ent(sb, ent_idx, total_ents, false);
+	if (free_ent >= total_ents && ent_idx > 0) {
+		/* wrap around to the first cluster of the cluster heap */
+		free_ent = exfat_find_next_ent(sb, 0, ent_idx, false);
+		if (free_ent >= ent_idx)
+			return EXFAT_EOF_CLUSTER;
+	} else if (free_ent >= total_ents) {
+		return EXFAT_EOF_CLUSTER;
+	}
 
-		if (++map_b >= sb->s_blocksize ||
-		    clu_base >= sbi->num_clusters) {
-			if (++map_i >= sbi->map_sectors) {
-				clu_base = EXFAT_FIRST_CLUSTER;
-				map_i = 0;
-			}
-			map_b = 0;
+	return BITMAP_ENT_TO_CLUSTER(free_ent);
+}
+
+/*
+ * Find the start of a run of at least @num_clusters free clusters, picking the
+ * smallest run that fits. The free extent index is built on the first call.
+ * Returns EXFAT_EOF_CLUSTER if no such run exists or the index is unavailable.
+ *
+ * This function must be called with bitmap_lock held.
+ */
+unsigned int exfat_find_free_extent(struct super_block *sb,
+		unsigned int num_clusters)
+{
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+	struct rb_node *node;
+	struct exfat_free_extent *ext, *best = NULL;
+
+	lockdep_assert_held(&sbi->bitmap_lock);
+
+	if (sbi->free_ext_state == EXFAT_FREE_EXT_NONE)
+		exfat_free_ext_build(sb);
+	if (sbi->free_ext_state != EXFAT_FREE_EXT_VALID)
+		return EXFAT_EOF_CLUSTER;
+
+	node = sbi->free_ext_by_len.rb_node;
+	while (node) {
+		ext = rb_entry(node, struct exfat_free_extent, len_node);
+		if (ext->len >= num_clusters) {
+			best = ext;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
 		}
 	}
 
-	return EXFAT_EOF_CLUSTER;
+	return best ? best->start : EXFAT_EOF_CLUSTER;
 }
 
 int exfat_count_used_clusters(struct super_block *sb, unsigned int *ret_count)
 {
 	struct exfat_sb_info *sbi = EXFAT_SB(sb);
 	unsigned int count = 0;
-	unsigned int i, map_i = 0, map_b = 0;
+	unsigned int i, nbytes;
 	unsigned int total_clus = EXFAT_DATA_CLUSTER_COUNT(sbi);
 	unsigned int last_mask = total_clus & BITS_PER_BYTE_MASK;
-	unsigned char clu_bits;
-	const unsigned char last_bit_mask[] = {0, 0b00000001, 0b00000011,
-		0b00000111, 0b00001111, 0b00011111, 0b00111111, 0b01111111};
-
-	total_clus &= ~last_mask;
-	for (i = 0; i < total_clus; i += BITS_PER_BYTE) {
-		clu_bits = *(sbi->vol_amap[map_i]->b_data + map_b);
-		count += used_bit[clu_bits];
-		if (++map_b >= (unsigned int)sb->s_blocksize) {
-			map_i++;
-			map_b = 0;
-		}
+	unsigned int total_bytes = total_clus / BITS_PER_BYTE;
+
+	for (i = 0; i < sbi->map_sectors && total_bytes; i++) {
+		nbytes = min_t(unsigned int, total_bytes, sb->s_blocksize);
+		count += memweight(sbi->vol_amap[i]->b_data, nbytes);
+		total_bytes -= nbytes;
 	}
 
 	if (last_mask) {
-		clu_bits = *(sbi->vol_amap[map_i]->b_data + map_b);
-		clu_bits &= last_bit_mask[last_mask];
-		count += used_bit[clu_bits];
+		unsigned int map_b = (total_clus / BITS_PER_BYTE) &
+			(sb->s_blocksize - 1);
+		unsigned char clu_bits;
+
+		i = BITMAP_OFFSET_SECTOR_INDEX(sb, total_clus);
+		clu_bits = *(sbi->vol_amap[i]->b_data + map_b);
+		count += hweight8(clu_bits & ((1 << last_mask) - 1));
 	}
 
 	*ret_count = count;
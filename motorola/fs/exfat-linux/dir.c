@@ -6,9 +6,35 @@
 #include <linux/slab.h>
 #include <linux/bio.h>
 #include <linux/buffer_head.h>
+#include <linux/hash.h>
+#include <linux/mm.h>
 
 #include "exfat_fs.h"
 
+/* one file of an indexed directory */
+struct exfat_dir_index_ent {
+	struct hlist_node node;
+	unsigned int clu; /* cluster holding the file dentry */
+	int eidx; /* directory-relative index of the file dentry */
+	u16 name_hash;
+	unsigned char name_len;
+};
+
+/* name hash to dentry location index of a directory */
+struct exfat_dir_index {
+	struct list_head lru; /* on exfat_dir_index_lru */
+	struct exfat_inode_info *ei;
+	unsigned int version; /* directory i_version when built */
+	unsigned int nr_ents;
+	unsigned int hash_bits;
+	struct hlist_head *buckets;
+	struct exfat_dir_index_ent *ents;
+};
+
+static LIST_HEAD(exfat_dir_index_lru);
+static DEFINE_SPINLOCK(exfat_dir_index_lock);
+static unsigned long exfat_dir_index_nr_ents;
+
 static int exfat_extract_uni_name(struct exfat_dentry *ep,
 		unsigned short *uniname)
 {
@@ -903,6 +929,343 @@ free_es:
 	return NULL;
 }
 
+/*
+ *  Directory Name Hash Index
+ *
+ * Large directories get an in-memory index from (name_hash, name_len) of each
+ * file to the location of its file dentry, built on the first lookup after
+ * the directory changed. Any create, rename or unlink bumps the directory's
+ * i_version, which invalidates the index. Indexes are reclaimed through a
+ * shrinker, least recently used first.
+ */
+static inline unsigned int exfat_dir_index_hash(u16 name_hash,
+		unsigned char name_len, unsigned int bits)
+{
+	return hash_32(((u32)name_hash << 8) | name_len, bits);
+}
+
+static void exfat_dir_index_free(struct exfat_dir_index *idx)
+{
+	kvfree(idx->buckets);
+	kvfree(idx->ents);
+	kfree(idx);
+}
+
+void exfat_dir_index_drop(struct exfat_inode_info *ei)
+{
+	struct exfat_dir_index *idx;
+
+	if (!READ_ONCE(ei->dir_index))
+		return;
+
+	spin_lock(&exfat_dir_index_lock);
+	idx = ei->dir_index;
+	if (idx) {
+		list_del(&idx->lru);
+		exfat_dir_index_nr_ents -= idx->nr_ents;
+		ei->dir_index = NULL;
+	}
+	spin_unlock(&exfat_dir_index_lock);
+
+	if (idx)
+		exfat_dir_index_free(idx);
+}
+
+static int exfat_dir_index_add(struct exfat_dir_index *idx,
+		unsigned int *cap, unsigned int clu, int eidx,
+		struct exfat_dentry *ep)
+{
+	struct exfat_dir_index_ent *ent;
+
+	if (idx->nr_ents == *cap) {
+		struct exfat_dir_index_ent *ents;
+
+		if (*cap >= EXFAT_DIR_INDEX_MAX_ENTS)
+			return -E2BIG;
+
+		ents = kvmalloc_array(*cap * 2, sizeof(*ents), GFP_NOFS);
+		if (!ents)
+			return -ENOMEM;
+		memcpy(ents, idx->ents, idx->nr_ents * sizeof(*ents));
+		kvfree(idx->ents);
+		idx->ents = ents;
+		*cap *= 2;
+	}
+
+	ent = &idx->ents[idx->nr_ents++];
+	ent->clu = clu;
+	ent->eidx = eidx;
+	ent->name_hash = le16_to_cpu(ep->dentry.stream.name_hash);
+	ent->name_len = ep->dentry.stream.name_len;
+	return 0;
+}
+
+/* This function must be called with s_lock held */
+static int exfat_dir_index_build(struct super_block *sb,
+		struct exfat_inode_info *ei, struct exfat_chain *p_dir,
+		unsigned int version)
+{
+	int i, dentry = 0, file_eidx = -1, err = 0;
+	unsigned int cap = 64, file_clu = 0, entry_type, h;
+	struct exfat_chain clu;
+	struct exfat_dir_index *idx;
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+
+	idx = kzalloc(sizeof(*idx), GFP_NOFS);
+	if (!idx)
+		return -ENOMEM;
+	idx->ents = kvmalloc_array(cap, sizeof(*idx->ents), GFP_NOFS);
+	if (!idx->ents) {
+		err = -ENOMEM;
+		goto free_idx;
+	}
+
+	exfat_chain_dup(&clu, p_dir);
+	while (clu.dir != EXFAT_EOF_CLUSTER) {
+		for (i = 0; i < sbi->dentries_per_clu; i++, dentry++) {
+			struct exfat_dentry *ep;
+			struct buffer_head *bh;
+
+			ep = exfat_get_dentry(sb, &clu, i, &bh, NULL);
+			if (!ep) {
+				err = -EIO;
+				goto free_idx;
+			}
+
+			entry_type = exfat_get_entry_type(ep);
+			if (entry_type == TYPE_UNUSED) {
+				brelse(bh);
+				goto build_hash;
+			}
+
+			if (entry_type == TYPE_FILE || entry_type == TYPE_DIR) {
+				file_eidx = dentry;
+				file_clu = clu.dir;
+			} else {
+				if (entry_type == TYPE_STREAM &&
+				    file_eidx == dentry - 1)
+					err = exfat_dir_index_add(idx, &cap,
+						file_clu, file_eidx, ep);
+				file_eidx = -1;
+			}
+			brelse(bh);
+			if (err)
+				goto free_idx;
+		}
+
+		if (clu.flags == ALLOC_NO_FAT_CHAIN) {
+			if (--clu.size > 0)
+				clu.dir++;
+			else
+				clu.dir = EXFAT_EOF_CLUSTER;
+		} else {
+			if (exfat_get_next_cluster(sb, &clu.dir)) {
+				err = -EIO;
+				goto free_idx;
+			}
+		}
+	}
+
+build_hash:
+	/* one or two files per bucket */
+	idx->hash_bits = ilog2(max(idx->nr_ents, 2U));
+	idx->buckets = kvmalloc_array(1U << idx->hash_bits,
+			sizeof(*idx->buckets), GFP_NOFS);
+	if (!idx->buckets) {
+		err = -ENOMEM;
+		goto free_idx;
+	}
+	for (h = 0; h < (1U << idx->hash_bits); h++)
+		INIT_HLIST_HEAD(&idx->buckets[h]);
+	for (i = 0; i < idx->nr_ents; i++) {
+		struct exfat_dir_index_ent *ent = &idx->ents[i];
+
+		h = exfat_dir_index_hash(ent->name_hash, ent->name_len,
+				idx->hash_bits);
+		hlist_add_head(&ent->node, &idx->buckets[h]);
+	}
+
+	idx->ei = ei;
+	idx->version = version;
+
+	spin_lock(&exfat_dir_index_lock);
+	list_add(&idx->lru, &exfat_dir_index_lru);
+	exfat_dir_index_nr_ents += idx->nr_ents;
+	ei->dir_index = idx;
+	spin_unlock(&exfat_dir_index_lock);
+	return 0;
+
+free_idx:
+	exfat_dir_index_free(idx);
+	return err;
+}
+
+/* Compare the name stored in the dentry set of @ent against @p_uniname */
+static int exfat_dir_index_match(struct super_block *sb,
+		struct exfat_chain *p_dir, struct exfat_dir_index_ent *ent,
+		struct exfat_uni_name *p_uniname, unsigned int type)
+{
+	int i, len, name_len = 0, ret = 0;
+	unsigned short entry_uniname[16];
+	struct exfat_chain clu;
+	struct exfat_entry_set_cache *es;
+	struct exfat_dentry *ep;
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+
+	exfat_chain_set(&clu, ent->clu, 0, p_dir->flags);
+	es = exfat_get_dentry_set(sb, &clu,
+			ent->eidx & (sbi->dentries_per_clu - 1), ES_ALL_ENTRIES);
+	if (!es)
+		return -EIO;
+
+	ep = exfat_get_dentry_cached(es, 0);
+	if (type != TYPE_ALL && type != exfat_get_entry_type(ep))
+		goto out;
+
+	for (i = 2; i < es->num_entries; i++) {
+		ep = exfat_get_dentry_cached(es, i);
+		if (exfat_get_entry_type(ep) != TYPE_EXTEND)
+			break;
+
+		len = exfat_extract_uni_name(ep, entry_uniname);
+		if (name_len + len > p_uniname->name_len ||
+		    exfat_uniname_ncmp(sb, p_uniname->name + name_len,
+				entry_uniname, len))
+			goto out;
+
+		name_len += len;
+		if (name_len == p_uniname->name_len) {
+			ret = 1;
+			break;
+		}
+	}
+
+out:
+	exfat_free_dentry_set(es, false);
+	return ret;
+}
+
+/*
+ * Look @p_uniname up in the name hash index of @ei, building it first if
+ * needed. Returns the dentry index, -ENOENT if the name is not in the
+ * directory, or -EAGAIN if the directory is not indexed and must be scanned.
+ */
+static int exfat_dir_index_find(struct super_block *sb,
+		struct exfat_inode_info *ei, struct exfat_chain *p_dir,
+		struct exfat_uni_name *p_uniname, unsigned int type,
+		struct exfat_hint *hint_opt)
+{
+	int ret;
+	unsigned int h, version;
+	struct exfat_dir_index *idx;
+	struct exfat_dir_index_ent *ent;
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+
+	lockdep_assert_held(&sbi->s_lock);
+
+	version = inode_peek_iversion_raw(&ei->vfs_inode) & 0xffffffff;
+
+	idx = ei->dir_index;
+	if (idx && idx->version != version) {
+		exfat_dir_index_drop(ei);
+		idx = NULL;
+	}
+
+	if (!idx) {
+		if (i_size_read(&ei->vfs_inode) < EXFAT_DIR_INDEX_MIN_SIZE)
+			return -EAGAIN;
+		if (ei->dir_index_skip && ei->dir_index_skip_ver == version)
+			return -EAGAIN;
+
+		ret = exfat_dir_index_build(sb, ei, p_dir, version);
+		if (ret) {
+			/* too many files or no memory, keep scanning */
+			ei->dir_index_skip = true;
+			ei->dir_index_skip_ver = version;
+			return -EAGAIN;
+		}
+		idx = ei->dir_index;
+	} else {
+		spin_lock(&exfat_dir_index_lock);
+		list_move(&idx->lru, &exfat_dir_index_lru);
+		spin_unlock(&exfat_dir_index_lock);
+	}
+
+	h = exfat_dir_index_hash(p_uniname->name_hash, p_uniname->name_len,
+			idx->hash_bits);
+	hlist_for_each_entry(ent, &idx->buckets[h], node) {
+		if (ent->name_hash != p_uniname->name_hash ||
+		    ent->name_len != p_uniname->name_len)
+			continue;
+
+		ret = exfat_dir_index_match(sb, p_dir, ent, p_uniname, type);
+		if (ret < 0)
+			return ret;
+		if (ret) {
+			hint_opt->clu = ent->clu;
+			hint_opt->eidx = ent->eidx & (sbi->dentries_per_clu - 1);
+			return ent->eidx;
+		}
+	}
+
+	return -ENOENT;
+}
+
+static unsigned long exfat_dir_index_count(struct shrinker *shrink,
+		struct shrink_control *sc)
+{
+	return READ_ONCE(exfat_dir_index_nr_ents);
+}
+
+static unsigned long exfat_dir_index_scan(struct shrinker *shrink,
+		struct shrink_control *sc)
+{
+	struct exfat_dir_index *idx, *n;
+	unsigned long freed = 0;
+	LIST_HEAD(dispose);
+
+	spin_lock(&exfat_dir_index_lock);
+	list_for_each_entry_safe_reverse(idx, n, &exfat_dir_index_lru, lru) {
+		struct exfat_sb_info *sbi = EXFAT_SB(idx->ei->vfs_inode.i_sb);
+
+		if (freed >= sc->nr_to_scan)
+			break;
+
+		/* lookups use the index under s_lock without this lock */
+		if (!mutex_trylock(&sbi->s_lock))
+			continue;
+
+		list_move(&idx->lru, &dispose);
+		exfat_dir_index_nr_ents -= idx->nr_ents;
+		idx->ei->dir_index = NULL;
+		mutex_unlock(&sbi->s_lock);
+
+		freed += idx->nr_ents;
+	}
+	spin_unlock(&exfat_dir_index_lock);
+
+	list_for_each_entry_safe(idx, n, &dispose, lru)
+		exfat_dir_index_free(idx);
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker exfat_dir_index_shrinker = {
+	.count_objects	= exfat_dir_index_count,
+	.scan_objects	= exfat_dir_index_scan,
+	.seeks		= DEFAULT_SEEKS,
+};
+
+int exfat_dir_index_init(void)
+{
+	return register_shrinker(&exfat_dir_index_shrinker);
+}
+
+void exfat_dir_index_shutdown(void)
+{
+	unregister_shrinker(&exfat_dir_index_shrinker);
+}
+
 enum {
 	DIRENT_STEP_FILE,
 	DIRENT_STEP_STRM,
@@ -935,6 +1298,11 @@ int exfat_find_dir_entry(struct super_block *sb, struct exfat_inode_info *ei,
 	struct exfat_hint_femp candi_empty;
 	struct exfat_sb_info *sbi = EXFAT_SB(sb);
 
+	dentry = exfat_dir_index_find(sb, ei, p_dir, p_uniname, type, hint_opt);
+	if (dentry != -EAGAIN)
+		return dentry;
+	dentry = 0;
+
 	dentries_per_clu = sbi->dentries_per_clu;
 
 	exfat_chain_dup(&clu, p_dir);
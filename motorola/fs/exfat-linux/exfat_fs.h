@@ -9,6 +9,7 @@
 #include <linux/fs.h>
 #include <linux/ratelimit.h>
 #include <linux/nls.h>
+#include <linux/rbtree.h>
 
 #include "config.h"
 #include "compat.h"
@@ -20,6 +21,18 @@
 
 #define EXFAT_CLUSTERS_UNTRACKED (~0u)
 
+/*
+ * free extent index state
+ */
+enum {
+	EXFAT_FREE_EXT_NONE,	/* not built yet, built on first use */
+	EXFAT_FREE_EXT_VALID,	/* in sync with the allocation bitmap */
+	EXFAT_FREE_EXT_DISABLED,	/* too fragmented, bitmap scan only */
+};
+
+/* upper bound of extents kept in the free extent index */
+#define EXFAT_MAX_FREE_EXT	65536
+
 /*
  * exfat error flags
  */
@@ -78,6 +91,11 @@ enum {
 #define DIR_CACHE_SIZE		(256*sizeof(struct exfat_dentry)/512+1)
 
 #define EXFAT_HINT_NONE		-1
+
+/* directories smaller than this are looked up by scanning */
+#define EXFAT_DIR_INDEX_MIN_SIZE	(256 * DENTRY_SIZE)
+/* max num of files kept in a directory name hash index */
+#define EXFAT_DIR_INDEX_MAX_ENTS	65536
 #define EXFAT_MIN_SUBDIR	2
 
 /*
@@ -244,6 +262,12 @@ struct exfat_sb_info {
 	unsigned int clu_srch_ptr; /* cluster search pointer */
 	unsigned int used_clusters; /* number of used clusters */
 
+	/* in-memory index of free cluster runs, protected by bitmap_lock */
+	struct rb_root free_ext_by_start; /* free extents sorted by start */
+	struct rb_root free_ext_by_len; /* free extents sorted by length */
+	unsigned int nr_free_ext; /* num of indexed free extents */
+	unsigned char free_ext_state; /* EXFAT_FREE_EXT_* */
+
 	struct mutex s_lock; /* superblock lock */
 	struct mutex bitmap_lock; /* bitmap lock */
 	struct exfat_mount_options options;
@@ -280,6 +304,11 @@ struct exfat_inode_info {
 	struct exfat_hint hint_stat;
 	/* hint for first empty entry */
 	struct exfat_hint_femp hint_femp;
+	/* name hash index of a large directory, protected by s_lock */
+	struct exfat_dir_index *dir_index;
+	/* i_version at which building dir_index was given up */
+	unsigned int dir_index_skip_ver;
+	bool dir_index_skip;
 
 	spinlock_t cache_lru_lock;
 	struct list_head cache_lru;
@@ -417,6 +446,8 @@ void exfat_free_bitmap(struct exfat_sb_info *sbi);
 int exfat_set_bitmap(struct inode *inode, unsigned int clu, bool sync);
 void exfat_clear_bitmap(struct inode *inode, unsigned int clu, bool sync);
 unsigned int exfat_find_free_bitmap(struct super_block *sb, unsigned int clu);
+unsigned int exfat_find_free_extent(struct super_block *sb,
+		unsigned int num_clusters);
 int exfat_count_used_clusters(struct super_block *sb, unsigned int *ret_count);
 int exfat_trim_fs(struct inode *inode, struct fstrim_range *range);
 
@@ -451,6 +482,9 @@ int exfat_get_cluster(struct inode *inode, unsigned int cluster,
 		unsigned int *last_dclus, int allow_eof);
 
 /* dir.c */
+int exfat_dir_index_init(void);
+void exfat_dir_index_shutdown(void);
+void exfat_dir_index_drop(struct exfat_inode_info *ei);
 extern const struct inode_operations exfat_dir_inode_operations;
 extern const struct file_operations exfat_dir_operations;
 unsigned int exfat_get_entry_type(struct exfat_dentry *p_entry);
@@ -350,7 +350,13 @@ int exfat_alloc_cluster(struct inode *inode, unsigned int num_alloc,
 			sbi->clu_srch_ptr = EXFAT_FIRST_CLUSTER;
 		}
 
-		hint_clu = exfat_find_free_bitmap(sb, sbi->clu_srch_ptr);
+		/* prefer a free run that holds the whole request */
+		hint_clu = EXFAT_EOF_CLUSTER;
+		if (num_alloc > 1)
+			hint_clu = exfat_find_free_extent(sb, num_alloc);
+		if (hint_clu == EXFAT_EOF_CLUSTER)
+			hint_clu = exfat_find_free_bitmap(sb,
+					sbi->clu_srch_ptr);
 		if (hint_clu == EXFAT_EOF_CLUSTER) {
 			ret = -ENOSPC;
 			goto unlock;
@@ -654,5 +654,6 @@ void exfat_evict_inode(struct inode *inode)
 	invalidate_inode_buffers(inode);
 	clear_inode(inode);
 	exfat_cache_inval_inode(inode);
+	exfat_dir_index_drop(EXFAT_I(inode));
 	exfat_unhash_inode(inode);
 }
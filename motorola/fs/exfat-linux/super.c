@@ -191,6 +191,8 @@ static struct inode *exfat_alloc_inode(struct super_block *sb)
 		return NULL;
 
 	init_rwsem(&ei->truncate_lock);
+	ei->dir_index = NULL;
+	ei->dir_index_skip = false;
 	return &ei->vfs_inode;
 }
 
@@ -859,13 +861,17 @@ static int __init init_exfat_fs(void)
 	if (err)
 		return err;
 
+	err = exfat_dir_index_init();
+	if (err)
+		goto shutdown_cache;
+
 	exfat_inode_cachep = kmem_cache_create("exfat_inode_cache",
 			sizeof(struct exfat_inode_info),
 			0, SLAB_RECLAIM_ACCOUNT | SLAB_MEM_SPREAD,
 			exfat_inode_init_once);
 	if (!exfat_inode_cachep) {
 		err = -ENOMEM;
-		goto shutdown_cache;
+		goto shutdown_dir_index;
 	}
 
 	err = register_filesystem(&exfat_fs_type);
@@ -876,6 +882,8 @@ static int __init init_exfat_fs(void)
 
 destroy_cache:
 	kmem_cache_destroy(exfat_inode_cachep);
+shutdown_dir_index:
+	exfat_dir_index_shutdown();
 shutdown_cache:
 	exfat_cache_shutdown();
 	return err;
@@ -890,6 +898,7 @@ static void __exit exit_exfat_fs(void)
 	rcu_barrier();
 	kmem_cache_destroy(exfat_inode_cachep);
 	unregister_filesystem(&exfat_fs_type);
+	exfat_dir_index_shutdown();
 	exfat_cache_shutdown();
 }
 
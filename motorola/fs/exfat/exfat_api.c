@@ -97,10 +97,11 @@ int FsMountVol(struct super_block *sb)
 	sm_P(&z_sem);
 
 	err = buf_init(sb);
-	if (!err)
+	if (!err) {
 		err = ffsMountVol(sb);
-	else
-		buf_shutdown(sb);
+		if (err)
+			buf_shutdown(sb);
+	}
 
 	sm_V(&z_sem);
 
@@ -33,6 +33,11 @@
 /*                                                                      */
 /************************************************************************/
 
+#include <linux/hash.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+
 #include "exfat_config.h"
 #include "exfat_data.h"
 
@@ -49,11 +54,13 @@
 
 static s32 __FAT_read(struct super_block *sb, u32 loc, u32 *content);
 static s32 __FAT_write(struct super_block *sb, u32 loc, u32 content);
+static s32 __FAT_write_chain(struct super_block *sb, u32 chain, s32 len);
 
 static BUF_CACHE_T *FAT_cache_find(struct super_block *sb, sector_t sec);
 static BUF_CACHE_T *FAT_cache_get(struct super_block *sb, sector_t sec);
 static void FAT_cache_insert_hash(struct super_block *sb, BUF_CACHE_T *bp);
 static void FAT_cache_remove_hash(BUF_CACHE_T *bp);
+static void FAT_cache_readahead(struct super_block *sb, sector_t sec);
 
 static u8 *__buf_getblk(struct super_block *sb, sector_t sec);
 
@@ -71,16 +78,76 @@ static void move_to_lru(BUF_CACHE_T *bp, BUF_CACHE_T *list);
 /*  Cache Initialization Functions                                      */
 /*======================================================================*/
 
+/* pick a cache size for this volume between min and max entries */
+static u32 buf_cache_entries(struct super_block *sb, u32 min, u32 max, u32 shift)
+{
+	u64 dev_bytes = i_size_read(sb->s_bdev->bd_inode);
+	unsigned long mem_entries;
+	u32 entries = min;
+
+	/* double the cache for every (1 << shift) bytes of volume */
+	while ((entries < max) && (((u64) entries << shift) < dev_bytes))
+		entries <<= 1;
+
+	/* each entry may pin a page, keep them below 1/1024 of RAM */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,0,0)
+	mem_entries = totalram_pages() >> 10;
+#else
+	mem_entries = totalram_pages >> 10;
+#endif
+	while ((entries > min) && (entries > mem_entries))
+		entries >>= 1;
+
+	return entries;
+} /* end of buf_cache_entries */
+
+static inline u32 FAT_cache_hash(FS_INFO_T *p_fs, sector_t sec)
+{
+	return hash_64((u64) sec, p_fs->FAT_cache_hash_bits);
+}
+
+static inline u32 buf_cache_hash(FS_INFO_T *p_fs, sector_t sec)
+{
+	return hash_64((u64) sec, p_fs->buf_cache_hash_bits);
+}
+
 s32 buf_init(struct super_block *sb)
 {
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+	u32 FAT_hash_size, buf_hash_size;
 
 	int i;
 
+	p_fs->FAT_cache_size = buf_cache_entries(sb, FAT_CACHE_SIZE,
+			FAT_CACHE_MAX_SIZE, FAT_CACHE_SIZE_SHIFT);
+	p_fs->buf_cache_size = buf_cache_entries(sb, BUF_CACHE_SIZE,
+			BUF_CACHE_MAX_SIZE, BUF_CACHE_SIZE_SHIFT);
+
+	/* keep about two entries per hash bucket */
+	p_fs->FAT_cache_hash_bits = ilog2(p_fs->FAT_cache_size) - 1;
+	p_fs->buf_cache_hash_bits = ilog2(p_fs->buf_cache_size) - 1;
+	FAT_hash_size = 1 << p_fs->FAT_cache_hash_bits;
+	buf_hash_size = 1 << p_fs->buf_cache_hash_bits;
+
+	p_fs->FAT_cache_array = kvzalloc(sizeof(BUF_CACHE_T) *
+			(p_fs->FAT_cache_size + FAT_hash_size), GFP_KERNEL);
+	p_fs->buf_cache_array = kvzalloc(sizeof(BUF_CACHE_T) *
+			(p_fs->buf_cache_size + buf_hash_size), GFP_KERNEL);
+	if (!p_fs->FAT_cache_array || !p_fs->buf_cache_array) {
+		buf_shutdown(sb);
+		return FFS_MEMORYERR;
+	}
+	p_fs->FAT_cache_hash_list = p_fs->FAT_cache_array + p_fs->FAT_cache_size;
+	p_fs->buf_cache_hash_list = p_fs->buf_cache_array + p_fs->buf_cache_size;
+
+	memset(&p_fs->FAT_cache_stat, 0, sizeof(BUF_CACHE_STAT_T));
+	memset(&p_fs->buf_cache_stat, 0, sizeof(BUF_CACHE_STAT_T));
+	p_fs->FAT_cache_ra_end = 0;
+
 	/* LRU list */
 	p_fs->FAT_cache_lru_list.next = p_fs->FAT_cache_lru_list.prev = &p_fs->FAT_cache_lru_list;
 
-	for (i = 0; i < FAT_CACHE_SIZE; i++) {
+	for (i = 0; i < p_fs->FAT_cache_size; i++) {
 		p_fs->FAT_cache_array[i].drv = -1;
 		p_fs->FAT_cache_array[i].sec = ~0;
 		p_fs->FAT_cache_array[i].flag = 0;
@@ -91,7 +158,7 @@ s32 buf_init(struct super_block *sb)
 
 	p_fs->buf_cache_lru_list.next = p_fs->buf_cache_lru_list.prev = &p_fs->buf_cache_lru_list;
 
-	for (i = 0; i < BUF_CACHE_SIZE; i++) {
+	for (i = 0; i < p_fs->buf_cache_size; i++) {
 		p_fs->buf_cache_array[i].drv = -1;
 		p_fs->buf_cache_array[i].sec = ~0;
 		p_fs->buf_cache_array[i].flag = 0;
@@ -101,22 +168,22 @@ s32 buf_init(struct super_block *sb)
 	}
 
 	/* HASH list */
-	for (i = 0; i < FAT_CACHE_HASH_SIZE; i++) {
+	for (i = 0; i < FAT_hash_size; i++) {
 		p_fs->FAT_cache_hash_list[i].drv = -1;
 		p_fs->FAT_cache_hash_list[i].sec = ~0;
 		p_fs->FAT_cache_hash_list[i].hash_next = p_fs->FAT_cache_hash_list[i].hash_prev = &(p_fs->FAT_cache_hash_list[i]);
 	}
 
-	for (i = 0; i < FAT_CACHE_SIZE; i++)
+	for (i = 0; i < p_fs->FAT_cache_size; i++)
 		FAT_cache_insert_hash(sb, &(p_fs->FAT_cache_array[i]));
 
-	for (i = 0; i < BUF_CACHE_HASH_SIZE; i++) {
+	for (i = 0; i < buf_hash_size; i++) {
 		p_fs->buf_cache_hash_list[i].drv = -1;
 		p_fs->buf_cache_hash_list[i].sec = ~0;
 		p_fs->buf_cache_hash_list[i].hash_next = p_fs->buf_cache_hash_list[i].hash_prev = &(p_fs->buf_cache_hash_list[i]);
 	}
 
-	for (i = 0; i < BUF_CACHE_SIZE; i++)
+	for (i = 0; i < p_fs->buf_cache_size; i++)
 		buf_cache_insert_hash(sb, &(p_fs->buf_cache_array[i]));
 
 	return FFS_SUCCESS;
@@ -124,6 +191,16 @@ s32 buf_init(struct super_block *sb)
 
 s32 buf_shutdown(struct super_block *sb)
 {
+	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+
+	kvfree(p_fs->FAT_cache_array);
+	p_fs->FAT_cache_array = NULL;
+	p_fs->FAT_cache_hash_list = NULL;
+
+	kvfree(p_fs->buf_cache_array);
+	p_fs->buf_cache_array = NULL;
+	p_fs->buf_cache_hash_list = NULL;
+
 	return FFS_SUCCESS;
 } /* end of buf_shutdown */
 
@@ -162,6 +239,25 @@ s32 FAT_write(struct super_block *sb, u32 loc, u32 content)
 	return ret;
 } /* end of FAT_write */
 
+/* in : sb, chain, len
+  * links clusters chain .. chain+len-1 to each other and terminates the
+  * last one with EOF, touching each FAT sector only once
+  * returns 0 on success
+  *            -1 on error
+  */
+s32 FAT_write_chain(struct super_block *sb, u32 chain, s32 len)
+{
+	s32 ret;
+
+	sm_P(&f_sem);
+
+	ret = __FAT_write_chain(sb, chain, len);
+
+	sm_V(&f_sem);
+
+	return ret;
+} /* end of FAT_write_chain */
+
 static s32 __FAT_read(struct super_block *sb, u32 loc, u32 *content)
 {
 	s32 off;
@@ -382,6 +478,54 @@ static s32 __FAT_write(struct super_block *sb, u32 loc, u32 content)
 	return 0;
 } /* end of __FAT_write */
 
+static s32 __FAT_write_chain(struct super_block *sb, u32 chain, s32 len)
+{
+	s32 off, n;
+	sector_t sec;
+	u8 *fat_sector;
+	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+	BD_INFO_T *p_bd = &(EXFAT_SB(sb)->bd_info);
+
+	if (len <= 0)
+		return 0;
+
+	if (p_fs->vol_type != EXFAT) {
+		while (len > 1) {
+			if (__FAT_write(sb, chain, chain+1) < 0)
+				return -1;
+			chain++;
+			len--;
+		}
+		return __FAT_write(sb, chain, CLUSTER_32(~0));
+	}
+
+	while (len > 0) {
+		sec = p_fs->FAT1_start_sector + (chain >> (p_bd->sector_size_bits-2));
+		off = (chain << 2) & p_bd->sector_size_mask;
+
+		fat_sector = FAT_getblk(sb, sec);
+		if (!fat_sector)
+			return -1;
+
+		/* fill every entry of the run that lives in this sector */
+		n = (p_bd->sector_size - off) >> 2;
+		if (n > len)
+			n = len;
+		len -= n;
+
+		for (; n > 0; n--, chain++, off += 4) {
+			if ((n == 1) && (len == 0))
+				SET32_A(&(fat_sector[off]), CLUSTER_32(~0));
+			else
+				SET32_A(&(fat_sector[off]), chain+1);
+		}
+
+		FAT_modify(sb, sec);
+	}
+
+	return 0;
+} /* end of __FAT_write_chain */
+
 u8 *FAT_getblk(struct super_block *sb, sector_t sec)
 {
 	BUF_CACHE_T *bp;
@@ -389,10 +533,14 @@ u8 *FAT_getblk(struct super_block *sb, sector_t sec)
 
 	bp = FAT_cache_find(sb, sec);
 	if (bp != NULL) {
+		p_fs->FAT_cache_stat.hit++;
 		move_to_mru(bp, &p_fs->FAT_cache_lru_list);
 		return bp->buf_bh->b_data;
 	}
 
+	p_fs->FAT_cache_stat.miss++;
+	FAT_cache_readahead(sb, sec);
+
 	bp = FAT_cache_get(sb, sec);
 
 	FAT_cache_remove_hash(bp);
@@ -476,7 +624,7 @@ static BUF_CACHE_T *FAT_cache_find(struct super_block *sb, sector_t sec)
 	BUF_CACHE_T *bp, *hp;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 
-	off = (sec + (sec >> p_fs->sectors_per_clu_bits)) & (FAT_CACHE_HASH_SIZE - 1);
+	off = FAT_cache_hash(p_fs, sec);
 
 	hp = &(p_fs->FAT_cache_hash_list[off]);
 	for (bp = hp->hash_next; bp != hp; bp = bp->hash_next) {
@@ -511,7 +659,7 @@ static void FAT_cache_insert_hash(struct super_block *sb, BUF_CACHE_T *bp)
 	FS_INFO_T *p_fs;
 
 	p_fs = &(EXFAT_SB(sb)->fs_info);
-	off = (bp->sec + (bp->sec >> p_fs->sectors_per_clu_bits)) & (FAT_CACHE_HASH_SIZE-1);
+	off = FAT_cache_hash(p_fs, bp->sec);
 
 	hp = &(p_fs->FAT_cache_hash_list[off]);
 	bp->hash_next = hp->hash_next;
@@ -526,6 +674,30 @@ static void FAT_cache_remove_hash(BUF_CACHE_T *bp)
 	(bp->hash_next)->hash_prev = bp->hash_prev;
 } /* end of FAT_cache_remove_hash */
 
+/* FAT chains are mostly walked forward, so read the following FAT sectors
+ * ahead in one go and let later misses be served from the page cache */
+static void FAT_cache_readahead(struct super_block *sb, sector_t sec)
+{
+	sector_t ra, end;
+	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+
+	/* still inside the last read-ahead window */
+	if ((sec < p_fs->FAT_cache_ra_end) &&
+		(sec + FAT_CACHE_RA_SIZE >= p_fs->FAT_cache_ra_end))
+		return;
+
+	end = p_fs->FAT1_start_sector + p_fs->num_FAT_sectors;
+	if (sec + 1 + FAT_CACHE_RA_SIZE < end)
+		end = sec + 1 + FAT_CACHE_RA_SIZE;
+
+	for (ra = sec + 1; ra < end; ra++)
+		sb_breadahead(sb, ra);
+
+	if (end > sec + 1)
+		p_fs->FAT_cache_stat.ra += end - (sec + 1);
+	p_fs->FAT_cache_ra_end = end;
+} /* end of FAT_cache_readahead */
+
 /*======================================================================*/
 /*  Buffer Read/Write Functions                                         */
 /*======================================================================*/
@@ -550,10 +722,13 @@ static u8 *__buf_getblk(struct super_block *sb, sector_t sec)
 
 	bp = buf_cache_find(sb, sec);
 	if (bp != NULL) {
+		p_fs->buf_cache_stat.hit++;
 		move_to_mru(bp, &p_fs->buf_cache_lru_list);
 		return bp->buf_bh->b_data;
 	}
 
+	p_fs->buf_cache_stat.miss++;
+
 	bp = buf_cache_get(sb, sec);
 
 	buf_cache_remove_hash(bp);
@@ -701,7 +876,7 @@ static BUF_CACHE_T *buf_cache_find(struct super_block *sb, sector_t sec)
 	BUF_CACHE_T *bp, *hp;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 
-	off = (sec + (sec >> p_fs->sectors_per_clu_bits)) & (BUF_CACHE_HASH_SIZE - 1);
+	off = buf_cache_hash(p_fs, sec);
 
 	hp = &(p_fs->buf_cache_hash_list[off]);
 	for (bp = hp->hash_next; bp != hp; bp = bp->hash_next) {
@@ -734,7 +909,7 @@ static void buf_cache_insert_hash(struct super_block *sb, BUF_CACHE_T *bp)
 	FS_INFO_T *p_fs;
 
 	p_fs = &(EXFAT_SB(sb)->fs_info);
-	off = (bp->sec + (bp->sec >> p_fs->sectors_per_clu_bits)) & (BUF_CACHE_HASH_SIZE-1);
+	off = buf_cache_hash(p_fs, bp->sec);
 
 	hp = &(p_fs->buf_cache_hash_list[off]);
 	bp->hash_next = hp->hash_next;
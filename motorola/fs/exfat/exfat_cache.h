@@ -62,6 +62,12 @@ typedef struct __BUF_CACHE_T {
 	struct buffer_head   *buf_bh;
 } BUF_CACHE_T;
 
+typedef struct {
+	unsigned long hit;
+	unsigned long miss;
+	unsigned long ra;                /* num of sectors read ahead */
+} BUF_CACHE_STAT_T;
+
 /*----------------------------------------------------------------------*/
 /*  External Function Declarations                                      */
 /*----------------------------------------------------------------------*/
@@ -70,6 +76,7 @@ s32  buf_init(struct super_block *sb);
 s32  buf_shutdown(struct super_block *sb);
 s32  FAT_read(struct super_block *sb, u32 loc, u32 *content);
 s32  FAT_write(struct super_block *sb, u32 loc, u32 content);
+s32  FAT_write_chain(struct super_block *sb, u32 chain, s32 len);
 u8 *FAT_getblk(struct super_block *sb, sector_t sec);
 void   FAT_modify(struct super_block *sb, sector_t sec);
 void   FAT_release_all(struct super_block *sb);
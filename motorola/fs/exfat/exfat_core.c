@@ -1866,15 +1866,48 @@ s32 fat_alloc_cluster(struct super_block *sb, s32 num_alloc, CHAIN_T *p_chain)
 	return num_clusters;
 } /* end of fat_alloc_cluster */
 
+/* max number of free runs probed when looking for a contiguous extent */
+#define EXFAT_ALLOC_RUN_PROBES	32
+
+/* find a free run of num_alloc clusters, or the first free cluster if none */
+static u32 exfat_find_free_run(struct super_block *sb, u32 hint_clu, s32 num_alloc)
+{
+	int i;
+	s32 run;
+	u32 clu, first_clu;
+	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+
+	first_clu = clu = test_alloc_bitmap(sb, hint_clu-2);
+
+	for (i = 0; (i < EXFAT_ALLOC_RUN_PROBES) && (clu != CLUSTER_32(~0)); i++) {
+		run = count_free_bitmap_run(sb, clu-2, num_alloc);
+		if (run >= num_alloc)
+			return clu;
+
+		/* skip past this run; stop if the search wrapped */
+		hint_clu = clu + run;
+		if (hint_clu >= p_fs->num_clusters)
+			break;
+		clu = test_alloc_bitmap(sb, hint_clu-2);
+		if (clu < hint_clu)
+			break;
+	}
+
+	return first_clu;
+} /* end of exfat_find_free_run */
+
 s32 exfat_alloc_cluster(struct super_block *sb, s32 num_alloc, CHAIN_T *p_chain)
 {
-	s32 num_clusters = 0;
+	s32 num_clusters = 0, run;
 	u32 hint_clu, new_clu, last_clu = CLUSTER_32(~0);
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 
 	hint_clu = p_chain->dir;
 	if (hint_clu == CLUSTER_32(~0)) {
-		hint_clu = test_alloc_bitmap(sb, p_fs->clu_srch_ptr-2);
+		if (num_alloc > 1)
+			hint_clu = exfat_find_free_run(sb, p_fs->clu_srch_ptr, num_alloc);
+		else
+			hint_clu = test_alloc_bitmap(sb, p_fs->clu_srch_ptr-2);
 		if (hint_clu == CLUSTER_32(~0))
 			return 0;
 	} else if (hint_clu >= p_fs->num_clusters) {
@@ -1894,13 +1927,15 @@ s32 exfat_alloc_cluster(struct super_block *sb, s32 num_alloc, CHAIN_T *p_chain)
 			}
 		}
 
-		if (set_alloc_bitmap(sb, new_clu-2) != FFS_SUCCESS)
+		/* reserve the whole free run starting at new_clu at once */
+		run = count_free_bitmap_run(sb, new_clu-2, num_alloc);
+		if (set_alloc_bitmap_run(sb, new_clu-2, run) != FFS_SUCCESS)
 			return -1;
 
-		num_clusters++;
+		num_clusters += run;
 
 		if (p_chain->flags == 0x01) {
-			if (FAT_write(sb, new_clu, CLUSTER_32(~0)) < 0)
+			if (FAT_write_chain(sb, new_clu, run) < 0)
 				return -1;
 		}
 
@@ -1912,9 +1947,10 @@ s32 exfat_alloc_cluster(struct super_block *sb, s32 num_alloc, CHAIN_T *p_chain)
 					return -1;
 			}
 		}
-		last_clu = new_clu;
+		last_clu = new_clu + run - 1;
 
-		if ((--num_alloc) == 0) {
+		num_alloc -= run;
+		if (num_alloc == 0) {
 			p_fs->clu_srch_ptr = hint_clu;
 			if (p_fs->used_clusters != (u32) ~0)
 				p_fs->used_clusters += num_clusters;
@@ -1923,7 +1959,7 @@ s32 exfat_alloc_cluster(struct super_block *sb, s32 num_alloc, CHAIN_T *p_chain)
 			return num_clusters;
 		}
 
-		hint_clu = new_clu + 1;
+		hint_clu = last_clu + 1;
 		if (hint_clu >= p_fs->num_clusters) {
 			hint_clu = 2;
 
@@ -2130,13 +2166,7 @@ void exfat_chain_cont_cluster(struct super_block *sb, u32 chain, s32 len)
 	if (len == 0)
 		return;
 
-	while (len > 1) {
-		if (FAT_write(sb, chain, chain+1) < 0)
-			break;
-		chain++;
-		len--;
-	}
-	FAT_write(sb, chain, CLUSTER_32(~0));
+	FAT_write_chain(sb, chain, len);
 } /* end of exfat_chain_cont_cluster */
 
 /*
@@ -2245,6 +2275,34 @@ s32 set_alloc_bitmap(struct super_block *sb, u32 clu)
 	return sector_write(sb, sector, p_fs->vol_amap[i], 0);
 } /* end of set_alloc_bitmap */
 
+/* set len bits starting at clu, writing each bitmap sector only once */
+s32 set_alloc_bitmap_run(struct super_block *sb, u32 clu, s32 len)
+{
+	int i, b, bits_per_sector;
+	s32 ret;
+	sector_t sector;
+	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+	BD_INFO_T *p_bd = &(EXFAT_SB(sb)->bd_info);
+
+	bits_per_sector = p_bd->sector_size << 3;
+
+	while (len > 0) {
+		i = clu >> (p_bd->sector_size_bits + 3);
+		b = clu & (bits_per_sector - 1);
+
+		sector = START_SECTOR(p_fs->map_clu) + i;
+
+		for (; (len > 0) && (b < bits_per_sector); b++, clu++, len--)
+			exfat_bitmap_set((u8 *) p_fs->vol_amap[i]->b_data, b);
+
+		ret = sector_write(sb, sector, p_fs->vol_amap[i], 0);
+		if (ret != FFS_SUCCESS)
+			return ret;
+	}
+
+	return FFS_SUCCESS;
+} /* end of set_alloc_bitmap_run */
+
 s32 clr_alloc_bitmap(struct super_block *sb, u32 clu)
 {
 	int i, b;
@@ -2320,6 +2378,37 @@ u32 test_alloc_bitmap(struct super_block *sb, u32 clu)
 	return CLUSTER_32(~0);
 } /* end of test_alloc_bitmap */
 
+/* count free bits starting at clu, up to max and the end of the bitmap */
+s32 count_free_bitmap_run(struct super_block *sb, u32 clu, s32 max)
+{
+	int i, b;
+	s32 count = 0;
+	u8 *data;
+	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+	BD_INFO_T *p_bd = &(EXFAT_SB(sb)->bd_info);
+
+	while ((count < max) && (clu < p_fs->num_clusters - 2)) {
+		i = clu >> (p_bd->sector_size_bits + 3);
+		b = clu & ((p_bd->sector_size << 3) - 1);
+		data = (u8 *) p_fs->vol_amap[i]->b_data;
+
+		/* whole free bytes can be skipped at once */
+		if (!(b & 0x7) && (data[b >> 3] == 0) && (max - count >= 8) &&
+			(clu + 8 <= p_fs->num_clusters - 2)) {
+			count += 8;
+			clu += 8;
+			continue;
+		}
+
+		if (exfat_bitmap_test(data, b))
+			break;
+		count++;
+		clu++;
+	}
+
+	return count;
+} /* end of count_free_bitmap_run */
+
 void sync_alloc_bitmap(struct super_block *sb)
 {
 	int i;
@@ -486,14 +486,21 @@ typedef struct __FS_INFO_T {
 	struct semaphore v_sem;
 
 	/* FAT cache */
-	BUF_CACHE_T FAT_cache_array[FAT_CACHE_SIZE];
+	BUF_CACHE_T *FAT_cache_array;
 	BUF_CACHE_T FAT_cache_lru_list;
-	BUF_CACHE_T FAT_cache_hash_list[FAT_CACHE_HASH_SIZE];
+	BUF_CACHE_T *FAT_cache_hash_list;
+	u32      FAT_cache_size;         /* num of FAT cache entries */
+	u32      FAT_cache_hash_bits;
+	sector_t FAT_cache_ra_end;       /* end of last FAT read-ahead window */
+	BUF_CACHE_STAT_T FAT_cache_stat;
 
 	/* buf cache */
-	BUF_CACHE_T buf_cache_array[BUF_CACHE_SIZE];
+	BUF_CACHE_T *buf_cache_array;
 	BUF_CACHE_T buf_cache_lru_list;
-	BUF_CACHE_T buf_cache_hash_list[BUF_CACHE_HASH_SIZE];
+	BUF_CACHE_T *buf_cache_hash_list;
+	u32      buf_cache_size;         /* num of buf cache entries */
+	u32      buf_cache_hash_bits;
+	BUF_CACHE_STAT_T buf_cache_stat;
 } FS_INFO_T;
 
 #define ES_2_ENTRIES		2
@@ -570,8 +577,10 @@ void   exfat_chain_cont_cluster(struct super_block *sb, u32 chain, s32 len);
 s32  load_alloc_bitmap(struct super_block *sb);
 void   free_alloc_bitmap(struct super_block *sb);
 s32   set_alloc_bitmap(struct super_block *sb, u32 clu);
+s32   set_alloc_bitmap_run(struct super_block *sb, u32 clu, s32 len);
 s32   clr_alloc_bitmap(struct super_block *sb, u32 clu);
 u32 test_alloc_bitmap(struct super_block *sb, u32 clu);
+s32  count_free_bitmap_run(struct super_block *sb, u32 clu, s32 max);
 void   sync_alloc_bitmap(struct super_block *sb);
 
 /* upcase table management functions */
@@ -55,4 +55,14 @@
 #define BUF_CACHE_SIZE          256
 #define BUF_CACHE_HASH_SIZE     64
 
+/* per-volume cache sizing: the caches above are the minimum, */
+/* doubled for every 2^SHIFT bytes of volume up to the max    */
+#define FAT_CACHE_MAX_SIZE      1024
+#define FAT_CACHE_SIZE_SHIFT    28
+#define BUF_CACHE_MAX_SIZE      2048
+#define BUF_CACHE_SIZE_SHIFT    27
+
+/* num of FAT sectors read ahead on a FAT cache miss   */
+#define FAT_CACHE_RA_SIZE       16
+
 #endif /* _EXFAT_DATA_H */
@@ -76,6 +76,8 @@
 #include <linux/fs_struct.h>
 #include <linux/namei.h>
 #include <linux/genhd.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
 #include <asm/current.h>
 #include <asm/unaligned.h>
 
@@ -2106,6 +2108,107 @@ static void exfat_free_super(struct exfat_sb_info *sbi)
 	kvfree(sbi);
 }
 
+/*======================================================================*/
+/*  Sysfs Interface                                                     */
+/*======================================================================*/
+
+static struct kset *exfat_kset;
+
+struct exfat_attr {
+	struct attribute attr;
+	ssize_t (*show)(struct exfat_sb_info *sbi, char *buf);
+};
+
+#define EXFAT_FS_INFO_ATTR(_name, _fmt, _field)				\
+static ssize_t _name##_show(struct exfat_sb_info *sbi, char *buf)	\
+{									\
+	return snprintf(buf, PAGE_SIZE, _fmt "\n", sbi->fs_info._field);	\
+}									\
+static struct exfat_attr exfat_attr_##_name = __ATTR_RO(_name)
+
+EXFAT_FS_INFO_ATTR(fat_cache_size, "%u", FAT_cache_size);
+EXFAT_FS_INFO_ATTR(fat_cache_hit, "%lu", FAT_cache_stat.hit);
+EXFAT_FS_INFO_ATTR(fat_cache_miss, "%lu", FAT_cache_stat.miss);
+EXFAT_FS_INFO_ATTR(fat_cache_readahead, "%lu", FAT_cache_stat.ra);
+EXFAT_FS_INFO_ATTR(buf_cache_size, "%u", buf_cache_size);
+EXFAT_FS_INFO_ATTR(buf_cache_hit, "%lu", buf_cache_stat.hit);
+EXFAT_FS_INFO_ATTR(buf_cache_miss, "%lu", buf_cache_stat.miss);
+
+static struct attribute *exfat_sb_attrs[] = {
+	&exfat_attr_fat_cache_size.attr,
+	&exfat_attr_fat_cache_hit.attr,
+	&exfat_attr_fat_cache_miss.attr,
+	&exfat_attr_fat_cache_readahead.attr,
+	&exfat_attr_buf_cache_size.attr,
+	&exfat_attr_buf_cache_hit.attr,
+	&exfat_attr_buf_cache_miss.attr,
+	NULL,
+};
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,2,0)
+ATTRIBUTE_GROUPS(exfat_sb);
+#endif
+
+static ssize_t exfat_attr_show(struct kobject *kobj, struct attribute *attr,
+		char *buf)
+{
+	struct exfat_sb_info *sbi = container_of(kobj, struct exfat_sb_info, s_kobj);
+	struct exfat_attr *a = container_of(attr, struct exfat_attr, attr);
+
+	return a->show(sbi, buf);
+}
+
+static const struct sysfs_ops exfat_attr_ops = {
+	.show = exfat_attr_show,
+};
+
+static void exfat_sb_release(struct kobject *kobj)
+{
+	struct exfat_sb_info *sbi = container_of(kobj, struct exfat_sb_info, s_kobj);
+
+	complete(&sbi->s_kobj_unregister);
+}
+
+static struct kobj_type exfat_sb_ktype = {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,2,0)
+	.default_groups = exfat_sb_groups,
+#else
+	.default_attrs  = exfat_sb_attrs,
+#endif
+	.sysfs_ops      = &exfat_attr_ops,
+	.release        = exfat_sb_release,
+};
+
+static int exfat_sysfs_register(struct super_block *sb)
+{
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+	int err;
+
+	init_completion(&sbi->s_kobj_unregister);
+	sbi->s_kobj.kset = exfat_kset;
+	err = kobject_init_and_add(&sbi->s_kobj, &exfat_sb_ktype, NULL, "%s", sb->s_id);
+	if (err) {
+		kobject_put(&sbi->s_kobj);
+		wait_for_completion(&sbi->s_kobj_unregister);
+		return err;
+	}
+
+	sbi->s_kobj_registered = 1;
+	return 0;
+}
+
+static void exfat_sysfs_unregister(struct super_block *sb)
+{
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+
+	if (!sbi->s_kobj_registered)
+		return;
+
+	sbi->s_kobj_registered = 0;
+	kobject_del(&sbi->s_kobj);
+	kobject_put(&sbi->s_kobj);
+	wait_for_completion(&sbi->s_kobj_unregister);
+}
+
 static void exfat_put_super(struct super_block *sb)
 {
 	struct exfat_sb_info *sbi = EXFAT_SB(sb);
@@ -2113,6 +2216,8 @@ static void exfat_put_super(struct super_block *sb)
 	sbi->disable_uevent = 1;
 	cancel_work_sync(&sbi->uevent_work);
 
+	exfat_sysfs_unregister(sb);
+
 	if (__is_sb_dirty(sb))
 		exfat_write_super(sb);
 
@@ -2575,6 +2680,10 @@ static int exfat_fill_super(struct super_block *sb, void *data, int silent)
 		goto out_fail;
 	}
 
+	/* cache statistics are informational only, mount without them */
+	if (exfat_sysfs_register(sb))
+		printk(KERN_WARNING "[EXFAT] failed to register sysfs for %s\n", sb->s_id);
+
 	/* set up enough so that it can read an inode */
 	exfat_hash_init(sb);
 
@@ -2625,6 +2734,7 @@ static int exfat_fill_super(struct super_block *sb, void *data, int silent)
 	return 0;
 
 out_fail2:
+	exfat_sysfs_unregister(sb);
 	FsUmountVol(sb);
 out_fail:
 	if (root_inode)
@@ -2668,7 +2778,7 @@ static int __init exfat_init_inodecache(void)
 	return 0;
 }
 
-static void __exit exfat_destroy_inodecache(void)
+static void exfat_destroy_inodecache(void)
 {
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,6,0)
 	/*
@@ -2741,11 +2851,21 @@ static int __init init_exfat(void)
 	if (err)
 		goto out;
 
+	exfat_kset = kset_create_and_add(exfat_fs_type.name, NULL, fs_kobj);
+	if (!exfat_kset) {
+		err = -ENOMEM;
+		goto out_inodecache;
+	}
+
 	err = register_filesystem(&exfat_fs_type);
 	if (err)
-		goto out;
+		goto out_kset;
 
 	return 0;
+out_kset:
+	kset_unregister(exfat_kset);
+out_inodecache:
+	exfat_destroy_inodecache();
 out:
 	FsShutdown();
 	return err;
@@ -2755,6 +2875,7 @@ static void __exit exit_exfat(void)
 {
 	exfat_destroy_inodecache();
 	unregister_filesystem(&exfat_fs_type);
+	kset_unregister(exfat_kset);
 	FsShutdown();
 }
 
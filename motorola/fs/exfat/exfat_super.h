@@ -98,6 +98,10 @@ struct exfat_sb_info {
 	struct super_block *sb;
 	struct work_struct uevent_work;
 	int disable_uevent;
+
+	struct kobject s_kobj;                 /* /sys/fs/exfat/<dev> */
+	struct completion s_kobj_unregister;
+	int s_kobj_registered;
 };
 
 /*
@@ -47,6 +47,24 @@ struct wcd_ctrl_platform_data {
 				 bool enable);
 };
 
+/*
+ * struct lpass_cdc_txn_stats - register transaction accounting
+ * @count: number of completed transactions
+ * @num_io: register accesses made while transactions were open
+ * @max_io: largest number of accesses in one transaction
+ * @total_us: sum of transaction latencies
+ * @last_us: latency of the last transaction
+ * @max_us: worst transaction latency
+ */
+struct lpass_cdc_txn_stats {
+	u64 count;
+	u64 num_io;
+	u32 max_io;
+	u64 total_us;
+	u32 last_us;
+	u32 max_us;
+};
+
 struct lpass_cdc_priv {
 	struct device *dev;
 	struct snd_soc_component *component;
@@ -73,6 +91,10 @@ struct lpass_cdc_priv {
 	int core_hw_vote_count;
 	int core_audio_vote_count;
 	int core_clk_vote_count;
+	/* open transactions holding the VA vote, protected by clk_lock */
+	int txn_cnt;
+	u32 txn_io_cnt;
+	struct lpass_cdc_txn_stats txn_stats;
 
 	/* Entry for version info */
 	struct snd_info_entry *entry;
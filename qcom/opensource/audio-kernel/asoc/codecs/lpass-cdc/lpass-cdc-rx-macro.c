@@ -1863,6 +1863,7 @@ static int lpass_cdc_rx_macro_config_compander(struct snd_soc_component *compone
 	u16 comp_ctl0_reg = 0, comp_ctl8_reg = 0, rx_path_cfg0_reg = 0;
 	u16 comp_coeff_lsb_reg = 0, comp_coeff_msb_reg = 0;
 	u16 mode = rx_priv->hph_pwr_mode;
+	struct lpass_cdc_txn txn = {0};
 
 	/* AUX does not have compander */
 	if (interp_n == INTERP_AUX)
@@ -1892,6 +1893,8 @@ static int lpass_cdc_rx_macro_config_compander(struct snd_soc_component *compone
 	rx_path_cfg0_reg = LPASS_CDC_RX_RX0_RX_PATH_CFG0 +
 					(comp * LPASS_CDC_RX_MACRO_RX_PATH_OFFSET);
 	if (SND_SOC_DAPM_EVENT_ON(event)) {
+		/* coefficient load is a long run of writes, batch it */
+		lpass_cdc_txn_begin(component, &txn);
 		lpass_cdc_load_compander_coeff(component,
 				comp_coeff_lsb_reg, comp_coeff_msb_reg,
 				comp_coeff_table[rx_priv->hph_pwr_mode],
@@ -1910,6 +1913,7 @@ static int lpass_cdc_rx_macro_config_compander(struct snd_soc_component *compone
 					0x02, 0x00);
 		snd_soc_component_update_bits(component, rx_path_cfg0_reg,
 					0x02, 0x02);
+		lpass_cdc_txn_end(&txn);
 	}
 
 	if (SND_SOC_DAPM_EVENT_OFF(event)) {
@@ -12,6 +12,7 @@
 #include <linux/delay.h>
 #include <linux/kernel.h>
 #include <linux/clk.h>
+#include <linux/ktime.h>
 #include <soc/snd_event.h>
 #include <linux/pm_runtime.h>
 #include <soc/swr-common.h>
@@ -25,6 +26,7 @@
 
 #define LPASS_CDC_VERSION_ENTRY_SIZE 32
 #define LPASS_CDC_STRING_LEN 80
+#define LPASS_CDC_TXN_STATS_ENTRY_SIZE 160
 
 static const struct snd_soc_component_driver lpass_cdc;
 
@@ -91,74 +93,197 @@ static void lpass_cdc_ahb_read_device(char __iomem *io_base,
 	*value = (u8)temp;
 }
 
-static int __lpass_cdc_reg_read(struct lpass_cdc_priv *priv,
-			     u16 macro_id, u16 reg, u8 *val)
+/*
+ * Take clk_lock and the VA macro vote needed for one AHB access.
+ * Returns 1 if the access may go ahead, 0 if the core votes are not
+ * in place and the access is to be skipped, or -EINVAL during SSR.
+ * On a non-negative return the caller must call lpass_cdc_io_put().
+ */
+static int lpass_cdc_io_get(struct lpass_cdc_priv *priv)
 {
-	int ret = 0;
+	struct device *va_dev = priv->macro_params[VA_MACRO].dev;
 
 	mutex_lock(&priv->clk_lock);
 	if (!priv->dev_up) {
 		dev_dbg_ratelimited(priv->dev,
 			"%s: SSR in progress, exit\n", __func__);
-		ret = -EINVAL;
-		goto ssr_err;
+		mutex_unlock(&priv->clk_lock);
+		return -EINVAL;
 	}
 
-	if (priv->macro_params[VA_MACRO].dev) {
-		pm_runtime_get_sync(priv->macro_params[VA_MACRO].dev);
+	/* An open transaction already holds the VA vote */
+	if (priv->txn_cnt) {
+		priv->txn_io_cnt++;
+		return 1;
+	}
+
+	if (va_dev) {
+		pm_runtime_get_sync(va_dev);
 		mutex_lock(&priv->vote_lock);
 		if (((priv->lpass_core_hw_vote && !priv->core_hw_vote_count) ||
-			(priv->lpass_audio_hw_vote && !priv->core_audio_vote_count))) {
-			goto vote_err;
-		}
+			(priv->lpass_audio_hw_vote && !priv->core_audio_vote_count)))
+			return 0;
 	}
-	lpass_cdc_ahb_read_device(
-		priv->macro_params[macro_id].io_base, reg, val);
+	return 1;
+}
+
+static void lpass_cdc_io_put(struct lpass_cdc_priv *priv)
+{
+	struct device *va_dev = priv->macro_params[VA_MACRO].dev;
 
-vote_err:
-	if (priv->macro_params[VA_MACRO].dev) {
+	if (!priv->txn_cnt && va_dev) {
 		mutex_unlock(&priv->vote_lock);
-		pm_runtime_mark_last_busy(priv->macro_params[VA_MACRO].dev);
-		pm_runtime_put_autosuspend(priv->macro_params[VA_MACRO].dev);
+		pm_runtime_mark_last_busy(va_dev);
+		pm_runtime_put_autosuspend(va_dev);
 	}
-ssr_err:
 	mutex_unlock(&priv->clk_lock);
-	return ret;
+}
+
+static int __lpass_cdc_reg_read(struct lpass_cdc_priv *priv,
+			     u16 macro_id, u16 reg, u8 *val)
+{
+	int ret;
+
+	ret = lpass_cdc_io_get(priv);
+	if (ret < 0)
+		return ret;
+	if (ret)
+		lpass_cdc_ahb_read_device(
+			priv->macro_params[macro_id].io_base, reg, val);
+	lpass_cdc_io_put(priv);
+	return 0;
 }
 
 static int __lpass_cdc_reg_write(struct lpass_cdc_priv *priv,
 			      u16 macro_id, u16 reg, u8 val)
 {
+	int ret;
+
+	ret = lpass_cdc_io_get(priv);
+	if (ret < 0)
+		return ret;
+	if (ret)
+		lpass_cdc_ahb_write_device(
+			priv->macro_params[macro_id].io_base, reg, val);
+	lpass_cdc_io_put(priv);
+	return 0;
+}
+
+static void lpass_cdc_txn_stats_update(struct lpass_cdc_txn_stats *stats,
+				       s64 lat_us, u32 num_io)
+{
+	stats->count++;
+	stats->num_io += num_io;
+	stats->total_us += lat_us;
+	stats->last_us = lat_us;
+	if (lat_us > stats->max_us)
+		stats->max_us = lat_us;
+	if (num_io > stats->max_io)
+		stats->max_io = num_io;
+}
+
+/**
+ * lpass_cdc_txn_begin - start a batch of macro register accesses
+ *
+ * @component: lpass_cdc component.
+ * @txn: caller owned transaction handle.
+ *
+ * Takes the VA macro power vote once for all register reads and
+ * writes up to lpass_cdc_txn_end(), so that back to back accesses
+ * across macros skip the per access runtime PM and vote checks.
+ * Accesses still fail with -EINVAL once SSR is in progress.
+ *
+ * Returns 0 on success, -EINVAL during SSR or on error, or -EAGAIN
+ * if the core hw votes are not in place.
+ */
+int lpass_cdc_txn_begin(struct snd_soc_component *component,
+			struct lpass_cdc_txn *txn)
+{
+	struct lpass_cdc_priv *priv = NULL;
+	struct device *va_dev = NULL;
+	bool no_vote = false;
 	int ret = 0;
 
+	if (!txn)
+		return -EINVAL;
+
+	txn->priv = NULL;
+	if (!component)
+		return -EINVAL;
+
+	priv = snd_soc_component_get_drvdata(component);
+	if (!priv)
+		return -EINVAL;
+
+	if (!lpass_cdc_is_valid_codec_dev(priv->dev)) {
+		dev_err_ratelimited(component->dev, "%s: invalid codec\n", __func__);
+		return -EINVAL;
+	}
+
+	va_dev = priv->macro_params[VA_MACRO].dev;
 	mutex_lock(&priv->clk_lock);
 	if (!priv->dev_up) {
 		dev_dbg_ratelimited(priv->dev,
 			"%s: SSR in progress, exit\n", __func__);
 		ret = -EINVAL;
-		goto ssr_err;
+		goto done;
 	}
-	if (priv->macro_params[VA_MACRO].dev) {
-		pm_runtime_get_sync(priv->macro_params[VA_MACRO].dev);
+	if (va_dev) {
+		pm_runtime_get_sync(va_dev);
 		mutex_lock(&priv->vote_lock);
-		if (((priv->lpass_core_hw_vote && !priv->core_hw_vote_count) ||
-			(priv->lpass_audio_hw_vote && !priv->core_audio_vote_count))) {
-			goto vote_err;
-		}
-	}
-	lpass_cdc_ahb_write_device(
-		priv->macro_params[macro_id].io_base, reg, val);
-
-vote_err:
-	if (priv->macro_params[VA_MACRO].dev) {
+		no_vote = ((priv->lpass_core_hw_vote && !priv->core_hw_vote_count) ||
+			(priv->lpass_audio_hw_vote && !priv->core_audio_vote_count));
 		mutex_unlock(&priv->vote_lock);
-		pm_runtime_mark_last_busy(priv->macro_params[VA_MACRO].dev);
-		pm_runtime_put_autosuspend(priv->macro_params[VA_MACRO].dev);
+		if (no_vote) {
+			pm_runtime_put_autosuspend(va_dev);
+			ret = -EAGAIN;
+			goto done;
+		}
 	}
-ssr_err:
+	priv->txn_cnt++;
+	txn->priv = priv;
+	txn->va_dev = va_dev;
+	txn->io_start = priv->txn_io_cnt;
+	txn->start = ktime_get();
+done:
 	mutex_unlock(&priv->clk_lock);
 	return ret;
 }
+EXPORT_SYMBOL(lpass_cdc_txn_begin);
+
+/**
+ * lpass_cdc_txn_end - finish a batch started by lpass_cdc_txn_begin
+ *
+ * @txn: transaction handle passed to lpass_cdc_txn_begin.
+ *
+ * Drops the power vote and accounts the transaction latency.
+ * Safe to call if lpass_cdc_txn_begin failed.
+ */
+void lpass_cdc_txn_end(struct lpass_cdc_txn *txn)
+{
+	struct lpass_cdc_priv *priv = NULL;
+	struct device *va_dev = NULL;
+	u32 num_io;
+
+	if (!txn || !txn->priv)
+		return;
+
+	priv = txn->priv;
+	va_dev = txn->va_dev;
+	mutex_lock(&priv->clk_lock);
+	num_io = priv->txn_io_cnt - txn->io_start;
+	priv->txn_cnt--;
+	lpass_cdc_txn_stats_update(&priv->txn_stats,
+				   ktime_us_delta(ktime_get(), txn->start),
+				   num_io);
+	mutex_unlock(&priv->clk_lock);
+	if (va_dev) {
+		pm_runtime_mark_last_busy(va_dev);
+		pm_runtime_put_autosuspend(va_dev);
+	}
+	txn->priv = NULL;
+}
+EXPORT_SYMBOL(lpass_cdc_txn_end);
 
 static int lpass_cdc_update_wcd_event(void *handle, u16 event, u32 data)
 {
@@ -835,9 +960,40 @@ static ssize_t lpass_cdc_version_read(struct snd_info_entry *entry,
 	return simple_read_from_buffer(buf, count, &pos, buffer, len);
 }
 
+static ssize_t lpass_cdc_txn_stats_read(struct snd_info_entry *entry,
+				   void *file_private_data,
+				   struct file *file,
+				   char __user *buf, size_t count,
+				   loff_t pos)
+{
+	struct lpass_cdc_priv *priv;
+	struct lpass_cdc_txn_stats stats;
+	char buffer[LPASS_CDC_TXN_STATS_ENTRY_SIZE];
+	int len = 0;
+
+	priv = (struct lpass_cdc_priv *) entry->private_data;
+	if (!priv) {
+		pr_err_ratelimited("%s: lpass_cdc priv is null\n", __func__);
+		return -EINVAL;
+	}
+
+	mutex_lock(&priv->clk_lock);
+	stats = priv->txn_stats;
+	mutex_unlock(&priv->clk_lock);
+
+	len = scnprintf(buffer, sizeof(buffer),
+			"txns: %llu\nio: %llu\nmax_io: %u\n"
+			"total_us: %llu\nlast_us: %u\nmax_us: %u\n",
+			stats.count, stats.num_io, stats.max_io,
+			stats.total_us, stats.last_us, stats.max_us);
+
+	return simple_read_from_buffer(buf, count, &pos, buffer, len);
+}
+
 static int lpass_cdc_ssr_enable(struct device *dev, void *data)
 {
 	struct lpass_cdc_priv *priv = data;
+	struct lpass_cdc_txn txn = {0};
 	int macro_idx;
 
 	if (priv->initial_boot) {
@@ -877,7 +1033,9 @@ static int lpass_cdc_ssr_enable(struct device *dev, void *data)
 	mutex_unlock(&priv->clk_lock);
 	regcache_mark_dirty(priv->regmap);
 	lpass_cdc_clk_rsc_enable_all_clocks(priv->clk_dev, true);
+	lpass_cdc_txn_begin(priv->component, &txn);
 	regcache_sync(priv->regmap);
+	lpass_cdc_txn_end(&txn);
 	/* Add a 100usec sleep to ensure last register write is done */
 	usleep_range(100,110);
 	lpass_cdc_clk_rsc_enable_all_clocks(priv->clk_dev, false);
@@ -929,6 +1087,10 @@ static struct snd_info_entry_ops lpass_cdc_info_ops = {
 	.read = lpass_cdc_version_read,
 };
 
+static struct snd_info_entry_ops lpass_cdc_txn_stats_ops = {
+	.read = lpass_cdc_txn_stats_read,
+};
+
 static const struct snd_event_ops lpass_cdc_ssr_ops = {
 	.enable = lpass_cdc_ssr_enable,
 	.disable = lpass_cdc_ssr_disable,
@@ -948,6 +1110,7 @@ int lpass_cdc_info_create_codec_entry(struct snd_info_entry *codec_root,
 				   struct snd_soc_component *component)
 {
 	struct snd_info_entry *version_entry;
+	struct snd_info_entry *txn_stats_entry;
 	struct lpass_cdc_priv *priv;
 	struct snd_soc_card *card;
 
@@ -996,6 +1159,23 @@ int lpass_cdc_info_create_codec_entry(struct snd_info_entry *codec_root,
 	}
 	priv->version_entry = version_entry;
 
+	txn_stats_entry = snd_info_create_card_entry(card->snd_card,
+						     "txn_stats",
+						     priv->entry);
+	if (!txn_stats_entry) {
+		dev_dbg(component->dev, "%s: failed to create txn_stats entry\n",
+			__func__);
+		return 0;
+	}
+
+	txn_stats_entry->private_data = priv;
+	txn_stats_entry->size = LPASS_CDC_TXN_STATS_ENTRY_SIZE;
+	txn_stats_entry->content = SNDRV_INFO_CONTENT_DATA;
+	txn_stats_entry->c.ops = &lpass_cdc_txn_stats_ops;
+
+	if (snd_info_register(txn_stats_entry) < 0)
+		snd_info_free_entry(txn_stats_entry);
+
 	return 0;
 }
 EXPORT_SYMBOL(lpass_cdc_info_create_codec_entry);
@@ -65,6 +65,16 @@ enum {
 
 };
 
+struct lpass_cdc_priv;
+
+/* handle for lpass_cdc_txn_begin()/lpass_cdc_txn_end() */
+struct lpass_cdc_txn {
+	struct lpass_cdc_priv *priv;
+	struct device *va_dev;
+	ktime_t start;
+	u32 io_start;
+};
+
 struct macro_ops {
 	int (*init)(struct snd_soc_component *component);
 	int (*exit)(struct snd_soc_component *component);
@@ -279,6 +289,9 @@ int lpass_cdc_tx_mclk_enable(struct snd_soc_component *c, bool enable);
 int lpass_cdc_get_version(struct device *dev);
 int lpass_cdc_dmic_clk_enable(struct snd_soc_component *component,
 			   u32 dmic, u32 tx_mode, bool enable);
+int lpass_cdc_txn_begin(struct snd_soc_component *component,
+			struct lpass_cdc_txn *txn);
+void lpass_cdc_txn_end(struct lpass_cdc_txn *txn);
 
 /* RX MACRO utilities */
 int lpass_cdc_rx_set_fir_capability(struct snd_soc_component *component,
@@ -377,6 +390,14 @@ static int lpass_cdc_tx_mclk_enable(struct snd_soc_component *c, bool enable)
 {
 	return 0;
 }
+static inline int lpass_cdc_txn_begin(struct snd_soc_component *component,
+				      struct lpass_cdc_txn *txn)
+{
+	return 0;
+}
+static inline void lpass_cdc_txn_end(struct lpass_cdc_txn *txn)
+{
+}
 /* RX MACRO utilities */
 static int lpass_cdc_rx_set_fir_capability(struct snd_soc_component *component,
 						bool capable)
@@ -16,6 +16,7 @@
 #include <linux/component.h>
 #include <linux/ratelimit.h>
 #include <linux/platform_device.h>
+#include <linux/ktime.h>
 #ifndef CONFIG_WCD934X_I2S
 #include <sound/wcd-dsp-mgr.h>
 #endif
@@ -90,6 +91,14 @@
  */
 #define WCD_SPI_RW_MAX_BUF_SIZE (WCD_SPI_RW_MULTI_MAX_LEN + 32)
 
+/*
+ * Section downloads are written through two bounce batches of this size.
+ * One batch is on the bus while the next one is being filled.
+ */
+#define WCD_SPI_DL_BATCH_SIZE   (2 * WCD_SPI_RW_MAX_BUF_SIZE)
+#define WCD_SPI_DL_NUM_BATCHES  (2)
+#define WCD_SPI_DL_MAX_XFERS    (16)
+
 /* Alignment requirements */
 #define WCD_SPI_RW_MIN_ALIGN    WCD_SPI_WORD_BYTE_CNT
 #define WCD_SPI_RW_MULTI_ALIGN  (16)
@@ -117,6 +126,18 @@ struct wcd_spi_debug_data {
 	struct dentry *dir;
 	u32 addr;
 	u32 size;
+	u32 dload_kbps;
+};
+
+/* One spi_message worth of write commands for a section download */
+struct wcd_spi_dl_batch {
+	struct spi_message msg;
+	struct spi_transfer xfer[WCD_SPI_DL_MAX_XFERS];
+	struct completion done;
+	u8 *buf;
+	size_t used;
+	int num_xfers;
+	bool busy;
 };
 
 struct wcd_spi_priv {
@@ -162,6 +183,12 @@ struct wcd_spi_priv {
 	/* DMA handles for transfer buffers */
 	dma_addr_t tx_dma;
 	dma_addr_t rx_dma;
+
+	/* Bounce buffer for chained section downloads, may be NULL */
+	void *dl_buf;
+	dma_addr_t dl_dma;
+	struct wcd_spi_dl_batch dl_batch[WCD_SPI_DL_NUM_BATCHES];
+
 	/* Handle to child (qmi client) device */
 	struct device *ac_dev;
 };
@@ -495,6 +522,166 @@ done:
 	return ret;
 }
 
+static void wcd_spi_dl_complete(void *context)
+{
+	struct wcd_spi_dl_batch *batch = context;
+
+	complete(&batch->done);
+}
+
+static int wcd_spi_dl_wait(struct spi_device *spi,
+			   struct wcd_spi_dl_batch *batch)
+{
+	int ret;
+
+	if (!batch->busy)
+		return 0;
+
+	wait_for_completion(&batch->done);
+	batch->busy = false;
+	ret = batch->msg.status;
+	if (ret)
+		dev_err(&spi->dev, "%s: batch of %d xfers failed, err %d\n",
+			__func__, batch->num_xfers, ret);
+	return ret;
+}
+
+static int wcd_spi_dl_submit(struct spi_device *spi,
+			     struct wcd_spi_dl_batch *batch)
+{
+	int i, ret;
+
+	if (!batch->num_xfers)
+		return 0;
+
+	spi_message_init(&batch->msg);
+	for (i = 0; i < batch->num_xfers; i++) {
+		/* Every command is its own chip select frame */
+		batch->xfer[i].cs_change = (i != batch->num_xfers - 1);
+		spi_message_add_tail(&batch->xfer[i], &batch->msg);
+	}
+	batch->msg.complete = wcd_spi_dl_complete;
+	batch->msg.context = batch;
+	reinit_completion(&batch->done);
+
+	ret = spi_async(spi, &batch->msg);
+	if (ret) {
+		dev_err(&spi->dev, "%s: spi_async failed, err %d\n",
+			__func__, ret);
+		return ret;
+	}
+	batch->busy = true;
+	return 0;
+}
+
+/*
+ * Queue one write command into the current batch. When the batch is
+ * full it is sent with spi_async() and filling continues in the other
+ * batch once that one has drained.
+ */
+static int wcd_spi_dl_queue(struct spi_device *spi, int *cur,
+			    u32 remote_addr, const u8 *data, size_t len)
+{
+	struct wcd_spi_priv *wcd_spi = spi_get_drvdata(spi);
+	struct wcd_spi_dl_batch *batch = &wcd_spi->dl_batch[*cur];
+	struct spi_transfer *xfer;
+	size_t cmd_len;
+	u32 frame = 0;
+	u8 *buf;
+	int ret;
+
+	cmd_len = (len == WCD_SPI_WORD_BYTE_CNT) ?
+		  WCD_SPI_WRITE_SINGLE_LEN : len + sizeof(frame);
+
+	if (batch->num_xfers == WCD_SPI_DL_MAX_XFERS ||
+	    batch->used + cmd_len > WCD_SPI_DL_BATCH_SIZE) {
+		ret = wcd_spi_dl_submit(spi, batch);
+		if (ret)
+			return ret;
+		*cur = (*cur + 1) % WCD_SPI_DL_NUM_BATCHES;
+		batch = &wcd_spi->dl_batch[*cur];
+		ret = wcd_spi_dl_wait(spi, batch);
+		if (ret)
+			return ret;
+		batch->used = 0;
+		batch->num_xfers = 0;
+	}
+
+	frame |= WCD_SPI_WRITE_FRAME_OPCODE;
+	frame |= (remote_addr & WCD_CMD_ADDR_MASK);
+	frame = cpu_to_be32(frame);
+
+	buf = batch->buf + batch->used;
+	memset(buf, 0, cmd_len);
+	memcpy(buf, &frame, sizeof(frame));
+	memcpy(buf + sizeof(frame), data, len);
+
+	xfer = &batch->xfer[batch->num_xfers++];
+	memset(xfer, 0, sizeof(*xfer));
+	xfer->tx_buf = buf;
+	xfer->len = cmd_len;
+	/* keep every command word aligned in the bounce buffer */
+	batch->used += ALIGN(cmd_len, WCD_SPI_WORD_BYTE_CNT);
+
+	return 0;
+}
+
+/*
+ * Same split as wcd_spi_transfer_split() for writes, but the commands
+ * are chained into spi_messages on the bounce buffer instead of one
+ * spi_sync() per command, and two batches keep the bus busy.
+ */
+static int wcd_spi_write_chain(struct spi_device *spi,
+			       struct wcd_spi_msg *data_msg)
+{
+	struct wcd_spi_priv *wcd_spi = spi_get_drvdata(spi);
+	u32 addr = data_msg->remote_addr;
+	u8 *data = data_msg->data;
+	size_t remain_size = data_msg->len;
+	size_t to_xfer;
+	int i, cur = 0, ret = 0, ret1;
+
+	for (i = 0; i < WCD_SPI_DL_NUM_BATCHES; i++) {
+		wcd_spi->dl_batch[i].used = 0;
+		wcd_spi->dl_batch[i].num_xfers = 0;
+	}
+
+	while (remain_size) {
+		if (!IS_ALIGNED(addr, WCD_SPI_RW_MULTI_ALIGN) ||
+		    remain_size < WCD_SPI_RW_MULTI_MIN_LEN)
+			to_xfer = WCD_SPI_WORD_BYTE_CNT;
+		else if (remain_size >= WCD_SPI_RW_MULTI_MAX_LEN)
+			to_xfer = WCD_SPI_RW_MULTI_MAX_LEN;
+		else
+			to_xfer = remain_size -
+				  (remain_size % WCD_SPI_RW_MULTI_MIN_LEN);
+
+		ret = wcd_spi_dl_queue(spi, &cur, addr, data, to_xfer);
+		if (ret) {
+			dev_err(&spi->dev,
+				"%s: queue fail addr (0x%x), size (0x%zx)\n",
+				__func__, addr, to_xfer);
+			break;
+		}
+
+		addr += to_xfer;
+		data += to_xfer;
+		remain_size -= to_xfer;
+	}
+
+	if (!ret)
+		ret = wcd_spi_dl_submit(spi, &wcd_spi->dl_batch[cur]);
+
+	/* Always drain both batches before the bounce buffer is reused */
+	for (i = 0; i < WCD_SPI_DL_NUM_BATCHES; i++) {
+		ret1 = wcd_spi_dl_wait(spi, &wcd_spi->dl_batch[i]);
+		if (!ret)
+			ret = ret1;
+	}
+
+	return ret;
+}
+
 static int wcd_spi_cmd_nop(struct spi_device *spi)
 {
 	struct wcd_spi_priv *wcd_spi = spi_get_drvdata(spi);
@@ -844,6 +1031,38 @@ done:
 	return ret;
 }
 
+static int __wcd_spi_data_xfer_chain(struct spi_device *spi,
+				     struct wcd_spi_msg *msg)
+{
+	struct wcd_spi_priv *wcd_spi = spi_get_drvdata(spi);
+	int ret;
+
+	if (!IS_ALIGNED(msg->remote_addr, WCD_SPI_RW_MIN_ALIGN) ||
+	    (msg->len % WCD_SPI_WORD_BYTE_CNT)) {
+		dev_err(&spi->dev,
+			"%s addr 0x%x or len 0x%zx is not aligned to 0x%x\n",
+			__func__, msg->remote_addr, msg->len,
+			WCD_SPI_RW_MIN_ALIGN);
+		return -EINVAL;
+	}
+
+	WCD_SPI_MUTEX_LOCK(spi, wcd_spi->clk_mutex);
+	if (wcd_spi_is_suspended(wcd_spi)) {
+		dev_dbg(&spi->dev,
+			"%s: SPI suspended, cannot perform transfer\n",
+			__func__);
+		ret = -EIO;
+		goto done;
+	}
+
+	WCD_SPI_MUTEX_LOCK(spi, wcd_spi->xfer_mutex);
+	ret = wcd_spi_write_chain(spi, msg);
+	WCD_SPI_MUTEX_UNLOCK(spi, wcd_spi->xfer_mutex);
+done:
+	WCD_SPI_MUTEX_UNLOCK(spi, wcd_spi->clk_mutex);
+	return ret;
+}
+
 static int wcd_spi_data_xfer(struct spi_device *spi,
 			     struct wcd_spi_msg *msg,
 			     enum xfer_request req)
@@ -935,6 +1154,8 @@ static int wdsp_spi_dload_section(struct spi_device *spi,
 	struct wcd_spi_priv *wcd_spi = spi_get_drvdata(spi);
 	struct wdsp_img_section *sec = data;
 	struct wcd_spi_msg msg;
+	ktime_t start;
+	s64 elapsed_us;
 	int ret;
 
 	dev_dbg(&spi->dev, "%s: addr = 0x%x, size = 0x%zx\n",
@@ -944,10 +1165,25 @@ static int wdsp_spi_dload_section(struct spi_device *spi,
 	msg.data = sec->data;
 	msg.len = sec->size;
 
-	ret = __wcd_spi_data_xfer(spi, &msg, WCD_SPI_XFER_WRITE);
-	if (ret < 0)
+	start = ktime_get();
+	if (wcd_spi->dl_buf && msg.len > WCD_SPI_WORD_BYTE_CNT)
+		ret = __wcd_spi_data_xfer_chain(spi, &msg);
+	else
+		ret = __wcd_spi_data_xfer(spi, &msg, WCD_SPI_XFER_WRITE);
+	if (ret < 0) {
 		dev_err(&spi->dev, "%s: fail addr (0x%x) size (0x%zx)\n",
 			__func__, msg.remote_addr, msg.len);
+		return ret;
+	}
+
+	elapsed_us = ktime_us_delta(ktime_get(), start);
+	if (elapsed_us > 0) {
+		/* bytes per usec * 1000000 / 1024 */
+		wcd_spi->debug_data.dload_kbps =
+			div64_s64((s64)msg.len * 1000000, elapsed_us * 1024);
+		dev_dbg(&spi->dev, "%s: 0x%zx bytes in %lld us\n",
+			__func__, msg.len, elapsed_us);
+	}
 	return ret;
 }
 
@@ -1292,6 +1528,8 @@ static int wcd_spi_debugfs_init(struct spi_device *spi)
 
 	debugfs_create_file("mem_read", 0444, dbg_data->dir,
 			    spi, &mem_read_fops);
+	debugfs_create_u32("dload_kbps", 0444, dbg_data->dir,
+			   &dbg_data->dload_kbps);
 done:
 	return rc;
 }
@@ -1442,7 +1680,7 @@ static int wcd_spi_component_bind(struct device *dev,
 {
 	struct spi_device *spi = to_spi_device(dev);
 	struct wcd_spi_priv *wcd_spi = spi_get_drvdata(spi);
-	int ret = 0;
+	int i, ret = 0;
 
 	wcd_spi->m_dev = master;
 	wcd_spi->m_ops = data;
@@ -1499,6 +1737,23 @@ static int wcd_spi_component_bind(struct device *dev,
 		ret = -ENOMEM;
 		goto done;
 	}
+
+	/*
+	 * Bounce buffer for chained section downloads. Downloads fall
+	 * back to the single transfer path if this cannot be allocated.
+	 */
+	wcd_spi->dl_buf = dma_alloc_coherent(&spi->dev,
+				WCD_SPI_DL_BATCH_SIZE * WCD_SPI_DL_NUM_BATCHES,
+				&wcd_spi->dl_dma, GFP_KERNEL);
+	if (!wcd_spi->dl_buf) {
+		dev_dbg(&spi->dev, "%s: no dload bounce buffer\n", __func__);
+		goto done;
+	}
+	for (i = 0; i < WCD_SPI_DL_NUM_BATCHES; i++) {
+		wcd_spi->dl_batch[i].buf = (u8 *)wcd_spi->dl_buf +
+					   i * WCD_SPI_DL_BATCH_SIZE;
+		init_completion(&wcd_spi->dl_batch[i].done);
+	}
 done:
 	return ret;
 }
@@ -1527,6 +1782,12 @@ static void wcd_spi_component_unbind(struct device *dev,
 			  wcd_spi->rx_buf, wcd_spi->rx_dma);
 	wcd_spi->tx_buf = NULL;
 	wcd_spi->rx_buf = NULL;
+
+	if (wcd_spi->dl_buf)
+		dma_free_coherent(&spi->dev,
+				  WCD_SPI_DL_BATCH_SIZE * WCD_SPI_DL_NUM_BATCHES,
+				  wcd_spi->dl_buf, wcd_spi->dl_dma);
+	wcd_spi->dl_buf = NULL;
 }
 
 static const struct component_ops wcd_spi_component_ops = {
@@ -2268,7 +2268,10 @@ static int wcd938x_event_notify(struct notifier_block *block,
 
 		wcd938x_init_reg(component);
 		regcache_mark_dirty(wcd938x->regmap);
+		/* restore the cache as one sorted bulk write */
+		regmap_swr_defer_begin(wcd938x->regmap);
 		regcache_sync(wcd938x->regmap);
+		regmap_swr_defer_end(wcd938x->regmap);
 		/* Initialize MBHC module */
 		mbhc = &wcd938x->mbhc->wcd_mbhc;
 		ret = wcd938x_mbhc_post_ssr_init(wcd938x->mbhc, component);
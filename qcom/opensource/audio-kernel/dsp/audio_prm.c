@@ -13,6 +13,9 @@
 #include <linux/jiffies.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <ipc/gpr-lite.h>
 #include <soc/snd_event.h>
 #include <dsp/audio_prm.h>
@@ -23,14 +26,36 @@
 #define MAX_RETRY_COUNT 3
 #define APM_READY_WAIT_DURATION 2
 #define GPR_SEND_PKT_APM_TIMEOUT_MS 0
+/* release of an audio clock is held back this long for a re-request */
+#define PRM_CLK_REL_DELAY_MS 20
+
+/* one outstanding PRM command, matched to its response by token */
+struct prm_req {
+	struct list_head node;
+	uint32_t token;
+	uint32_t status;
+	int err;
+	bool done;
+};
+
+/* audio clock voted through audio_prm_set_lpass_clk_cfg() */
+struct prm_clk_vote {
+	struct list_head node;
+	struct clk_cfg cfg;
+	bool rel_pending;
+	unsigned long rel_expires;
+};
 
 struct audio_prm {
 	struct gpr_device *adev;
 	wait_queue_head_t wait;
 	struct mutex lock;
-	bool resp_received;
-	atomic_t state;
-	atomic_t status;
+	spinlock_t req_lock;
+	struct list_head req_list;
+	atomic_t token;
+	struct mutex vote_lock;
+	struct list_head clk_votes;
+	struct delayed_work clk_rel_work;
 	int lpi_pcm_logging_enable;
 	bool is_adsp_up;
 };
@@ -39,6 +64,53 @@ static struct audio_prm g_prm;
 
 static bool is_apm_ready_check_done = false;
 
+static int audio_prm_set_lpass_clk_cfg_rel(struct clk_cfg *cfg);
+
+static struct prm_req *prm_find_req(uint32_t token)
+{
+	struct prm_req *req;
+
+	list_for_each_entry(req, &g_prm.req_list, node)
+		if (req->token == token)
+			return req;
+	return NULL;
+}
+
+static void prm_complete_req(uint32_t token, uint32_t status)
+{
+	struct prm_req *req;
+	unsigned long flags;
+
+	spin_lock_irqsave(&g_prm.req_lock, flags);
+	req = prm_find_req(token);
+	if (req) {
+		req->status = status;
+		req->done = true;
+	}
+	spin_unlock_irqrestore(&g_prm.req_lock, flags);
+
+	if (!req) {
+		pr_debug("%s: no request for token %u\n", __func__, token);
+		return;
+	}
+	wake_up(&g_prm.wait);
+}
+
+/* fail every outstanding request, the DSP will not answer them */
+static void prm_abort_reqs(int err)
+{
+	struct prm_req *req;
+	unsigned long flags;
+
+	spin_lock_irqsave(&g_prm.req_lock, flags);
+	list_for_each_entry(req, &g_prm.req_list, node) {
+		req->err = err;
+		req->done = true;
+	}
+	spin_unlock_irqrestore(&g_prm.req_lock, flags);
+	wake_up(&g_prm.wait);
+}
+
 static int audio_prm_callback(struct gpr_device *adev, void *data)
 {
 	struct gpr_hdr *hdr = (struct gpr_hdr *)data;
@@ -48,18 +120,14 @@ static int audio_prm_callback(struct gpr_device *adev, void *data)
 	switch (hdr->opcode) {
 	case GPR_IBASIC_RSP_RESULT:
 		pr_err("%s: Failed response received",__func__);
-		atomic_set(&g_prm.status, payload[1]);
-		g_prm.resp_received = true;
+		prm_complete_req(hdr->token, payload[1]);
 		break;
 	case PRM_CMD_RSP_REQUEST_HW_RSC:
 	case PRM_CMD_RSP_RELEASE_HW_RSC:
 		/* payload[1] contains the error status for response */
-		if (payload[1] != 0) {
-			atomic_set(&g_prm.status, payload[1]);
+		if (payload[1] != 0)
 			pr_err("%s: cmd = 0x%x returned error = 0x%x\n",
 				__func__, payload[0], payload[1]);
-		}
-		g_prm.resp_received = true;
 		/* payload[0] contains the param_ID for response */
 		switch (payload[0]) {
 		case PARAM_ID_RSC_AUDIO_HW_CLK:
@@ -68,32 +136,34 @@ static int audio_prm_callback(struct gpr_device *adev, void *data)
 			if (payload[1] != 0)
 				pr_err("%s: PRM command failed with error %d\n",
 					__func__, payload[1]);
-			atomic_set(&g_prm.state, payload[1]);
 			break;
 		default:
 			pr_err("%s: hit default case",__func__);
 			break;
 		};
+		prm_complete_req(hdr->token, payload[1]);
+		break;
 	default:
 		break;
 	};
-	if (g_prm.resp_received)
-		wake_up(&g_prm.wait);
 	return 0;
 }
 
+/*
+ * Send a PRM command. Each command carries its own token, so several
+ * callers can have commands in flight with the DSP at the same time;
+ * g_prm.lock only covers the send itself.
+ */
 static int prm_gpr_send_pkt(struct gpr_pkt *pkt, wait_queue_head_t *wait)
 {
+	struct prm_req req = { 0 };
+	unsigned long flags;
 	int ret = 0;
 	int retry;
 
 	mutex_lock(&g_prm.lock);
 	pr_debug("%s: enter",__func__);
 
-	if (wait)
-		atomic_set(&g_prm.state, 1);
-	atomic_set(&g_prm.status, 0);
-
 	if (g_prm.adev == NULL) {
 		pr_err("%s: apr is unregistered\n", __func__);
 		mutex_unlock(&g_prm.lock);
@@ -111,34 +181,113 @@ static int prm_gpr_send_pkt(struct gpr_pkt *pkt, wait_queue_head_t *wait)
 		is_apm_ready_check_done = true;
 		pr_info("%s: apm ready check done\n", __func__);
 	}
-	g_prm.resp_received = false;
-	ret = gpr_send_pkt(g_prm.adev, pkt);
-	if (ret < 0) {
-		pr_err("%s: packet not transmitted %d\n", __func__, ret);
-		mutex_unlock(&g_prm.lock);
-		return ret;
-	}
 
+	/* token 0 is what legacy commands use, never hand it out */
+	do {
+		req.token = atomic_inc_return(&g_prm.token);
+	} while (!req.token);
+	pkt->hdr.token = req.token;
 	if (wait) {
-		ret = wait_event_timeout(g_prm.wait,
-				(g_prm.resp_received),
+		spin_lock_irqsave(&g_prm.req_lock, flags);
+		list_add_tail(&req.node, &g_prm.req_list);
+		spin_unlock_irqrestore(&g_prm.req_lock, flags);
+	}
+
+	ret = gpr_send_pkt(g_prm.adev, pkt);
+	mutex_unlock(&g_prm.lock);
+	if (ret < 0)
+		pr_err("%s: packet not transmitted %d\n", __func__, ret);
+	else if (wait)
+		wait_event_timeout(*wait, READ_ONCE(req.done),
 				msecs_to_jiffies(2 * TIMEOUT_MS));
-		if (!ret) {
-			pr_err("%s: pkt send timeout\n", __func__);
-			ret = -ETIMEDOUT;
-		} else if (atomic_read(&g_prm.status) > 0) {
-			pr_err("%s: DSP returned error %d\n", __func__,
-				atomic_read(&g_prm.status));
-			ret = -EINVAL;
-		} else {
-			ret = 0;
-		}
+
+	if (!wait)
+		goto done;
+
+	/* once unlinked the callback can no longer update req */
+	spin_lock_irqsave(&g_prm.req_lock, flags);
+	list_del(&req.node);
+	spin_unlock_irqrestore(&g_prm.req_lock, flags);
+	if (ret < 0)
+		goto done;
+
+	if (!req.done) {
+		pr_err("%s: pkt send timeout, token %u\n", __func__,
+			req.token);
+		ret = -ETIMEDOUT;
+	} else if (req.err) {
+		ret = req.err;
+	} else if (req.status > 0) {
+		pr_err("%s: DSP returned error %d\n", __func__,
+			req.status);
+		ret = -EINVAL;
+	} else {
+		ret = 0;
 	}
+done:
 	pr_debug("%s: exit",__func__);
-	mutex_unlock(&g_prm.lock);
 	return ret;
 }
 
+static struct prm_clk_vote *prm_find_clk_vote(uint32_t clk_id)
+{
+	struct prm_clk_vote *vote;
+
+	list_for_each_entry(vote, &g_prm.clk_votes, node)
+		if (vote->cfg.clk_id == clk_id)
+			return vote;
+	return NULL;
+}
+
+/* send the releases whose coalescing window has run out */
+static void prm_clk_rel_work_fn(struct work_struct *work)
+{
+	struct prm_clk_vote *vote, *tmp;
+	unsigned long next = 0;
+	bool rearm = false;
+	int ret;
+
+	mutex_lock(&g_prm.vote_lock);
+	list_for_each_entry_safe(vote, tmp, &g_prm.clk_votes, node) {
+		if (!vote->rel_pending)
+			continue;
+		if (time_before(jiffies, vote->rel_expires)) {
+			if (!rearm || time_before(vote->rel_expires, next))
+				next = vote->rel_expires;
+			rearm = true;
+			continue;
+		}
+		/*
+		 * Sent with vote_lock held so that a new request for the
+		 * same clock cannot overtake this release.
+		 */
+		ret = audio_prm_set_lpass_clk_cfg_rel(&vote->cfg);
+		if (ret < 0)
+			pr_err("%s: clk 0x%x release failed %d\n", __func__,
+				vote->cfg.clk_id, ret);
+		list_del(&vote->node);
+		kfree(vote);
+	}
+	if (rearm)
+		schedule_delayed_work(&g_prm.clk_rel_work,
+				      next > jiffies ? next - jiffies : 0);
+	mutex_unlock(&g_prm.vote_lock);
+}
+
+/* the DSP dropped all votes, forget the ones we track */
+static void prm_clk_votes_reset(void)
+{
+	struct prm_clk_vote *vote, *tmp;
+
+	mutex_lock(&g_prm.vote_lock);
+	cancel_delayed_work(&g_prm.clk_rel_work);
+	list_for_each_entry_safe(vote, tmp, &g_prm.clk_votes, node) {
+		list_del(&vote->node);
+		kfree(vote);
+	}
+	mutex_unlock(&g_prm.vote_lock);
+}
+
 void audio_prm_set_lpi_logging_status(int lpi_pcm_logging_enable)
 {
 	g_prm.lpi_pcm_logging_enable = lpi_pcm_logging_enable;
@@ -167,7 +316,6 @@ int audio_prm_set_lpass_hw_core_req(struct clk_cfg *cfg, uint32_t hw_core_id, ui
         pkt->hdr.dst_port = PRM_MODULE_INSTANCE_ID;
         pkt->hdr.dst_domain_id = GPR_IDS_DOMAIN_ID_ADSP_V;
         pkt->hdr.src_domain_id = GPR_IDS_DOMAIN_ID_APPS_V;
-        pkt->hdr.token = 0; /* TBD */
 	if (enable)
 		pkt->hdr.opcode = PRM_CMD_REQUEST_HW_RSC;
 	else
@@ -221,7 +369,6 @@ int audio_prm_set_lpass_core_clk_req(struct clk_cfg *cfg, uint32_t hw_core_id, u
 	pkt->hdr.dst_port = PRM_MODULE_INSTANCE_ID;
 	pkt->hdr.dst_domain_id = GPR_IDS_DOMAIN_ID_ADSP_V;
 	pkt->hdr.src_domain_id = GPR_IDS_DOMAIN_ID_APPS_V;
-	pkt->hdr.token = 0; /* TBD */
 	if (enable)
 		pkt->hdr.opcode = PRM_CMD_REQUEST_HW_RSC;
 	else
@@ -277,7 +424,6 @@ static int audio_prm_set_lpass_clk_cfg_req(struct clk_cfg *cfg)
 	pkt->hdr.dst_port = PRM_MODULE_INSTANCE_ID;
 	pkt->hdr.dst_domain_id = GPR_IDS_DOMAIN_ID_ADSP_V;
 	pkt->hdr.src_domain_id = GPR_IDS_DOMAIN_ID_APPS_V;
-	pkt->hdr.token = 0; /* TBD */
 	pkt->hdr.opcode = PRM_CMD_REQUEST_HW_RSC;
 
 	//pr_err("%s: clk_id %d size of cmd_req %ld \n",__func__, cfg->clk_id, sizeof(prm_cmd_request_rsc_t));
@@ -341,7 +487,6 @@ static int audio_prm_set_lpass_clk_cfg_rel(struct clk_cfg *cfg)
         pkt->hdr.dst_port = PRM_MODULE_INSTANCE_ID;
         pkt->hdr.dst_domain_id = GPR_IDS_DOMAIN_ID_ADSP_V;
         pkt->hdr.src_domain_id = GPR_IDS_DOMAIN_ID_APPS_V;
-        pkt->hdr.token = 0; /* TBD */
         pkt->hdr.opcode = PRM_CMD_RELEASE_HW_RSC;
 
         //pr_err("%s: clk_id %d size of cmd_req %ld \n",__func__, cfg->clk_id, sizeof(prm_cmd_release_rsc_t));
@@ -396,7 +541,6 @@ int audio_prm_set_cdc_earpa_duty_cycling_req(struct prm_earpa_hw_intf_config *ea
 	pkt->hdr.dst_port = PRM_MODULE_INSTANCE_ID;
 	pkt->hdr.dst_domain_id = GPR_IDS_DOMAIN_ID_ADSP_V;
 	pkt->hdr.src_domain_id = GPR_IDS_DOMAIN_ID_APPS_V;
-	pkt->hdr.token = 0;
 	if (enable)
 		pkt->hdr.opcode = PRM_CMD_REQUEST_HW_RSC;
 	else
@@ -481,7 +625,6 @@ int audio_prm_set_vote_against_sleep(uint8_t enable)
 	pkt->hdr.dst_port = PRM_MODULE_INSTANCE_ID;
 	pkt->hdr.dst_domain_id = GPR_IDS_DOMAIN_ID_ADSP_V;
 	pkt->hdr.src_domain_id = GPR_IDS_DOMAIN_ID_APPS_V;
-	pkt->hdr.token = 0; /* TBD */
 
 	if (enable)
 		pkt->hdr.opcode = PRM_CMD_REQUEST_HW_RSC;
@@ -513,13 +656,85 @@ int audio_prm_set_vote_against_sleep(uint8_t enable)
 }
 EXPORT_SYMBOL(audio_prm_set_vote_against_sleep);
 
+/*
+ * Audio clocks are toggled off and straight back on when streams are
+ * closed and reopened. A release is therefore held back for
+ * PRM_CLK_REL_DELAY_MS; a request for the same clock and configuration
+ * within that window cancels it and neither goes to the DSP.
+ */
+static int audio_prm_clk_vote(struct clk_cfg *clk)
+{
+	struct prm_clk_vote *vote;
+	int ret = 0;
+
+	mutex_lock(&g_prm.vote_lock);
+	vote = prm_find_clk_vote(clk->clk_id);
+	if (vote && vote->rel_pending) {
+		if (!memcmp(&vote->cfg, clk, sizeof(*clk))) {
+			vote->rel_pending = false;
+			pr_debug("%s: clk 0x%x release coalesced\n", __func__,
+				clk->clk_id);
+			goto unlock;
+		}
+		/* configuration changed, the old vote has to go first */
+		ret = audio_prm_set_lpass_clk_cfg_rel(&vote->cfg);
+		if (ret < 0)
+			pr_err("%s: clk 0x%x release failed %d\n", __func__,
+				clk->clk_id, ret);
+		vote->rel_pending = false;
+	}
+	mutex_unlock(&g_prm.vote_lock);
+
+	ret = audio_prm_set_lpass_clk_cfg_req(clk);
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&g_prm.vote_lock);
+	vote = prm_find_clk_vote(clk->clk_id);
+	if (!vote) {
+		vote = kzalloc(sizeof(*vote), GFP_KERNEL);
+		if (!vote)
+			goto unlock;
+		list_add_tail(&vote->node, &g_prm.clk_votes);
+	}
+	vote->cfg = *clk;
+	vote->rel_pending = false;
+unlock:
+	mutex_unlock(&g_prm.vote_lock);
+	return ret;
+}
+
+static int audio_prm_clk_unvote(struct clk_cfg *clk)
+{
+	struct prm_clk_vote *vote;
+
+	mutex_lock(&g_prm.vote_lock);
+	vote = prm_find_clk_vote(clk->clk_id);
+	if (vote) {
+		/* a repeat unvote must not release the clock a second time */
+		if (!vote->rel_pending) {
+			vote->rel_pending = true;
+			vote->rel_expires = jiffies +
+					msecs_to_jiffies(PRM_CLK_REL_DELAY_MS);
+			schedule_delayed_work(&g_prm.clk_rel_work,
+					msecs_to_jiffies(PRM_CLK_REL_DELAY_MS));
+		}
+		mutex_unlock(&g_prm.vote_lock);
+		return 0;
+	}
+	mutex_unlock(&g_prm.vote_lock);
+
+	/* not voted through us, let the DSP sort it out */
+	return audio_prm_set_lpass_clk_cfg_rel(clk);
+}
+
 int audio_prm_set_lpass_clk_cfg (struct clk_cfg *clk, uint8_t enable)
 {
 	int ret = 0;
 	if (enable)
-		ret = audio_prm_set_lpass_clk_cfg_req (clk);
+		ret = audio_prm_clk_vote(clk);
 	else
-		ret = audio_prm_set_lpass_clk_cfg_rel (clk);
+		ret = audio_prm_clk_unvote(clk);
 	return ret;
 }
 EXPORT_SYMBOL(audio_prm_set_lpass_clk_cfg);
@@ -536,6 +751,8 @@ static int audio_prm_service_cb(struct notifier_block *this,
 		is_apm_ready_check_done = false;
 		g_prm.is_adsp_up = false;
 		mutex_unlock(&g_prm.lock);
+		prm_abort_reqs(-ENETRESET);
+		prm_clk_votes_reset();
 		break;
 	case AUDIO_NOTIFIER_SERVICE_UP:
 		mutex_lock(&g_prm.lock);
@@ -595,6 +812,8 @@ static int audio_prm_remove(struct gpr_device *adev)
 	g_prm.is_adsp_up = false;
 	g_prm.adev = NULL;
 	mutex_unlock(&g_prm.lock);
+	prm_abort_reqs(-ENODEV);
+	prm_clk_votes_reset();
 	return ret;
 }
 
@@ -623,12 +842,20 @@ static int __init audio_prm_module_init(void)
 		pr_err("%s: gpr driver register failed = %d\n", __func__, ret);
 
 	mutex_init(&g_prm.lock);
+	spin_lock_init(&g_prm.req_lock);
+	INIT_LIST_HEAD(&g_prm.req_list);
+	mutex_init(&g_prm.vote_lock);
+	INIT_LIST_HEAD(&g_prm.clk_votes);
+	INIT_DELAYED_WORK(&g_prm.clk_rel_work, prm_clk_rel_work_fn);
 
 	return ret;
 }
 
 static void __exit audio_prm_module_exit(void)
 {
+	cancel_delayed_work_sync(&g_prm.clk_rel_work);
+	prm_clk_votes_reset();
+	mutex_destroy(&g_prm.vote_lock);
 	mutex_destroy(&g_prm.lock);
 	gpr_driver_unregister(&qcom_audio_prm_driver);
 }
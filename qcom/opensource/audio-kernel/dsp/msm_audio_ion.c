@@ -12,6 +12,8 @@
 #include <linux/slab.h>
 #include <linux/mutex.h>
 #include <linux/list.h>
+#include <linux/hashtable.h>
+#include <linux/rcupdate.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma-buf.h>
 #include <linux/dma-buf-map.h>
@@ -66,10 +68,17 @@ struct msm_audio_alloc_data {
 	struct list_head list;
 };
 
+#define MSM_AUDIO_FD_HASH_BITS 6
+
 struct msm_audio_ion_fd_list_private {
 	struct mutex list_mutex;
 	/*list to store fd, phy. addr and handle data */
 	struct list_head fd_list;
+	/*
+	 * fd index of the same entries. Updates are done under list_mutex,
+	 * fd lookups only take rcu_read_lock.
+	 */
+	DECLARE_HASHTABLE(fd_hash, MSM_AUDIO_FD_HASH_BITS);
 };
 
 static struct msm_audio_ion_fd_list_private msm_audio_ion_fd_list = {0,};
@@ -83,6 +92,8 @@ struct msm_audio_fd_data {
 	void *vaddr;
 	struct device *dev;
 	struct list_head list;
+	struct hlist_node hnode;
+	struct rcu_head rcu;
 	bool hyp_assign;
 };
 
@@ -379,21 +390,41 @@ void msm_audio_fd_list_debug(void)
 	}
 }
 
-void msm_audio_update_fd_list(struct msm_audio_fd_data *msm_audio_fd_data)
+/* Caller holds rcu_read_lock or list_mutex */
+static struct msm_audio_fd_data *msm_audio_find_fd_entry(int fd)
 {
-	struct msm_audio_fd_data *msm_audio_fd_data1 = NULL;
+	struct msm_audio_fd_data *msm_audio_fd_data = NULL;
 
+	hash_for_each_possible_rcu(msm_audio_ion_fd_list.fd_hash,
+			msm_audio_fd_data, hnode, fd,
+			lockdep_is_held(&msm_audio_ion_fd_list.list_mutex)) {
+		if (msm_audio_fd_data->fd == fd)
+			return msm_audio_fd_data;
+	}
+	return NULL;
+}
+
+/* Caller holds list_mutex */
+static void msm_audio_remove_fd_entry(struct msm_audio_fd_data *msm_audio_fd_data)
+{
+	hash_del_rcu(&msm_audio_fd_data->hnode);
+	list_del(&msm_audio_fd_data->list);
+	kfree_rcu(msm_audio_fd_data, rcu);
+}
+
+void msm_audio_update_fd_list(struct msm_audio_fd_data *msm_audio_fd_data)
+{
 	mutex_lock(&(msm_audio_ion_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data1,
-			&msm_audio_ion_fd_list.fd_list, list) {
-		if (msm_audio_fd_data1->fd == msm_audio_fd_data->fd) {
-			pr_err("%s fd already present, not updating the list",
-				__func__);
-			mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
-			return;
-		}
+	if (msm_audio_find_fd_entry(msm_audio_fd_data->fd)) {
+		pr_err("%s fd already present, not updating the list",
+			__func__);
+		mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
+		return;
 	}
 	list_add_tail(&msm_audio_fd_data->list, &msm_audio_ion_fd_list.fd_list);
+	/* Publish last, lockless lookups may see the entry from here on */
+	hash_add_rcu(msm_audio_ion_fd_list.fd_hash, &msm_audio_fd_data->hnode,
+		msm_audio_fd_data->fd);
 	mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
 }
 
@@ -415,8 +446,7 @@ void msm_audio_delete_fd_entry(void *handle)
 		if (msm_audio_fd_data->handle == handle) {
 			pr_debug("%s deleting handle %pK entry from list\n",
 				__func__, handle);
-			list_del(&(msm_audio_fd_data->list));
-			kfree(msm_audio_fd_data);
+			msm_audio_remove_fd_entry(msm_audio_fd_data);
 			break;
 		}
 	}
@@ -433,21 +463,17 @@ int msm_audio_get_buf_addr(int fd, dma_addr_t *paddr, void **vaddr, size_t *pa_l
 		return status;
 	}
 	pr_debug("%s, fd %d\n", __func__, fd);
-	mutex_lock(&(msm_audio_ion_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data,
-			&msm_audio_ion_fd_list.fd_list, list) {
-		if (msm_audio_fd_data->fd == fd) {
-			*paddr  = msm_audio_fd_data->paddr;
-			*vaddr  = msm_audio_fd_data->vaddr;
-			*pa_len = msm_audio_fd_data->plen;
-			status  = 0;
-			pr_debug("%s Found fd %d paddr %pK\n",
-				__func__, fd, paddr);
-			mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
-			return status;
-		}
+	rcu_read_lock();
+	msm_audio_fd_data = msm_audio_find_fd_entry(fd);
+	if (msm_audio_fd_data) {
+		*paddr  = msm_audio_fd_data->paddr;
+		*vaddr  = msm_audio_fd_data->vaddr;
+		*pa_len = msm_audio_fd_data->plen;
+		status  = 0;
+		pr_debug("%s Found fd %d paddr %pK\n",
+			__func__, fd, paddr);
 	}
-	mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
+	rcu_read_unlock();
 	return status;
 }
 EXPORT_SYMBOL(msm_audio_get_buf_addr);
@@ -462,20 +488,16 @@ int msm_audio_get_phy_addr(int fd, dma_addr_t *paddr, size_t *pa_len)
 		return status;
 	}
 	pr_debug("%s, fd %d\n", __func__, fd);
-	mutex_lock(&(msm_audio_ion_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data,
-			&msm_audio_ion_fd_list.fd_list, list) {
-		if (msm_audio_fd_data->fd == fd) {
-			*paddr = msm_audio_fd_data->paddr;
-			*pa_len = msm_audio_fd_data->plen;
-			status = 0;
-			pr_debug("%s Found fd %d paddr %pK\n",
-				__func__, fd, paddr);
-			mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
-			return status;
-		}
+	rcu_read_lock();
+	msm_audio_fd_data = msm_audio_find_fd_entry(fd);
+	if (msm_audio_fd_data) {
+		*paddr = msm_audio_fd_data->paddr;
+		*pa_len = msm_audio_fd_data->plen;
+		status = 0;
+		pr_debug("%s Found fd %d paddr %pK\n",
+			__func__, fd, paddr);
 	}
-	mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
+	rcu_read_unlock();
 	return status;
 }
 EXPORT_SYMBOL(msm_audio_get_phy_addr);
@@ -487,15 +509,11 @@ static int msm_audio_set_hyp_assign(int fd, bool assign)
 	pr_debug("%s, fd %d\n", __func__, fd);
 
 	mutex_lock(&(msm_audio_ion_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data,
-			&msm_audio_ion_fd_list.fd_list, list) {
-		if (msm_audio_fd_data->fd == fd) {
-			status = 0;
-			pr_debug("%s Found fd %d\n", __func__, fd);
-			msm_audio_fd_data->hyp_assign = assign;
-			mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
-			return status;
-		}
+	msm_audio_fd_data = msm_audio_find_fd_entry(fd);
+	if (msm_audio_fd_data) {
+		status = 0;
+		pr_debug("%s Found fd %d\n", __func__, fd);
+		msm_audio_fd_data->hyp_assign = assign;
 	}
 	mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
 	return status;
@@ -506,17 +524,14 @@ void msm_audio_get_handle(int fd, void **handle)
 	struct msm_audio_fd_data *msm_audio_fd_data = NULL;
 
 	pr_debug("%s fd %d\n", __func__, fd);
-	mutex_lock(&(msm_audio_ion_fd_list.list_mutex));
 	*handle = NULL;
-	list_for_each_entry(msm_audio_fd_data,
-			&msm_audio_ion_fd_list.fd_list, list) {
-		if (msm_audio_fd_data->fd == fd) {
-			*handle = (struct dma_buf *)msm_audio_fd_data->handle;
-			pr_debug("%s handle %pK\n", __func__, *handle);
-			break;
-		}
+	rcu_read_lock();
+	msm_audio_fd_data = msm_audio_find_fd_entry(fd);
+	if (msm_audio_fd_data) {
+		*handle = (struct dma_buf *)msm_audio_fd_data->handle;
+		pr_debug("%s handle %pK\n", __func__, *handle);
 	}
-	mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
+	rcu_read_unlock();
 }
 
 /**
@@ -682,10 +697,8 @@ void msm_audio_ion_crash_handler(void)
 		if(ptr) {
 			msm_audio_fd_data = list_entry(ptr, struct msm_audio_fd_data,
 							list);
-			if(msm_audio_fd_data) {
-				list_del(&(msm_audio_fd_data->list));
-				kfree(msm_audio_fd_data);
-			}
+			if(msm_audio_fd_data)
+				msm_audio_remove_fd_entry(msm_audio_fd_data);
 		}
 	}
 	mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
@@ -977,6 +990,7 @@ static int msm_audio_ion_probe(struct platform_device *pdev)
 	dev_set_drvdata(dev, msm_audio_ion_data);
 	if (!msm_audio_ion_fd_list_init) {
 		INIT_LIST_HEAD(&msm_audio_ion_fd_list.fd_list);
+		hash_init(msm_audio_ion_fd_list.fd_hash);
 		mutex_init(&(msm_audio_ion_fd_list.list_mutex));
 		msm_audio_ion_fd_list_init = true;
 	}
@@ -237,6 +237,8 @@ struct gpr_pkt {
 #define GPR_SVC_MAJOR_VERSION(v)	((v >> 16) & 0xFF)
 #define GPR_SVC_MINOR_VERSION(v)	(v & 0xFF)
 
+struct gpr_svc_stats;
+
 struct gpr_device {
 	struct device	dev;
 	uint16_t	svc_id;
@@ -245,6 +247,7 @@ struct gpr_device {
 	char name[GPR_NAME_SIZE];
 	spinlock_t	lock;
 	struct list_head node;
+	struct gpr_svc_stats *stats;
 };
 
 #define to_gpr_device(d) container_of(d, struct gpr_device, dev)
@@ -78,6 +78,9 @@ struct regmap *__devm_regmap_init_swr(struct swr_device *dev,
 	__regmap_lockdep_wrapper(__devm_regmap_init_swr, #config,       \
 				swr, config)
 
+int regmap_swr_defer_begin(struct regmap *map);
+int regmap_swr_defer_end(struct regmap *map);
+
 /* Indicates soundwire devices group information */
 enum {
 	SWR_GROUP_NONE = 0,
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-2.0-only WITH Linux-syscall-note */
+/*
+ * Copyright (c) 2023, Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+#ifndef _UAPI_AUDIO_PKT_H_
+#define _UAPI_AUDIO_PKT_H_
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define AUDIO_PKT_IOCTL_MAGIC		'p'
+
+/* read() returns one packet per call, truncated to the buffer size */
+#define AUDIO_PKT_RX_MODE_SINGLE	0
+/* read() returns as many whole packets as fit in the buffer */
+#define AUDIO_PKT_RX_MODE_MULTI		1
+
+/* Select the read() mode for this open file from a __u32, default is single */
+#define AUDIO_PKT_IOCTL_SET_RX_MODE	_IOW(AUDIO_PKT_IOCTL_MAGIC, 1, __u32)
+
+/*
+ * mmap receive ring
+ *
+ * Mapping one page plus AUDIO_PKT_RING_DATA_SIZE bytes at offset 0 of the
+ * device gives a header page followed by the data area at data_offset. While the ring is mapped
+ * incoming packets are copied into the data area as records of a __u32
+ * length followed by the packet, padded to 4 bytes. A length of
+ * AUDIO_PKT_RING_WRAP means the next record starts at offset 0.
+ *
+ * The kernel advances write_idx, the reader advances read_idx once it has
+ * consumed a record. Both are byte offsets into the data area and the ring
+ * is empty when they are equal. Packets that do not fit are counted in
+ * overflow and queued for read(); they are always newer than the packets
+ * in the ring, so draining the ring before calling read() keeps order.
+ *
+ * The ring receives every packet for the device, so it can only be mapped
+ * through the sole open file of the device, and open() fails with EBUSY
+ * while the ring is mapped.
+ */
+#define AUDIO_PKT_RING_DATA_SIZE	(64 * 1024)
+#define AUDIO_PKT_RING_WRAP		0xFFFFFFFF
+
+struct audio_pkt_ring_hdr {
+	__u32 write_idx;
+	__u32 read_idx;
+	__u32 size;
+	__u32 data_offset;
+	__u32 overflow;
+};
+
+#endif /* _UAPI_AUDIO_PKT_H_ */
@@ -27,6 +27,9 @@
 #include <linux/fs.h>
 #include <linux/uaccess.h>
 #include <linux/termios.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/audio_pkt.h>
 #include <ipc/gpr-lite.h>
 #include <dsp/spf-core.h>
 #include <dsp/msm_audio_ion.h>
@@ -64,6 +67,7 @@ do {									      \
 #define AUDPKT_DRIVER_NAME "aud_pasthru_adsp"
 #define CHANNEL_NAME "adsp_apps"
 #define MAX_PACKET_SIZE 4096
+#define AUDIO_PKT_RING_MAP_SIZE (PAGE_SIZE + AUDIO_PKT_RING_DATA_SIZE)
 
 
 enum audio_pkt_state {
@@ -85,6 +89,11 @@ enum audio_pkt_state {
  * @ch_name:	audio channel to match to
  * @audio_pkt_major: Major number of audio pkt driver
  * @audio_pkt_class: audio pkt class pointer
+ * @ring:	mmap receive ring header, NULL while the ring is not mapped
+ * @ring_buf:	backing memory of the receive ring, kept across mappings
+ * @ring_write:	kernel copy of the ring write index
+ * @ring_users:	number of vmas mapping the ring, protected by @lock
+ * @open_cnt:	number of open files, protected by @lock
  */
 struct audio_pkt_device {
 	struct device *dev;
@@ -100,6 +109,12 @@ struct audio_pkt_device {
 
 	dev_t audio_pkt_major;
 	struct class *audio_pkt_class;
+
+	struct audio_pkt_ring_hdr *ring;
+	void *ring_buf;
+	u32 ring_write;
+	int ring_users;
+	int open_cnt;
 };
 
 struct audio_pkt_priv {
@@ -113,6 +128,16 @@ struct audio_pkt_priv {
 
 static struct audio_pkt_priv *ap_priv;
 
+/**
+ * struct audio_pkt_client - per open file state
+ * @ap_priv:	driver private data
+ * @rx_mode:	AUDIO_PKT_RX_MODE_* used by read()
+ */
+struct audio_pkt_client {
+	struct audio_pkt_priv *ap_priv;
+	u32 rx_mode;
+};
+
 
 struct audio_pkt_apm_cmd_shared_mem_map_regions_t {
 	uint16_t mem_pool_id;
@@ -156,8 +181,26 @@ struct audio_pkt_clnt_ch {
 int audio_pkt_open(struct inode *inode, struct file *file)
 {
 	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
+	struct audio_pkt_client *client;
+
 	AUDIO_PKT_INFO("%s: for %s \n", __func__,audpkt_dev->ch_name);
-	file->private_data = ap_priv;
+	client = kzalloc(sizeof(*client), GFP_KERNEL);
+	if (!client)
+		return -ENOMEM;
+
+	/* the mapped ring takes every packet, other readers would starve */
+	mutex_lock(&audpkt_dev->lock);
+	if (audpkt_dev->ring_users) {
+		mutex_unlock(&audpkt_dev->lock);
+		kfree(client);
+		return -EBUSY;
+	}
+	audpkt_dev->open_cnt++;
+	mutex_unlock(&audpkt_dev->lock);
+
+	client->ap_priv = ap_priv;
+	client->rx_mode = AUDIO_PKT_RX_MODE_SINGLE;
+	file->private_data = client;
 	return 0;
 }
 
@@ -172,7 +215,8 @@ int audio_pkt_open(struct inode *inode, struct file *file)
  */
 int audio_pkt_release(struct inode *inode, struct file *file)
 {
-	struct audio_pkt_priv *ap_priv = file->private_data;
+	struct audio_pkt_client *client = file->private_data;
+	struct audio_pkt_priv *ap_priv = client->ap_priv;
 	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
 
 	struct sk_buff *skb;
@@ -194,7 +238,12 @@ int audio_pkt_release(struct inode *inode, struct file *file)
 	wake_up_interruptible(&audpkt_dev->readq);
 	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
 
+	mutex_lock(&audpkt_dev->lock);
+	audpkt_dev->open_cnt--;
+	mutex_unlock(&audpkt_dev->lock);
+
 	file->private_data = NULL;
+	kfree(client);
 	spf_core_apm_close_all();
 	msm_audio_ion_crash_handler();
 
@@ -228,6 +277,27 @@ static int audio_pkt_internal_release(struct platform_device *adev)
 	return 0;
 }
 
+/*
+ * Dequeue as many whole packets as fit in @count, at least one. Called with
+ * queue_lock held and a non-empty queue.
+ */
+static void audio_pkt_dequeue_multi(struct audio_pkt_device *audpkt_dev,
+				    struct sk_buff_head *batch, size_t count)
+{
+	struct sk_buff *skb;
+	size_t len = 0;
+
+	while ((skb = skb_peek(&audpkt_dev->queue)) != NULL) {
+		if (len && skb->len > count - len)
+			break;
+		__skb_unlink(skb, &audpkt_dev->queue);
+		__skb_queue_tail(batch, skb);
+		len += skb->len;
+		if (len >= count)
+			break;
+	}
+}
+
 /**
  * audio_pkt_read() - read() syscall for the audio_pkt device
  * file:	Pointer to the file structure.
@@ -242,13 +312,16 @@ static int audio_pkt_internal_release(struct platform_device *adev)
 ssize_t audio_pkt_read(struct file *file, char __user *buf,
 		       size_t count, loff_t *ppos)
 {
-	struct audio_pkt_priv *ap_priv = file->private_data;
+	struct audio_pkt_client *client = file->private_data;
+	struct audio_pkt_priv *ap_priv = client->ap_priv;
 	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
 
 	unsigned long flags;
+	struct sk_buff_head batch;
 	struct sk_buff *skb;
-	int use;
-	uint32_t *temp;
+	size_t copied = 0;
+	ssize_t ret = 0;
+	size_t use;
 
 	if (!audpkt_dev) {
 		AUDIO_PKT_ERR("invalid device handle\n");
@@ -280,18 +353,27 @@ ssize_t audio_pkt_read(struct file *file, char __user *buf,
 		spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
 	}
 
-	skb = skb_dequeue(&audpkt_dev->queue);
+	__skb_queue_head_init(&batch);
+	if (client->rx_mode == AUDIO_PKT_RX_MODE_MULTI) {
+		audio_pkt_dequeue_multi(audpkt_dev, &batch, count);
+	} else {
+		skb = __skb_dequeue(&audpkt_dev->queue);
+		if (skb)
+			__skb_queue_tail(&batch, skb);
+	}
 	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
-	if (!skb)
+	if (skb_queue_empty(&batch))
 		return -EFAULT;
 
-	use = min_t(size_t, count, skb->len);
-	if (copy_to_user(buf, skb->data, use))
-		use = -EFAULT;
-	temp = (uint32_t *) skb->data;
-	kfree_skb(skb);
+	while ((skb = __skb_dequeue(&batch)) != NULL) {
+		use = min_t(size_t, count - copied, skb->len);
+		if (!ret && copy_to_user(buf + copied, skb->data, use))
+			ret = -EFAULT;
+		copied += use;
+		kfree_skb(skb);
+	}
 
-	return use;
+	return ret ? ret : copied;
 }
 
 /**
@@ -336,6 +418,7 @@ int audpkt_chk_and_update_physical_addr(struct audio_gpr_pkt *gpr_pkt)
 ssize_t audio_pkt_write(struct file *file, const char __user *buf,
 			size_t count, loff_t *ppos)
 {
+	struct audio_pkt_client *client = NULL;
 	struct audio_pkt_priv *ap_priv = NULL;
 	struct audio_pkt_device *audpkt_dev = NULL;
 	struct gpr_hdr *audpkt_hdr = NULL;
@@ -346,7 +429,8 @@ ssize_t audio_pkt_write(struct file *file, const char __user *buf,
 		AUDIO_PKT_ERR("invalid parameters\n");
 		return -EINVAL;
 	}
-	ap_priv = file->private_data;
+	client = file->private_data;
+	ap_priv = client->ap_priv;
 	audpkt_dev = ap_priv->ap_dev;
 
 	if (!audpkt_dev)  {
@@ -428,8 +512,8 @@ free_kbuf:
  */
 static unsigned int audio_pkt_poll(struct file *file, poll_table *wait)
 {
-	struct audio_pkt_priv *ap_priv = file->private_data;
-	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
+	struct audio_pkt_client *client = file->private_data;
+	struct audio_pkt_device *audpkt_dev = client->ap_priv->ap_dev;
 	unsigned int mask = 0;
 	unsigned long flags;
 	if (!audpkt_dev) {
@@ -441,7 +525,9 @@ static unsigned int audio_pkt_poll(struct file *file, poll_table *wait)
 	mutex_lock(&audpkt_dev->lock);
 
 	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
-	if (!skb_queue_empty(&audpkt_dev->queue))
+	if (!skb_queue_empty(&audpkt_dev->queue) ||
+	    (audpkt_dev->ring &&
+	     READ_ONCE(audpkt_dev->ring->read_idx) != audpkt_dev->ring_write))
 		mask |= POLLIN | POLLRDNORM;
 
 	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
@@ -450,6 +536,164 @@ static unsigned int audio_pkt_poll(struct file *file, poll_table *wait)
 	return mask;
 }
 
+/**
+ * audio_pkt_ioctl() - ioctl() syscall for the audio_pkt device
+ * file:	Pointer to the file structure.
+ * cmd:		ioctl command.
+ * arg:		ioctl argument.
+ */
+static long audio_pkt_ioctl(struct file *file, unsigned int cmd,
+			    unsigned long arg)
+{
+	struct audio_pkt_client *client = file->private_data;
+	u32 mode;
+
+	switch (cmd) {
+	case AUDIO_PKT_IOCTL_SET_RX_MODE:
+		if (copy_from_user(&mode, (void __user *)arg, sizeof(mode)))
+			return -EFAULT;
+		if (mode != AUDIO_PKT_RX_MODE_SINGLE &&
+		    mode != AUDIO_PKT_RX_MODE_MULTI)
+			return -EINVAL;
+		client->rx_mode = mode;
+		AUDIO_PKT_INFO("rx mode %u\n", mode);
+		return 0;
+	default:
+		AUDIO_PKT_ERR("Invalid ioctl %u\n", cmd);
+		return -ENOTTY;
+	}
+}
+
+/*
+ * Copy a packet into the mmap ring. Called with queue_lock held while the
+ * ring is mapped. read_idx is owned by userspace, so only trust it after
+ * range checking; the write index is tracked in ring_write.
+ */
+static int audio_pkt_ring_put(struct audio_pkt_device *audpkt_dev,
+			      void *data, u32 len)
+{
+	struct audio_pkt_ring_hdr *hdr = audpkt_dev->ring;
+	u8 *base = (u8 *)hdr + PAGE_SIZE;
+	u32 size = AUDIO_PKT_RING_DATA_SIZE;
+	u32 rec = ALIGN(sizeof(u32) + len, sizeof(u32));
+	u32 w = audpkt_dev->ring_write;
+	u32 r = smp_load_acquire(&hdr->read_idx);
+
+	if (r >= size || !IS_ALIGNED(r, sizeof(u32)))
+		return -EINVAL;
+
+	if (w >= r) {
+		/* Always leave room for a wrap marker at the end */
+		if (w + rec + sizeof(u32) > size) {
+			if (rec >= r)
+				return -ENOSPC;
+			*(u32 *)(base + w) = AUDIO_PKT_RING_WRAP;
+			w = 0;
+		}
+	} else if (w + rec >= r) {
+		return -ENOSPC;
+	}
+
+	*(u32 *)(base + w) = len;
+	memcpy(base + w + sizeof(u32), data, len);
+	w += rec;
+
+	audpkt_dev->ring_write = w;
+	smp_store_release(&hdr->write_idx, w);
+	return 0;
+}
+
+static void audio_pkt_ring_vm_open(struct vm_area_struct *vma)
+{
+	struct audio_pkt_device *audpkt_dev = vma->vm_private_data;
+
+	mutex_lock(&audpkt_dev->lock);
+	audpkt_dev->ring_users++;
+	mutex_unlock(&audpkt_dev->lock);
+}
+
+static void audio_pkt_ring_vm_close(struct vm_area_struct *vma)
+{
+	struct audio_pkt_device *audpkt_dev = vma->vm_private_data;
+	unsigned long flags;
+
+	mutex_lock(&audpkt_dev->lock);
+	if (!--audpkt_dev->ring_users) {
+		spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
+		audpkt_dev->ring = NULL;
+		spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
+	}
+	mutex_unlock(&audpkt_dev->lock);
+}
+
+static const struct vm_operations_struct audio_pkt_ring_vm_ops = {
+	.open = audio_pkt_ring_vm_open,
+	.close = audio_pkt_ring_vm_close,
+};
+
+/**
+ * audio_pkt_mmap() - mmap() syscall for the audio_pkt device
+ * file:	Pointer to the file structure.
+ * vma:		Pointer to the vm area to map the receive ring into.
+ *
+ * Maps the receive ring described in audio_pkt.h. Only one mapping of
+ * the ring may exist at a time, and only while this is the sole open
+ * file, since packets sent to the ring never reach read().
+ */
+static int audio_pkt_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct audio_pkt_client *client = file->private_data;
+	struct audio_pkt_device *audpkt_dev = client->ap_priv->ap_dev;
+	struct audio_pkt_ring_hdr *hdr;
+	unsigned long flags;
+	int ret = 0;
+
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start != AUDIO_PKT_RING_MAP_SIZE) {
+		AUDIO_PKT_ERR("Invalid ring mapping size %lu\n",
+			      vma->vm_end - vma->vm_start);
+		return -EINVAL;
+	}
+
+	mutex_lock(&audpkt_dev->lock);
+	if (audpkt_dev->ring_users || audpkt_dev->open_cnt > 1) {
+		ret = -EBUSY;
+		goto done;
+	}
+
+	if (!audpkt_dev->ring_buf) {
+		audpkt_dev->ring_buf = vmalloc_user(AUDIO_PKT_RING_MAP_SIZE);
+		if (!audpkt_dev->ring_buf) {
+			ret = -ENOMEM;
+			goto done;
+		}
+	}
+
+	ret = remap_vmalloc_range(vma, audpkt_dev->ring_buf, 0);
+	if (ret) {
+		AUDIO_PKT_ERR("ring remap failed ret:%d\n", ret);
+		goto done;
+	}
+	vma->vm_ops = &audio_pkt_ring_vm_ops;
+	vma->vm_private_data = audpkt_dev;
+	audpkt_dev->ring_users = 1;
+
+	hdr = audpkt_dev->ring_buf;
+	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
+	hdr->write_idx = 0;
+	hdr->read_idx = 0;
+	hdr->size = AUDIO_PKT_RING_DATA_SIZE;
+	hdr->data_offset = PAGE_SIZE;
+	hdr->overflow = 0;
+	audpkt_dev->ring_write = 0;
+	audpkt_dev->ring = hdr;
+	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
+
+done:
+	mutex_unlock(&audpkt_dev->lock);
+	return ret;
+}
+
 static const struct file_operations audio_pkt_fops = {
 	.owner = THIS_MODULE,
 	.open = audio_pkt_open,
@@ -457,6 +701,9 @@ static const struct file_operations audio_pkt_fops = {
 	.read = audio_pkt_read,
 	.write = audio_pkt_write,
 	.poll = audio_pkt_poll,
+	.unlocked_ioctl = audio_pkt_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+	.mmap = audio_pkt_mmap,
 };
 
 /**
@@ -482,14 +729,27 @@ static int audio_pkt_srvc_callback(struct gpr_device *adev,
     AUDIO_PKT_INFO("%s: header %d packet %d \n",
 		__func__,hdr_size, pkt_size);
 
+	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
+	/*
+	 * Use the ring only while nothing is queued for read(), so ring
+	 * packets are always older than queued ones.
+	 */
+	if (audpkt_dev->ring && skb_queue_empty(&audpkt_dev->queue)) {
+		if (!audio_pkt_ring_put(audpkt_dev, data, pkt_size))
+			goto wake;
+	}
+	if (audpkt_dev->ring)
+		audpkt_dev->ring->overflow++;
+
 	skb = alloc_skb(pkt_size, GFP_ATOMIC);
-	if (!skb)
+	if (!skb) {
+		spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
 		return -ENOMEM;
+	}
 
 	skb_put_data(skb, data, pkt_size);
-
-	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
-	skb_queue_tail(&audpkt_dev->queue, skb);
+	__skb_queue_tail(&audpkt_dev->queue, skb);
+wake:
 	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
 
 	/* wake up any blocking processes, waiting for new data */
@@ -716,6 +976,7 @@ static int audio_pkt_platform_driver_remove(struct platform_device *adev)
 
 	if (audpkt_dev) {
 		cdev_del(&audpkt_dev->cdev);
+		vfree(audpkt_dev->ring_buf);
 		device_destroy(audpkt_dev->audio_pkt_class,audpkt_dev->audio_pkt_major);
 		class_destroy(audpkt_dev->audio_pkt_class);
 		unregister_chrdev_region(MAJOR(audpkt_dev->audio_pkt_major),
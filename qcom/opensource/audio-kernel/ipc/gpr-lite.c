@@ -22,6 +22,11 @@
 #include <ipc/gpr-lite.h>
 #include <linux/rpmsg.h>
 #include <linux/of.h>
+#include <linux/rcupdate.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <soc/snd_event.h>
 #include <dsp/audio_notifier.h>
@@ -29,6 +34,39 @@
 #define APM_EVENT_MODULE_TO_CLIENT	0x03001000
 #define WAKELOCK_TIMEOUT 200
 
+#define GPR_STATS_MAX_OPCODES	16
+#define GPR_STATS_MAX_INFLIGHT	32
+/* bucket 0 is < 32us, bucket n is < (32us << n), the last one is open */
+#define GPR_STATS_LAT_BUCKETS	12
+#define GPR_STATS_LAT_MIN_SHIFT	5
+
+struct gpr_opcode_stats {
+	uint32_t opcode;
+	u64 tx_cnt;
+	u64 rx_cnt;
+	u64 rsp_cnt;
+	u64 lat_total_us;
+	u32 lat_max_us;
+	u32 lat_hist[GPR_STATS_LAT_BUCKETS];
+};
+
+/* per service packet and latency counters, protected by gpr->stats_lock */
+struct gpr_svc_stats {
+	ktime_t since;
+	u64 untracked;
+	u32 num_ops;
+	struct gpr_opcode_stats op[GPR_STATS_MAX_OPCODES];
+};
+
+/* a command sent with gpr_send_pkt() still waiting for its response */
+struct gpr_inflight {
+	struct gpr_svc_stats *stats;
+	uint32_t opcode;
+	uint32_t token;
+	uint16_t port;
+	ktime_t sent;
+};
+
 struct gpr {
 	struct rpmsg_endpoint *ch;
 	struct device *dev;
@@ -40,6 +78,11 @@ struct gpr {
 	int dest_domain_id;
 	struct work_struct notifier_reg_work;
 	struct wakeup_source *wsource;
+
+	spinlock_t stats_lock;
+	struct gpr_inflight inflight[GPR_STATS_MAX_INFLIGHT];
+	u32 inflight_next;
+	struct dentry *debugfs_root;
 };
 
 static struct gpr_q6 q6;
@@ -79,6 +122,200 @@ void gpr_subsys_notif_deregister(char *client_name)
 			__func__, client_name);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static struct gpr_opcode_stats *gpr_stats_get_op(struct gpr_svc_stats *stats,
+						  uint32_t opcode)
+{
+	struct gpr_opcode_stats *op;
+	int i;
+
+	for (i = 0; i < stats->num_ops; i++)
+		if (stats->op[i].opcode == opcode)
+			return &stats->op[i];
+
+	if (stats->num_ops == GPR_STATS_MAX_OPCODES) {
+		stats->untracked++;
+		return NULL;
+	}
+	op = &stats->op[stats->num_ops++];
+	op->opcode = opcode;
+	return op;
+}
+
+static void gpr_stats_tx(struct gpr *gpr, struct gpr_device *adev,
+			 struct gpr_hdr *hdr)
+{
+	struct gpr_opcode_stats *op;
+	struct gpr_inflight *req;
+	unsigned long flags;
+
+	if (!adev->stats)
+		return;
+
+	spin_lock_irqsave(&gpr->stats_lock, flags);
+	op = gpr_stats_get_op(adev->stats, hdr->opcode);
+	if (op)
+		op->tx_cnt++;
+	/* the oldest entry is overwritten if the DSP never answered it */
+	req = &gpr->inflight[gpr->inflight_next++ % GPR_STATS_MAX_INFLIGHT];
+	req->stats = adev->stats;
+	req->opcode = hdr->opcode;
+	req->token = hdr->token;
+	req->port = hdr->src_port;
+	req->sent = ktime_get();
+	spin_unlock_irqrestore(&gpr->stats_lock, flags);
+}
+
+static void gpr_stats_rx(struct gpr *gpr, struct gpr_device *svc,
+			 struct gpr_hdr *hdr)
+{
+	struct gpr_opcode_stats *op;
+	struct gpr_inflight *req = NULL;
+	unsigned long flags;
+	s64 lat_us;
+	int i, bucket;
+
+	spin_lock_irqsave(&gpr->stats_lock, flags);
+	if (svc->stats) {
+		op = gpr_stats_get_op(svc->stats, hdr->opcode);
+		if (op)
+			op->rx_cnt++;
+	}
+
+	/* unsolicited module events are not responses */
+	if (hdr->opcode == APM_EVENT_MODULE_TO_CLIENT)
+		goto unlock;
+
+	for (i = 0; i < GPR_STATS_MAX_INFLIGHT; i++) {
+		if (gpr->inflight[i].stats &&
+		    gpr->inflight[i].port == hdr->dst_port &&
+		    gpr->inflight[i].token == hdr->token &&
+		    (!req || ktime_before(gpr->inflight[i].sent, req->sent)))
+			req = &gpr->inflight[i];
+	}
+	if (!req)
+		goto unlock;
+
+	lat_us = ktime_us_delta(ktime_get(), req->sent);
+	op = gpr_stats_get_op(req->stats, req->opcode);
+	req->stats = NULL;
+	if (!op)
+		goto unlock;
+
+	if (lat_us < (1 << GPR_STATS_LAT_MIN_SHIFT))
+		bucket = 0;
+	else
+		bucket = min_t(int, ilog2(lat_us) - GPR_STATS_LAT_MIN_SHIFT + 1,
+			       GPR_STATS_LAT_BUCKETS - 1);
+	op->rsp_cnt++;
+	op->lat_total_us += lat_us;
+	op->lat_hist[bucket]++;
+	if (lat_us > op->lat_max_us)
+		op->lat_max_us = lat_us;
+unlock:
+	spin_unlock_irqrestore(&gpr->stats_lock, flags);
+}
+
+/* drop in-flight entries that still point at a service going away */
+static void gpr_stats_forget(struct gpr *gpr, struct gpr_svc_stats *stats)
+{
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&gpr->stats_lock, flags);
+	for (i = 0; i < GPR_STATS_MAX_INFLIGHT; i++)
+		if (gpr->inflight[i].stats == stats)
+			gpr->inflight[i].stats = NULL;
+	spin_unlock_irqrestore(&gpr->stats_lock, flags);
+}
+
+static void gpr_stats_show_svc(struct seq_file *m, struct gpr *gpr,
+			       struct gpr_device *adev)
+{
+	struct gpr_svc_stats *stats = adev->stats;
+	struct gpr_opcode_stats *op;
+	unsigned long flags;
+	s64 elapsed_ms;
+	int i, j;
+
+	spin_lock_irqsave(&gpr->stats_lock, flags);
+	elapsed_ms = max_t(s64, ktime_ms_delta(ktime_get(), stats->since), 1);
+	seq_printf(m, "svc %s id 0x%x, %lld ms, untracked %llu\n",
+		   adev->name, adev->svc_id, elapsed_ms, stats->untracked);
+	for (i = 0; i < stats->num_ops; i++) {
+		op = &stats->op[i];
+		seq_printf(m, "  opcode 0x%08x tx %llu (%llu/s) rx %llu (%llu/s) rsp %llu avg_us %llu max_us %u\n    lat",
+			   op->opcode,
+			   op->tx_cnt, div64_u64(op->tx_cnt * 1000, elapsed_ms),
+			   op->rx_cnt, div64_u64(op->rx_cnt * 1000, elapsed_ms),
+			   op->rsp_cnt,
+			   op->rsp_cnt ? div64_u64(op->lat_total_us, op->rsp_cnt) : 0,
+			   op->lat_max_us);
+		for (j = 0; j < GPR_STATS_LAT_BUCKETS; j++)
+			seq_printf(m, " %u", op->lat_hist[j]);
+		seq_puts(m, "\n");
+	}
+	spin_unlock_irqrestore(&gpr->stats_lock, flags);
+}
+
+static int gpr_stats_show(struct seq_file *m, void *unused)
+{
+	struct gpr *gpr = m->private;
+	struct gpr_device *adev;
+	int id;
+
+	seq_printf(m, "latency buckets: <%dus, then doubling, last is open\n",
+		   1 << GPR_STATS_LAT_MIN_SHIFT);
+	rcu_read_lock();
+	idr_for_each_entry(&gpr->svcs_idr, adev, id)
+		if (adev->stats)
+			gpr_stats_show_svc(m, gpr, adev);
+	rcu_read_unlock();
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(gpr_stats);
+
+static void gpr_debugfs_init(struct gpr *gpr)
+{
+	gpr->debugfs_root = debugfs_create_dir("gpr", NULL);
+	if (IS_ERR_OR_NULL(gpr->debugfs_root)) {
+		gpr->debugfs_root = NULL;
+		return;
+	}
+	debugfs_create_file("svc_stats", 0444, gpr->debugfs_root, gpr,
+			    &gpr_stats_fops);
+}
+
+static void gpr_debugfs_deinit(struct gpr *gpr)
+{
+	debugfs_remove_recursive(gpr->debugfs_root);
+	gpr->debugfs_root = NULL;
+}
+#else
+static inline void gpr_stats_tx(struct gpr *gpr, struct gpr_device *adev,
+				struct gpr_hdr *hdr)
+{
+}
+
+static inline void gpr_stats_rx(struct gpr *gpr, struct gpr_device *svc,
+				struct gpr_hdr *hdr)
+{
+}
+
+static inline void gpr_stats_forget(struct gpr *gpr,
+				    struct gpr_svc_stats *stats)
+{
+}
+
+static inline void gpr_debugfs_init(struct gpr *gpr)
+{
+}
+
+static inline void gpr_debugfs_deinit(struct gpr *gpr)
+{
+}
+#endif /* CONFIG_DEBUG_FS */
+
 /**
  * gpr_send_pkt() - Send a gpr message from gpr device
  *
@@ -142,6 +379,8 @@ int gpr_send_pkt(struct gpr_device *adev, struct gpr_pkt *pkt)
 		adev->svc_id, __func__, pkt_size);
 	ret = rpmsg_trysend(gpr->ch, pkt, pkt_size);
 	spin_unlock_irqrestore(&adev->lock, flags);
+	if (!ret)
+		gpr_stats_tx(gpr, adev, hdr);
 	return ret ? ret : pkt_size;
 }
 EXPORT_SYMBOL_GPL(gpr_send_pkt);
@@ -270,6 +509,7 @@ static void gpr_dev_release(struct device *dev)
 {
 	struct gpr_device *adev = to_gpr_device(dev);
 
+	kfree(adev->stats);
 	kfree(adev);
 }
 
@@ -282,7 +522,6 @@ static int gpr_callback(struct rpmsg_device *rpdev, void *buf,
 	struct gpr_device *svc = NULL;
 	struct gpr_driver *adrv = NULL;
 	struct gpr_hdr *hdr;
-	unsigned long flags;
 	//uint32_t opcode_type;
 
 	if (len <= GPR_HDR_SIZE) {
@@ -316,31 +555,40 @@ static int gpr_callback(struct rpmsg_device *rpdev, void *buf,
 		pm_wakeup_ws_event(gpr_priv->wsource, WAKELOCK_TIMEOUT, true);
 	}
 	svc_id = hdr->dst_port;
-	spin_lock_irqsave(&gpr->svcs_lock, flags);
+	/*
+	 * Services are looked up under RCU so inbound packets never wait
+	 * on registration. gpr_device_remove() waits for a grace period
+	 * after unpublishing a service, so svc and its driver stay valid
+	 * until the callback returns.
+	 */
+	rcu_read_lock();
 	svc = idr_find(&gpr->svcs_idr, svc_id);
-	if (svc && svc->dev.driver) {
-		adrv = to_gpr_driver(svc->dev.driver);
+	if (svc && READ_ONCE(svc->dev.driver)) {
+		adrv = to_gpr_driver(READ_ONCE(svc->dev.driver));
 	} else {
 		/*Does not match any SVC ID hence would be routed to audio passthrough*/
 		svc = idr_find(&gpr->svcs_idr, GPR_SVC_MAX);
-		if (svc && svc->dev.driver)
-			adrv = to_gpr_driver(svc->dev.driver);
+		if (svc && READ_ONCE(svc->dev.driver))
+			adrv = to_gpr_driver(READ_ONCE(svc->dev.driver));
 	}
-	spin_unlock_irqrestore(&gpr->svcs_lock, flags);
 
 	if (!adrv) {
+		rcu_read_unlock();
 		dev_err_ratelimited(gpr->dev, "GPR: service is not registered\n");
 		if (hdr->opcode == APM_EVENT_MODULE_TO_CLIENT)
 			__pm_relax(gpr_priv->wsource);
 		return -EINVAL;
 	}
 
+	gpr_stats_rx(gpr, svc, hdr);
+
 	/*
 	 * NOTE: hdr_size is not same as GPR_HDR_SIZE as remote can include
 	 * optional headers in to gpr_hdr which should be ignored
 	 */
 
 	adrv->callback(svc, buf);
+	rcu_read_unlock();
 
 	return 0;
 }
@@ -384,11 +632,14 @@ static void gpr_device_remove(struct device *dev)
 
 	if (dev->driver) {
 		adrv = to_gpr_driver(dev->driver);
-		if (adrv->remove)
-			adrv->remove(adev);
+		/* unpublish first so no callback runs into a removed driver */
 		spin_lock(&gpr->svcs_lock);
 		idr_remove(&gpr->svcs_idr, adev->svc_id);
 		spin_unlock(&gpr->svcs_lock);
+		synchronize_rcu();
+		gpr_stats_forget(gpr, adev->stats);
+		if (adrv->remove)
+			adrv->remove(adev);
 	}
 
 	return;
@@ -428,6 +679,11 @@ static int gpr_add_device(struct device *dev, struct device_node *np,
 
 	spin_lock_init(&adev->lock);
 
+	/* telemetry is best effort, the service works without it */
+	adev->stats = kzalloc(sizeof(*adev->stats), GFP_KERNEL);
+	if (adev->stats)
+		adev->stats->since = ktime_get();
+
 	adev->svc_id = id->svc_id;
 	adev->domain_id = id->domain_id;
 	adev->version = id->svc_version;
@@ -524,6 +780,7 @@ static int gpr_probe(struct rpmsg_device *rpdev)
 	gpr_priv->dev = dev;
 	spin_lock_init(&gpr_priv->svcs_lock);
 	idr_init(&gpr_priv->svcs_idr);
+	spin_lock_init(&gpr_priv->stats_lock);
 
 	ret = snd_event_client_register(&rpdev->dev, &gpr_ssr_ops, NULL);
 	if (ret) {
@@ -552,6 +809,7 @@ static int gpr_probe(struct rpmsg_device *rpdev)
 	}
 
 	gpr_priv->wsource = wakeup_source_register(gpr_priv->dev, "audio-gpr");
+	gpr_debugfs_init(gpr_priv);
 	dev_info(dev, "%s: gpr-lite probe success\n",
 		__func__);
 
@@ -582,6 +840,7 @@ static void gpr_remove(struct rpmsg_device *rpdev)
 		gpr_subsys_notif_deregister("gpr_modem");
 	}
 	device_for_each_child(&rpdev->dev, NULL, gpr_remove_device);
+	gpr_debugfs_deinit(gpr_priv);
 }
 
 /*
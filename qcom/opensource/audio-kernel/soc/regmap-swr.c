@@ -10,21 +10,97 @@
 #include <linux/regmap.h>
 #include <linux/module.h>
 #include <linux/init.h>
+#include <linux/xarray.h>
 #include <soc/soundwire.h>
 #include <soc/internal.h>
 
+/**
+ * struct regmap_swr_ctx - bus context of a soundwire regmap
+ * @dev:	soundwire slave device
+ * @lock:	protects the deferred write state
+ * @defer_cnt:	nesting count of regmap_swr_defer_begin()
+ * @pending:	register -> value of writes held back while deferring
+ * @num_pending: number of entries in @pending
+ */
+struct regmap_swr_ctx {
+	struct device *dev;
+	struct mutex lock;
+	int defer_cnt;
+	struct xarray pending;
+	size_t num_pending;
+};
+
+static struct regmap_bus regmap_swr;
+
+static int regmap_swr_bulk_write(struct swr_device *swr, u16 *reg, u8 *val,
+				 size_t num_regs)
+{
+	int i, ret;
+
+	ret = swr_bulk_write(swr, swr->dev_num, reg, val, num_regs);
+	if (ret != -EOPNOTSUPP)
+		return ret;
+
+	/* master has no bulk support, fall back to single writes */
+	for (i = 0; i < num_regs; i++) {
+		ret = swr_write(swr, swr->dev_num, reg[i], &val[i]);
+		if (ret < 0)
+			break;
+	}
+	return ret;
+}
+
+/*
+ * Queue writes while a deferred window is open. Later writes to the same
+ * register replace the queued value. Returns true if the writes were
+ * queued, false if they must go to the bus now.
+ */
+static bool regmap_swr_defer_write(struct regmap_swr_ctx *ctx, const u16 *reg,
+				   const u8 *val, size_t num_regs)
+{
+	void *old;
+	int i;
+
+	mutex_lock(&ctx->lock);
+	if (!ctx->defer_cnt) {
+		mutex_unlock(&ctx->lock);
+		return false;
+	}
+	for (i = 0; i < num_regs; i++) {
+		old = xa_store(&ctx->pending, reg[i], xa_mk_value(val[i]),
+			       GFP_KERNEL);
+		if (xa_is_err(old)) {
+			/* Entries queued so far stay, they are flushed in order */
+			dev_err_ratelimited(ctx->dev,
+				"%s: failed to defer reg 0x%x\n",
+				__func__, reg[i]);
+			regmap_swr_bulk_write(to_swr_device(ctx->dev),
+					      (u16 *)&reg[i], (u8 *)&val[i],
+					      num_regs - i);
+			break;
+		}
+		if (!old)
+			ctx->num_pending++;
+	}
+	mutex_unlock(&ctx->lock);
+	return true;
+}
+
 
 static int regmap_swr_gather_write(void *context,
 				const void *reg, size_t reg_size,
 				const void *val, size_t val_len)
 {
-	struct device *dev = context;
+	struct regmap_swr_ctx *ctx = context;
+	struct device *dev = ctx->dev;
 	struct swr_device *swr = to_swr_device(dev);
 	struct regmap *map = dev_get_regmap(dev, NULL);
 	size_t addr_bytes;
 	size_t val_bytes;
+	size_t num_regs;
 	int i, ret = 0;
 	u16 reg_addr = 0;
+	u16 *regs;
 	u8 *value;
 
 	if (map == NULL) {
@@ -44,7 +120,28 @@ static int regmap_swr_gather_write(void *context,
 	reg_addr = *(u16 *)reg;
 	val_bytes = map->format.val_bytes;
 	/* val_len = val_bytes * val_count */
-	for (i = 0; i < (val_len / val_bytes); i++) {
+	num_regs = val_len / val_bytes;
+	if (val_bytes == 1 && num_regs > 1) {
+		/* Contiguous registers, send them as one bulk transfer */
+		regs = kcalloc(num_regs, sizeof(u16), GFP_KERNEL);
+		if (!regs)
+			return -ENOMEM;
+		for (i = 0; i < num_regs; i++)
+			regs[i] = reg_addr + i;
+		if (regmap_swr_defer_write(ctx, regs, val, num_regs))
+			ret = 0;
+		else
+			ret = regmap_swr_bulk_write(swr, regs, (u8 *)val,
+						    num_regs);
+		if (ret < 0)
+			dev_err_ratelimited(dev, "%s: bulk write reg 0x%x failed, err %d\n",
+				__func__, reg_addr, ret);
+		kfree(regs);
+		return ret;
+	}
+	if (val_bytes == 1 && regmap_swr_defer_write(ctx, &reg_addr, val, 1))
+		return 0;
+	for (i = 0; i < num_regs; i++) {
 		value = (u8 *)val + (val_bytes * i);
 		ret = swr_write(swr, swr->dev_num, (reg_addr + i), value);
 		if (ret < 0) {
@@ -59,7 +156,8 @@ static int regmap_swr_gather_write(void *context,
 static int regmap_swr_raw_multi_reg_write(void *context, const void *data,
 					  size_t count)
 {
-	struct device *dev = context;
+	struct regmap_swr_ctx *ctx = context;
+	struct device *dev = ctx->dev;
 	struct swr_device *swr = to_swr_device(dev);
 	struct regmap *map = dev_get_regmap(dev, NULL);
 	size_t addr_bytes;
@@ -109,10 +207,13 @@ static int regmap_swr_raw_multi_reg_write(void *context, const void *data,
 		val[i] = *buf;
 		buf += map->format.val_bytes;
 	}
+	if (regmap_swr_defer_write(ctx, reg, val, num_regs))
+		goto done;
 	ret = swr_bulk_write(swr, swr->dev_num, reg, val, num_regs);
 	if (ret)
 		dev_err_ratelimited(dev, "%s: multi reg write failed\n", __func__);
 
+done:
 	kfree(val);
 mem_fail:
 	kfree(reg);
@@ -121,14 +222,14 @@ mem_fail:
 
 static int regmap_swr_write(void *context, const void *data, size_t count)
 {
-	struct device *dev = context;
-	struct regmap *map = dev_get_regmap(dev, NULL);
+	struct regmap_swr_ctx *ctx = context;
+	struct regmap *map = dev_get_regmap(ctx->dev, NULL);
 	size_t addr_bytes;
 	size_t val_bytes;
 	size_t pad_bytes;
 
 	if (map == NULL) {
-		dev_err_ratelimited(dev, "%s: regmap is NULL\n", __func__);
+		dev_err_ratelimited(ctx->dev, "%s: regmap is NULL\n", __func__);
 		return -EINVAL;
 	}
 	addr_bytes = map->format.reg_bytes;
@@ -149,12 +250,14 @@ static int regmap_swr_read(void *context,
 			const void *reg, size_t reg_size,
 			void *val, size_t val_size)
 {
-	struct device *dev = context;
+	struct regmap_swr_ctx *ctx = context;
+	struct device *dev = ctx->dev;
 	struct swr_device *swr = to_swr_device(dev);
 	struct regmap *map = dev_get_regmap(dev, NULL);
 	size_t addr_bytes;
 	int ret = 0;
 	u16 reg_addr = 0;
+	void *entry;
 
 	if (map == NULL) {
 		dev_err_ratelimited(dev, "%s: regmap is NULL\n", __func__);
@@ -171,6 +274,18 @@ static int regmap_swr_read(void *context,
 		return -EINVAL;
 	}
 	reg_addr = *(u16 *)reg;
+
+	/* A register still queued in the deferred window reads back as queued */
+	if (val_size == 1) {
+		mutex_lock(&ctx->lock);
+		entry = ctx->defer_cnt ? xa_load(&ctx->pending, reg_addr) : NULL;
+		if (entry)
+			*(u8 *)val = xa_to_value(entry);
+		mutex_unlock(&ctx->lock);
+		if (entry)
+			return 0;
+	}
+
 	ret = swr_read(swr, swr->dev_num, reg_addr, val, val_size);
 	if (ret < 0)
 		dev_err_ratelimited(dev, "%s: codec reg 0x%x read failed %d\n",
@@ -178,21 +293,150 @@ static int regmap_swr_read(void *context,
 	return ret;
 }
 
+static void regmap_swr_free_context(void *context)
+{
+	struct regmap_swr_ctx *ctx = context;
+
+	xa_destroy(&ctx->pending);
+	mutex_destroy(&ctx->lock);
+	kfree(ctx);
+}
+
 static struct regmap_bus regmap_swr = {
 	.write = regmap_swr_write,
 	.gather_write = regmap_swr_gather_write,
 	.read = regmap_swr_read,
+	.free_context = regmap_swr_free_context,
 	.reg_format_endian_default = REGMAP_ENDIAN_NATIVE,
 	.val_format_endian_default = REGMAP_ENDIAN_NATIVE,
 };
 
+static struct regmap_swr_ctx *regmap_swr_ctx_alloc(struct swr_device *swr)
+{
+	struct regmap_swr_ctx *ctx;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return NULL;
+
+	ctx->dev = &swr->dev;
+	mutex_init(&ctx->lock);
+	xa_init(&ctx->pending);
+	return ctx;
+}
+
+static struct regmap_swr_ctx *regmap_swr_get_ctx(struct regmap *map)
+{
+	if (IS_ERR_OR_NULL(map) || map->bus != &regmap_swr)
+		return NULL;
+	return map->bus_context;
+}
+
+/**
+ * regmap_swr_defer_begin - open a deferred write window
+ * @map: regmap created with regmap_init_swr()
+ *
+ * Until the matching regmap_swr_defer_end(), writes through @map are
+ * held back instead of going out on the bus, and a later write to the
+ * same register replaces the earlier one. Only use it where the order of
+ * writes to different registers does not matter, e.g. around
+ * regcache_sync(). Windows may nest.
+ *
+ * Return: 0 on success, -EINVAL if @map is not a soundwire regmap.
+ */
+int regmap_swr_defer_begin(struct regmap *map)
+{
+	struct regmap_swr_ctx *ctx = regmap_swr_get_ctx(map);
+
+	if (!ctx)
+		return -EINVAL;
+
+	mutex_lock(&ctx->lock);
+	ctx->defer_cnt++;
+	mutex_unlock(&ctx->lock);
+	return 0;
+}
+EXPORT_SYMBOL(regmap_swr_defer_begin);
+
+/**
+ * regmap_swr_defer_end - close a deferred write window
+ * @map: regmap created with regmap_init_swr()
+ *
+ * When the outermost window closes, the queued writes are sent in
+ * ascending register order as a single bulk transfer.
+ *
+ * Return: 0 on success or the error of the bulk transfer.
+ */
+int regmap_swr_defer_end(struct regmap *map)
+{
+	struct regmap_swr_ctx *ctx = regmap_swr_get_ctx(map);
+	unsigned long idx;
+	size_t num_regs = 0;
+	void *entry;
+	u16 *reg = NULL;
+	u8 *val = NULL;
+	int ret = 0;
+
+	if (!ctx)
+		return -EINVAL;
+
+	mutex_lock(&ctx->lock);
+	if (WARN_ON(!ctx->defer_cnt)) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+	if (--ctx->defer_cnt || !ctx->num_pending)
+		goto unlock;
+
+	reg = kcalloc(ctx->num_pending, sizeof(u16), GFP_KERNEL);
+	val = kcalloc(ctx->num_pending, sizeof(u8), GFP_KERNEL);
+	if (!reg || !val) {
+		ret = -ENOMEM;
+		goto clear;
+	}
+
+	/* xarray iterates in index order, i.e. sorted by register */
+	xa_for_each(&ctx->pending, idx, entry) {
+		reg[num_regs] = idx;
+		val[num_regs] = xa_to_value(entry);
+		num_regs++;
+	}
+	ret = regmap_swr_bulk_write(to_swr_device(ctx->dev), reg, val,
+				    num_regs);
+	if (ret < 0)
+		dev_err_ratelimited(ctx->dev, "%s: flush of %zu regs failed %d\n",
+			__func__, num_regs, ret);
+	else
+		dev_dbg(ctx->dev, "%s: flushed %zu regs\n", __func__,
+			num_regs);
+
+clear:
+	xa_destroy(&ctx->pending);
+	ctx->num_pending = 0;
+	kfree(val);
+	kfree(reg);
+unlock:
+	mutex_unlock(&ctx->lock);
+	return ret;
+}
+EXPORT_SYMBOL(regmap_swr_defer_end);
+
 struct regmap *__regmap_init_swr(struct swr_device *swr,
 				 const struct regmap_config *config,
 				 struct lock_class_key *lock_key,
 				 const char *lock_name)
 {
-	return __regmap_init(&swr->dev, &regmap_swr, &swr->dev, config,
-			   lock_key, lock_name);
+	struct regmap_swr_ctx *ctx = regmap_swr_ctx_alloc(swr);
+	struct regmap *map;
+
+	if (!ctx)
+		return ERR_PTR(-ENOMEM);
+
+	map = __regmap_init(&swr->dev, &regmap_swr, ctx, config,
+			    lock_key, lock_name);
+	if (IS_ERR(map))
+		regmap_swr_free_context(ctx);
+	return map;
 }
 EXPORT_SYMBOL(__regmap_init_swr);
 
@@ -201,8 +445,17 @@ struct regmap *__devm_regmap_init_swr(struct swr_device *swr,
 				      struct lock_class_key *lock_key,
 				      const char *lock_name)
 {
-	return __devm_regmap_init(&swr->dev, &regmap_swr, &swr->dev, config,
-				lock_key, lock_name);
+	struct regmap_swr_ctx *ctx = regmap_swr_ctx_alloc(swr);
+	struct regmap *map;
+
+	if (!ctx)
+		return ERR_PTR(-ENOMEM);
+
+	map = __devm_regmap_init(&swr->dev, &regmap_swr, ctx, config,
+				 lock_key, lock_name);
+	if (IS_ERR(map))
+		regmap_swr_free_context(ctx);
+	return map;
 }
 EXPORT_SYMBOL(__devm_regmap_init_swr);
 
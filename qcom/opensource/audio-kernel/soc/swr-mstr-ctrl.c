@@ -82,6 +82,12 @@
 #define SWRM_DP_PORT_CTRL_OFFSET1_SHFT    0x08
 
 #define SWR_OVERFLOW_RETRY_COUNT 30
+/*
+ * The command FIFOs drain one command per frame, so poll at a few frame
+ * periods while waiting on them. The overall timeout is unchanged.
+ */
+#define SWRM_FIFO_POLL_US 50
+#define SWRM_FIFO_TIMEOUT_US (SWR_OVERFLOW_RETRY_COUNT * 500)
 
 #define CPU_IDLE_LATENCY 10
 
@@ -388,6 +394,35 @@ static const struct file_operations swrm_debug_dump_ops = {
 	.open = swrm_debug_open,
 	.read = swrm_debug_reg_dump,
 };
+
+static ssize_t swrm_debug_fifo_stats(struct file *file, char __user *ubuf,
+				     size_t count, loff_t *ppos)
+{
+	struct swr_mstr_ctrl *swrm = file->private_data;
+	struct swrm_fifo_stats stats;
+	char lbuf[192];
+	int len;
+
+	if (!swrm)
+		return -EINVAL;
+
+	mutex_lock(&swrm->iolock);
+	stats = swrm->fifo_stats;
+	mutex_unlock(&swrm->iolock);
+
+	len = scnprintf(lbuf, sizeof(lbuf),
+			"wr_cmds: %llu\nrd_cmds: %llu\nwr_full_waits: %llu\n"
+			"rd_waits: %llu\nwait_us: %llu\nwr_flushed: %llu\n",
+			stats.wr_cmds, stats.rd_cmds, stats.wr_full_waits,
+			stats.rd_waits, stats.wait_us, stats.wr_flushed);
+
+	return simple_read_from_buffer(ubuf, count, ppos, lbuf, len);
+}
+
+static const struct file_operations swrm_debug_fifo_stats_ops = {
+	.open = swrm_debug_open,
+	.read = swrm_debug_fifo_stats,
+};
 #endif
 
 static void swrm_reg_dump(struct swr_mstr_ctrl *swrm,
@@ -672,20 +707,27 @@ static int swr_master_bulk_write(struct swr_mstr_ctrl *swrm, u32 *reg_addr,
 {
 	int i = 0;
 
-	if (swrm->bulk_write)
+	if (swrm->bulk_write) {
 		swrm->bulk_write(swrm->handle, reg_addr, val, length);
-	else {
+		/* not accounted, re-read the FIFO level on next write */
+		mutex_lock(&swrm->iolock);
+		swrm->wr_fifo_credits = 0;
+		mutex_unlock(&swrm->iolock);
+	} else {
 		mutex_lock(&swrm->iolock);
 		for (i = 0; i < length; i++) {
-		/* wait for FIFO WR command to complete to avoid overflow */
-		/*
-		 * Reduce sleep from 100us to 50us to meet KPIs
-		 * This still meets the hardware spec
-		 */
-			usleep_range(50, 55);
-			if (reg_addr[i] == SWRM_CMD_FIFO_WR_CMD(swrm->ee_val))
+			/*
+			 * FIFO commands are paced by the slot accounting in
+			 * swrm_wait_for_fifo_avail, keep the 50us gap for
+			 * direct register writes.
+			 */
+			if (reg_addr[i] == SWRM_CMD_FIFO_WR_CMD(swrm->ee_val)) {
 				swrm_wait_for_fifo_avail(swrm,
 							 SWRM_WR_CHECK_AVAIL);
+				swrm->fifo_stats.wr_cmds++;
+			} else {
+				usleep_range(50, 55);
+			}
 			swr_master_write(swrm, reg_addr[i], val[i]);
 		}
 		usleep_range(100, 110);
@@ -875,54 +917,97 @@ static u32 swrm_get_packed_reg_val(u8 *cmd_id, u8 cmd_data,
 	return val;
 }
 
+static u32 swrm_fifo_wr_outstanding(struct swr_mstr_ctrl *swrm)
+{
+	return (swr_master_read(swrm, SWRM_CMD_FIFO_STATUS(swrm->ee_val)) &
+		0x00001F00) >> 8;
+}
+
+static u32 swrm_fifo_rd_outstanding(struct swr_mstr_ctrl *swrm)
+{
+	return (swr_master_read(swrm, SWRM_CMD_FIFO_STATUS(swrm->ee_val)) &
+		0x001F0000) >> 16;
+}
+
+/*
+ * Called with iolock held. For writes, a free slot is taken from
+ * wr_fifo_credits when one is known to be available, so back to back
+ * commands fill the FIFO without reading its status each time. The
+ * credits are refilled from FIFO_STATUS once they run out. Anything
+ * that queues commands without going through here must clear them.
+ */
 static void swrm_wait_for_fifo_avail(struct swr_mstr_ctrl *swrm, int swrm_rd_wr)
 {
 	u32 fifo_outstanding_cmd;
-	u32 fifo_retry_count = SWR_OVERFLOW_RETRY_COUNT;
+	ktime_t start, timeout;
 
 	if (swrm_rd_wr) {
 		/* Check for fifo underflow during read */
 		/* Check no of outstanding commands in fifo before read */
-		fifo_outstanding_cmd = ((swr_master_read(swrm,
-				SWRM_CMD_FIFO_STATUS(swrm->ee_val)) & 0x001F0000) >> 16);
+		fifo_outstanding_cmd = swrm_fifo_rd_outstanding(swrm);
 		if (fifo_outstanding_cmd == 0) {
-			while (fifo_retry_count) {
-				usleep_range(500, 510);
+			swrm->fifo_stats.rd_waits++;
+			start = ktime_get();
+			timeout = ktime_add_us(start, SWRM_FIFO_TIMEOUT_US);
+			do {
+				usleep_range(SWRM_FIFO_POLL_US,
+					     SWRM_FIFO_POLL_US + 5);
 				fifo_outstanding_cmd =
-					((swr_master_read (swrm,
-					  SWRM_CMD_FIFO_STATUS(swrm->ee_val)) & 0x001F0000)
-					  >> 16);
-				fifo_retry_count--;
-				if (fifo_outstanding_cmd > 0)
-					break;
-			}
+					swrm_fifo_rd_outstanding(swrm);
+			} while (fifo_outstanding_cmd == 0 &&
+				 ktime_before(ktime_get(), timeout));
+			swrm->fifo_stats.wait_us +=
+				ktime_us_delta(ktime_get(), start);
 		}
 		if (fifo_outstanding_cmd == 0)
 			dev_err_ratelimited(swrm->dev,
 					"%s err read underflow\n", __func__);
 	} else {
+		if (swrm->wr_fifo_credits) {
+			swrm->wr_fifo_credits--;
+			return;
+		}
 		/* Check for fifo overflow during write */
 		/* Check no of outstanding commands in fifo before write */
-		fifo_outstanding_cmd = ((swr_master_read(swrm,
-					 SWRM_CMD_FIFO_STATUS(swrm->ee_val)) & 0x00001F00)
-					 >> 8);
-		if (fifo_outstanding_cmd == swrm->wr_fifo_depth) {
-			while (fifo_retry_count) {
-				usleep_range(500, 510);
+		fifo_outstanding_cmd = swrm_fifo_wr_outstanding(swrm);
+		if (fifo_outstanding_cmd >= swrm->wr_fifo_depth) {
+			swrm->fifo_stats.wr_full_waits++;
+			start = ktime_get();
+			timeout = ktime_add_us(start, SWRM_FIFO_TIMEOUT_US);
+			do {
+				usleep_range(SWRM_FIFO_POLL_US,
+					     SWRM_FIFO_POLL_US + 5);
 				fifo_outstanding_cmd =
-				((swr_master_read(swrm, SWRM_CMD_FIFO_STATUS(swrm->ee_val))
-				  & 0x00001F00) >> 8);
-				fifo_retry_count--;
-				if (fifo_outstanding_cmd < swrm->wr_fifo_depth)
-					break;
-			}
+					swrm_fifo_wr_outstanding(swrm);
+			} while (fifo_outstanding_cmd >= swrm->wr_fifo_depth &&
+				 ktime_before(ktime_get(), timeout));
+			swrm->fifo_stats.wait_us +=
+				ktime_us_delta(ktime_get(), start);
 		}
-		if (fifo_outstanding_cmd == swrm->wr_fifo_depth)
+		if (fifo_outstanding_cmd >= swrm->wr_fifo_depth) {
 			dev_err_ratelimited(swrm->dev,
 					"%s err write overflow\n", __func__);
+			return;
+		}
+		/* One of the free slots is taken by the caller's command */
+		swrm->wr_fifo_credits = swrm->wr_fifo_depth -
+					fifo_outstanding_cmd - 1;
 	}
 }
 
+/* Wait for commands left queued in the write FIFO to go out on the bus */
+static void swrm_wait_for_fifo_drain(struct swr_mstr_ctrl *swrm)
+{
+	ktime_t timeout = ktime_add_us(ktime_get(), SWRM_FIFO_TIMEOUT_US);
+
+	mutex_lock(&swrm->iolock);
+	while (swrm_fifo_wr_outstanding(swrm) &&
+	       ktime_before(ktime_get(), timeout))
+		usleep_range(SWRM_FIFO_POLL_US, SWRM_FIFO_POLL_US + 5);
+	swrm->wr_fifo_credits = 0;
+	mutex_unlock(&swrm->iolock);
+}
+
 static int swrm_cmd_fifo_rd_cmd(struct swr_mstr_ctrl *swrm, int *cmd_data,
 				 u8 dev_addr, u8 cmd_id, u16 reg_addr,
 				 u32 len)
@@ -931,23 +1016,26 @@ static int swrm_cmd_fifo_rd_cmd(struct swr_mstr_ctrl *swrm, int *cmd_data,
 	u32 retry_attempt = 0;
 
 	mutex_lock(&swrm->iolock);
+	swrm->fifo_stats.rd_cmds++;
 	val = swrm_get_packed_reg_val(&swrm->rcmd_id, len, dev_addr, reg_addr);
 	if (swrm->read) {
 		/* skip delay if read is handled in platform driver */
 		swr_master_write(swrm, SWRM_CMD_FIFO_RD_CMD(swrm->ee_val), val);
+		/* not accounted, re-read the FIFO level on next write */
+		swrm->wr_fifo_credits = 0;
 	} else {
 		/*
 		 * Check for outstanding cmd wrt. write fifo depth to avoid
 		 * overflow as read will also increase write fifo cnt.
 		 */
 		swrm_wait_for_fifo_avail(swrm, SWRM_WR_CHECK_AVAIL);
-		/* wait for FIFO RD to complete to avoid overflow */
-		usleep_range(100, 105);
 		swr_master_write(swrm, SWRM_CMD_FIFO_RD_CMD(swrm->ee_val), val);
-		/* wait for FIFO RD CMD complete to avoid overflow */
-		usleep_range(250, 255);
 	}
-	/* Check if slave responds properly after FIFO RD is complete */
+	/*
+	 * Check if slave responds properly after FIFO RD is complete. This
+	 * polls the read FIFO level, so the read returns as soon as the
+	 * response lands rather than after a fixed delay.
+	 */
 	swrm_wait_for_fifo_avail(swrm, SWRM_RD_CHECK_AVAIL);
 retry_read:
 	*cmd_data = swr_master_read(swrm, SWRM_CMD_FIFO_RD_FIFO(swrm->ee_val));
@@ -962,6 +1050,8 @@ retry_read:
 				swr_master_write(swrm,
 					SWRM_CMD_FIFO_RD_CMD(swrm->ee_val),
 					val);
+				/* not accounted, re-read the FIFO level */
+				swrm->wr_fifo_credits = 0;
 			}
 			retry_attempt++;
 			goto retry_read;
@@ -996,18 +1086,14 @@ static int swrm_cmd_fifo_wr_cmd(struct swr_mstr_ctrl *swrm, u8 cmd_data,
 	dev_dbg(swrm->dev, "%s: reg: 0x%x, cmd_id: 0x%x,wcmd_id: 0x%x, \
 			dev_num: 0x%x, cmd_data: 0x%x\n", __func__,
 			reg_addr, cmd_id, swrm->wcmd_id,dev_addr, cmd_data);
+	swrm->fifo_stats.wr_cmds++;
 	/*
 	 * Check for outstanding cmd wrt. write fifo depth to avoid
-	 * overflow.
+	 * overflow. With a free slot accounted for there is no need to
+	 * wait for the command to complete, it is left queued in the FIFO.
 	 */
 	swrm_wait_for_fifo_avail(swrm, SWRM_WR_CHECK_AVAIL);
 	swr_master_write(swrm, SWRM_CMD_FIFO_WR_CMD(swrm->ee_val), val);
-	/*
-	 * wait for FIFO WR command to complete to avoid overflow
-	 * skip delay if write is handled in platform driver.
-	 */
-	if(!swrm->write)
-		usleep_range(150, 155);
 	if (cmd_id == 0xF) {
 		/*
 		 * sleep for 10ms for MSM soundwire variant to allow broadcast
@@ -2245,11 +2331,20 @@ handle_irq:
 				__func__, value);
 			break;
 		case SWRM_INTERRUPT_STATUS_CMD_ERROR:
+			/*
+			 * Writes are left queued in the FIFO without waiting
+			 * for completion, so the flush drops whatever is still
+			 * pending. Count them and resync the write credits.
+			 */
+			mutex_lock(&swrm->iolock);
 			value = swr_master_read(swrm, SWRM_CMD_FIFO_STATUS(swrm->ee_val));
-			dev_err_ratelimited(swrm->dev,
-			"%s: SWR CMD error, fifo status 0x%x, flushing fifo\n",
-					__func__, value);
 			swr_master_write(swrm, SWRM_CMD_FIFO_CMD, 0x1);
+			swrm->wr_fifo_credits = 0;
+			swrm->fifo_stats.wr_flushed += (value & 0x00001F00) >> 8;
+			mutex_unlock(&swrm->iolock);
+			dev_err_ratelimited(swrm->dev,
+			"%s: SWR CMD error, fifo status 0x%x, flushed %u queued writes\n",
+					__func__, value, (value & 0x00001F00) >> 8);
 			break;
 		case SWRM_INTERRUPT_STATUS_DOUT_PORT_COLLISION:
 			dev_err_ratelimited(swrm->dev,
@@ -3143,6 +3238,12 @@ static int swrm_probe(struct platform_device *pdev)
 				   S_IFREG | 0444, swrm->debugfs_swrm_dent,
 				   (void *) swrm,
 				   &swrm_debug_dump_ops);
+
+		swrm->debugfs_fifo_stats = debugfs_create_file(
+				   "swrm_fifo_stats",
+				   S_IFREG | 0444, swrm->debugfs_swrm_dent,
+				   (void *) swrm,
+				   &swrm_debug_fifo_stats_ops);
 	}
 #endif
 	pm_runtime_set_autosuspend_delay(&pdev->dev, auto_suspend_timer);
@@ -3491,6 +3592,9 @@ chk_lnk_status:
 		if (!swrm_check_link_status(swrm, 0x0))
 			dev_dbg(dev, "%s:failed in disconnecting, ssr?\n",
 				__func__);
+		/* let the clock stop and device down writes reach the bus */
+		if (current_state == SWR_MSTR_UP)
+			swrm_wait_for_fifo_drain(swrm);
 		ret = swrm_clk_request(swrm, false);
 		if (ret) {
 			dev_err_ratelimited(dev, "%s: swrmn clk failed\n", __func__);
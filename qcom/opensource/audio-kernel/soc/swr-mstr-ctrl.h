@@ -104,6 +104,16 @@ struct swrm_port_type {
 	u8 ch_mask;
 };
 
+/* Command FIFO counters, updated under iolock */
+struct swrm_fifo_stats {
+	u64 wr_cmds;
+	u64 rd_cmds;
+	u64 wr_full_waits;
+	u64 rd_waits;
+	u64 wait_us;
+	u64 wr_flushed;
+};
+
 struct swr_ctrl_platform_data {
 	void *handle; /* holds priv data */
 	int (*read)(void *handle, int reg);
@@ -194,6 +204,8 @@ struct swr_mstr_ctrl {
 	u32 disable_div2_clk_switch;
 	u32 rd_fifo_depth;
 	u32 wr_fifo_depth;
+	u32 wr_fifo_credits; /* write FIFO slots known to be free */
+	struct swrm_fifo_stats fifo_stats;
 	u32 num_auto_enum;
 	bool enable_slave_irq;
 	u32 is_always_on;
@@ -204,6 +216,7 @@ struct swr_mstr_ctrl {
 	struct dentry *debugfs_peek;
 	struct dentry *debugfs_poke;
 	struct dentry *debugfs_reg_dump;
+	struct dentry *debugfs_fifo_stats;
 	unsigned int read_data;
 #endif
 };
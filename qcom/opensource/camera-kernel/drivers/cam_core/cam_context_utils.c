@@ -172,6 +172,8 @@ int cam_context_buf_done_from_hw(struct cam_context *ctx,
 	struct cam_hw_done_event_data *done =
 		(struct cam_hw_done_event_data *)done_event_data;
 	struct cam_packet *packet;
+	int32_t sync_ids[CAM_CTX_CFG_MAX];
+	uint32_t num_sync_ids = 0;
 
 	if (!ctx || !done) {
 		CAM_ERR(CAM_CTXT, "Invalid input params %pK %pK", ctx, done);
@@ -246,6 +248,9 @@ int cam_context_buf_done_from_hw(struct cam_context *ctx,
 				ctx->img_iommu_hdl, req->out_map_entries[j].resource_handle);
 			if (rc) {
 				CAM_ERR(CAM_CTXT, "Failed to retrieve image buffers rc:%d", rc);
+				if (num_sync_ids)
+					cam_sync_signal_batch(sync_ids, num_sync_ids,
+						result, done->evt_param);
 				cam_packet_util_put_packet_addr(req->pf_data.packet_handle);
 				return rc;
 			}
@@ -253,11 +258,21 @@ int cam_context_buf_done_from_hw(struct cam_context *ctx,
 
 		CAM_DBG(CAM_REQ, "fence %d signal with %d",
 			req->out_map_entries[j].sync_id, result);
-		cam_sync_signal(req->out_map_entries[j].sync_id, result,
-			done->evt_param);
+		sync_ids[num_sync_ids++] = req->out_map_entries[j].sync_id;
 		req->out_map_entries[j].sync_id = -1;
+
+		if (num_sync_ids == CAM_CTX_CFG_MAX) {
+			cam_sync_signal_batch(sync_ids, num_sync_ids, result,
+				done->evt_param);
+			num_sync_ids = 0;
+		}
 	}
 
+	/* merged fences shared by the out fences get their row lock once */
+	if (num_sync_ids)
+		cam_sync_signal_batch(sync_ids, num_sync_ids, result,
+			done->evt_param);
+
 	if (cam_presil_mode_enabled())
 		cam_packet_util_put_packet_addr(req->pf_data.packet_handle);
 
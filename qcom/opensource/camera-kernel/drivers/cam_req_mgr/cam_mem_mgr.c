@@ -11,6 +11,7 @@
 #include <linux/dma-buf.h>
 #include <linux/version.h>
 #include <linux/debugfs.h>
+#include <linux/ktime.h>
 #if IS_REACHABLE(CONFIG_DMABUF_HEAPS)
 #include <linux/mem-buf.h>
 #include <soc/qcom/secure_buffer.h>
@@ -176,6 +177,74 @@ static int cam_mem_util_unmap_cpu_va(struct dma_buf *dmabuf,
 	return rc;
 }
 
+static void cam_mem_lock(struct mutex *lock, struct cam_mem_lock_stats *stats)
+{
+	ktime_t start;
+	s64 wait_ns;
+
+	atomic64_inc(&stats->acquired);
+	if (mutex_trylock(lock))
+		return;
+
+	start = ktime_get();
+	mutex_lock(lock);
+	wait_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	atomic64_inc(&stats->contended);
+	atomic64_add(wait_ns, &stats->wait_ns);
+	if (wait_ns > atomic64_read(&stats->max_wait_ns))
+		atomic64_set(&stats->max_wait_ns, wait_ns);
+}
+
+static void cam_mem_lock_stats_reset(struct cam_mem_lock_stats *stats)
+{
+	atomic64_set(&stats->acquired, 0);
+	atomic64_set(&stats->contended, 0);
+	atomic64_set(&stats->wait_ns, 0);
+	atomic64_set(&stats->max_wait_ns, 0);
+}
+
+static int cam_mem_lock_stats_print(char *buf, size_t size, const char *name,
+	struct cam_mem_lock_stats *stats)
+{
+	return scnprintf(buf, size,
+		"%s: acquired %lld contended %lld wait_us %lld max_wait_us %lld\n",
+		name, atomic64_read(&stats->acquired),
+		atomic64_read(&stats->contended),
+		div_s64(atomic64_read(&stats->wait_ns), NSEC_PER_USEC),
+		div_s64(atomic64_read(&stats->max_wait_ns), NSEC_PER_USEC));
+}
+
+static ssize_t cam_mem_lock_stats_read(struct file *file, char __user *ubuf,
+	size_t size, loff_t *ppos)
+{
+	char buf[256];
+	int len = 0;
+
+	len += cam_mem_lock_stats_print(buf + len, sizeof(buf) - len,
+		"m_lock", &tbl.m_lock_stats);
+	len += cam_mem_lock_stats_print(buf + len, sizeof(buf) - len,
+		"q_lock", &tbl.q_lock_stats);
+
+	return simple_read_from_buffer(ubuf, size, ppos, buf, len);
+}
+
+static ssize_t cam_mem_lock_stats_write(struct file *file,
+	const char __user *ubuf, size_t size, loff_t *ppos)
+{
+	/* Any write clears the statistics */
+	cam_mem_lock_stats_reset(&tbl.m_lock_stats);
+	cam_mem_lock_stats_reset(&tbl.q_lock_stats);
+
+	return size;
+}
+
+static const struct file_operations cam_mem_lock_stats_fops = {
+	.open = simple_open,
+	.read = cam_mem_lock_stats_read,
+	.write = cam_mem_lock_stats_write,
+};
+
 static int cam_mem_mgr_create_debug_fs(void)
 {
 	int rc = 0;
@@ -198,6 +267,9 @@ static int cam_mem_mgr_create_debug_fs(void)
 
 	debugfs_create_bool("override_cpu_access_dir", 0644, g_cam_mem_mgr_debug.dentry,
 		&g_cam_mem_mgr_debug.override_cpu_access_dir);
+
+	debugfs_create_file("lock_stats", 0644, g_cam_mem_mgr_debug.dentry,
+		NULL, &cam_mem_lock_stats_fops);
 end:
 	return rc;
 }
@@ -242,9 +314,14 @@ int cam_mem_mgr_init(void)
 	for (i = 1; i < CAM_MEM_BUFQ_MAX; i++) {
 		tbl.bufq[i].fd = -1;
 		tbl.bufq[i].buf_handle = -1;
+		mutex_init(&tbl.bufq[i].q_lock);
 		cam_mem_mgr_reset_presil_params(i);
 	}
 	mutex_init(&tbl.m_lock);
+	hash_init(tbl.fd_hash);
+	spin_lock_init(&tbl.hash_lock);
+	cam_mem_lock_stats_reset(&tbl.m_lock_stats);
+	cam_mem_lock_stats_reset(&tbl.q_lock_stats);
 
 	atomic_set(&cam_mem_mgr_state, CAM_MEM_MGR_INITIALIZED);
 
@@ -260,39 +337,54 @@ put_heaps:
 	return rc;
 }
 
+/*
+ * Slots are claimed with an atomic test_and_set_bit so allocations do not
+ * serialize on m_lock; q_lock of every slot lives for the lifetime of the
+ * table, so a stale handle racing with a new owner only sees a handle
+ * mismatch under q_lock.
+ */
 static int32_t cam_mem_get_slot(void)
 {
 	int32_t idx;
 
-	mutex_lock(&tbl.m_lock);
-	idx = find_first_zero_bit(tbl.bitmap, tbl.bits);
-	if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0) {
-		mutex_unlock(&tbl.m_lock);
-		return -ENOMEM;
-	}
+	do {
+		idx = find_first_zero_bit(tbl.bitmap, tbl.bits);
+		if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0)
+			return -ENOMEM;
+	} while (test_and_set_bit(idx, tbl.bitmap));
 
-	set_bit(idx, tbl.bitmap);
+	cam_mem_lock(&tbl.bufq[idx].q_lock, &tbl.q_lock_stats);
 	tbl.bufq[idx].active = true;
 	tbl.bufq[idx].release_deferred = false;
 	CAM_GET_TIMESTAMP((tbl.bufq[idx].timestamp));
-	mutex_init(&tbl.bufq[idx].q_lock);
-	mutex_unlock(&tbl.m_lock);
+	mutex_unlock(&tbl.bufq[idx].q_lock);
 
 	return idx;
 }
 
 static void cam_mem_put_slot(int32_t idx)
 {
-	mutex_lock(&tbl.m_lock);
-	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_lock(&tbl.bufq[idx].q_lock, &tbl.q_lock_stats);
 	tbl.bufq[idx].active = false;
 	tbl.bufq[idx].release_deferred = false;
 	tbl.bufq[idx].is_internal = false;
 	memset(&tbl.bufq[idx].timestamp, 0, sizeof(struct timespec64));
 	mutex_unlock(&tbl.bufq[idx].q_lock);
-	mutex_destroy(&tbl.bufq[idx].q_lock);
 	clear_bit(idx, tbl.bitmap);
-	mutex_unlock(&tbl.m_lock);
+}
+
+static void cam_mem_util_hash_add(int32_t idx)
+{
+	spin_lock(&tbl.hash_lock);
+	hash_add(tbl.fd_hash, &tbl.bufq[idx].hnode, tbl.bufq[idx].fd);
+	spin_unlock(&tbl.hash_lock);
+}
+
+static void cam_mem_util_hash_del(int32_t idx)
+{
+	spin_lock(&tbl.hash_lock);
+	hash_del(&tbl.bufq[idx].hnode);
+	spin_unlock(&tbl.hash_lock);
 }
 
 int cam_mem_get_io_buf(int32_t buf_handle, int32_t mmu_handle,
@@ -317,7 +409,7 @@ int cam_mem_get_io_buf(int32_t buf_handle, int32_t mmu_handle,
 		return -EAGAIN;
 	}
 
-	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_lock(&tbl.bufq[idx].q_lock, &tbl.q_lock_stats);
 	if (buf_handle != tbl.bufq[idx].buf_handle) {
 		rc = -EINVAL;
 		goto handle_mismatch;
@@ -414,7 +506,7 @@ int cam_mem_mgr_cache_ops(struct cam_mem_cache_ops_cmd *cmd)
 	if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0)
 		return -EINVAL;
 
-	mutex_lock(&tbl.m_lock);
+	cam_mem_lock(&tbl.m_lock, &tbl.m_lock_stats);
 
 	if (!test_bit(idx, tbl.bitmap)) {
 		CAM_ERR(CAM_MEM, "Buffer at idx=%d is already unmapped,",
@@ -423,7 +515,7 @@ int cam_mem_mgr_cache_ops(struct cam_mem_cache_ops_cmd *cmd)
 		return -EINVAL;
 	}
 
-	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_lock(&tbl.bufq[idx].q_lock, &tbl.q_lock_stats);
 	mutex_unlock(&tbl.m_lock);
 
 	if (cmd->buf_handle != tbl.bufq[idx].buf_handle) {
@@ -506,7 +598,7 @@ int cam_mem_mgr_cpu_access_op(struct cam_mem_cpu_access_op *cmd)
 		return -EINVAL;
 	}
 
-	mutex_lock(&tbl.m_lock);
+	cam_mem_lock(&tbl.m_lock, &tbl.m_lock_stats);
 
 	if (!test_bit(idx, tbl.bitmap)) {
 		CAM_ERR(CAM_MEM, "Buffer at idx=%d is already freed/unmapped", idx);
@@ -514,7 +606,7 @@ int cam_mem_mgr_cpu_access_op(struct cam_mem_cpu_access_op *cmd)
 		return -EINVAL;
 	}
 
-	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_lock(&tbl.bufq[idx].q_lock, &tbl.q_lock_stats);
 	mutex_unlock(&tbl.m_lock);
 
 	if (cmd->buf_handle != tbl.bufq[idx].buf_handle) {
@@ -1162,7 +1254,7 @@ int cam_mem_mgr_alloc_and_map(struct cam_mem_mgr_alloc_cmd_v2 *cmd)
 		}
 	}
 
-	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_lock(&tbl.bufq[idx].q_lock, &tbl.q_lock_stats);
 	tbl.bufq[idx].fd = fd;
 	tbl.bufq[idx].i_ino = i_ino;
 	tbl.bufq[idx].dma_buf = NULL;
@@ -1196,6 +1288,7 @@ int cam_mem_mgr_alloc_and_map(struct cam_mem_mgr_alloc_cmd_v2 *cmd)
 	kref_init(&tbl.bufq[idx].krefcount);
 	tbl.bufq[idx].smmu_mapping_client = CAM_SMMU_MAPPING_USER;
 	strscpy(tbl.bufq[idx].buf_name, cmd->buf_name, sizeof(tbl.bufq[idx].buf_name));
+	cam_mem_util_hash_add(idx);
 	mutex_unlock(&tbl.bufq[idx].q_lock);
 
 	cmd->out.buf_handle = tbl.bufq[idx].buf_handle;
@@ -1220,17 +1313,17 @@ slot_fail:
 
 static bool cam_mem_util_is_map_internal(int32_t fd, unsigned i_ino)
 {
-	uint32_t i;
+	struct cam_mem_buf_queue *bufq;
 	bool is_internal = false;
 
-	mutex_lock(&tbl.m_lock);
-	for_each_set_bit(i, tbl.bitmap, tbl.bits) {
-		if ((tbl.bufq[i].fd == fd) && (tbl.bufq[i].i_ino == i_ino)) {
-			is_internal = tbl.bufq[i].is_internal;
+	spin_lock(&tbl.hash_lock);
+	hash_for_each_possible(tbl.fd_hash, bufq, hnode, fd) {
+		if ((bufq->fd == fd) && (bufq->i_ino == i_ino)) {
+			is_internal = bufq->is_internal;
 			break;
 		}
 	}
-	mutex_unlock(&tbl.m_lock);
+	spin_unlock(&tbl.hash_lock);
 
 	return is_internal;
 }
@@ -1315,7 +1408,7 @@ int cam_mem_mgr_map(struct cam_mem_mgr_map_cmd_v2 *cmd)
 		}
 	}
 
-	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_lock(&tbl.bufq[idx].q_lock, &tbl.q_lock_stats);
 	tbl.bufq[idx].fd = cmd->fd;
 	tbl.bufq[idx].i_ino = i_ino;
 	tbl.bufq[idx].dma_buf = NULL;
@@ -1340,6 +1433,7 @@ int cam_mem_mgr_map(struct cam_mem_mgr_map_cmd_v2 *cmd)
 	kref_init(&tbl.bufq[idx].krefcount);
 	tbl.bufq[idx].smmu_mapping_client = CAM_SMMU_MAPPING_USER;
 	strscpy(tbl.bufq[idx].buf_name, cmd->buf_name, sizeof(tbl.bufq[idx].buf_name));
+	cam_mem_util_hash_add(idx);
 	mutex_unlock(&tbl.bufq[idx].q_lock);
 
 	cmd->out.buf_handle = tbl.bufq[idx].buf_handle;
@@ -1447,7 +1541,7 @@ static int cam_mem_mgr_cleanup_table(void)
 {
 	int i;
 
-	mutex_lock(&tbl.m_lock);
+	cam_mem_lock(&tbl.m_lock, &tbl.m_lock_stats);
 	for (i = 1; i < CAM_MEM_BUFQ_MAX; i++) {
 		if (!tbl.bufq[i].active) {
 			CAM_DBG(CAM_MEM,
@@ -1460,11 +1554,12 @@ static int cam_mem_mgr_cleanup_table(void)
 			cam_mem_mgr_unmap_active_buf(i);
 		}
 
-		mutex_lock(&tbl.bufq[i].q_lock);
+		cam_mem_lock(&tbl.bufq[i].q_lock, &tbl.q_lock_stats);
 		if (tbl.bufq[i].dma_buf) {
 			dma_buf_put(tbl.bufq[i].dma_buf);
 			tbl.bufq[i].dma_buf = NULL;
 		}
+		cam_mem_util_hash_del(i);
 		tbl.bufq[i].fd = -1;
 		tbl.bufq[i].i_ino = 0;
 		tbl.bufq[i].flags = 0;
@@ -1480,7 +1575,6 @@ static int cam_mem_mgr_cleanup_table(void)
 		tbl.bufq[i].is_internal = false;
 		cam_mem_mgr_reset_presil_params(i);
 		mutex_unlock(&tbl.bufq[i].q_lock);
-		mutex_destroy(&tbl.bufq[i].q_lock);
 	}
 
 	bitmap_zero(tbl.bitmap, tbl.bits);
@@ -1493,17 +1587,21 @@ static int cam_mem_mgr_cleanup_table(void)
 
 void cam_mem_mgr_deinit(void)
 {
+	int i;
+
 	if (!atomic_read(&cam_mem_mgr_state))
 		return;
 
 	atomic_set(&cam_mem_mgr_state, CAM_MEM_MGR_UNINITIALIZED);
 	cam_mem_mgr_cleanup_table();
-	mutex_lock(&tbl.m_lock);
+	cam_mem_lock(&tbl.m_lock, &tbl.m_lock_stats);
 	bitmap_zero(tbl.bitmap, tbl.bits);
 	kfree(tbl.bitmap);
 	tbl.bitmap = NULL;
 	tbl.dbg_buf_idx = -1;
 	mutex_unlock(&tbl.m_lock);
+	for (i = 1; i < CAM_MEM_BUFQ_MAX; i++)
+		mutex_destroy(&tbl.bufq[i].q_lock);
 	mutex_destroy(&tbl.m_lock);
 }
 
@@ -1526,7 +1624,7 @@ static void cam_mem_util_unmap(struct kref *kref)
 
 	CAM_DBG(CAM_MEM, "Flags = %X idx %d", tbl.bufq[idx].flags, idx);
 
-	mutex_lock(&tbl.m_lock);
+	cam_mem_lock(&tbl.m_lock, &tbl.m_lock_stats);
 	if ((!tbl.bufq[idx].active) &&
 		(tbl.bufq[idx].vaddr) == 0) {
 		CAM_WARN(CAM_MEM, "Buffer at idx=%d is already unmapped,",
@@ -1536,7 +1634,7 @@ static void cam_mem_util_unmap(struct kref *kref)
 	}
 
 	/* Deactivate the buffer queue to prevent multiple unmap */
-	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_lock(&tbl.bufq[idx].q_lock, &tbl.q_lock_stats);
 	tbl.bufq[idx].active = false;
 	tbl.bufq[idx].vaddr = 0;
 	tbl.bufq[idx].release_deferred = false;
@@ -1571,8 +1669,8 @@ static void cam_mem_util_unmap(struct kref *kref)
 				tbl.bufq[idx].dma_buf);
 	}
 
-	mutex_lock(&tbl.m_lock);
-	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_lock(&tbl.m_lock, &tbl.m_lock_stats);
+	cam_mem_lock(&tbl.bufq[idx].q_lock, &tbl.q_lock_stats);
 	tbl.bufq[idx].flags = 0;
 	tbl.bufq[idx].buf_handle = -1;
 	memset(tbl.bufq[idx].hdls, 0,
@@ -1586,6 +1684,7 @@ static void cam_mem_util_unmap(struct kref *kref)
 	if (tbl.bufq[idx].dma_buf)
 		dma_buf_put(tbl.bufq[idx].dma_buf);
 
+	cam_mem_util_hash_del(idx);
 	tbl.bufq[idx].fd = -1;
 	tbl.bufq[idx].i_ino = 0;
 	tbl.bufq[idx].dma_buf = NULL;
@@ -1596,7 +1695,6 @@ static void cam_mem_util_unmap(struct kref *kref)
 	cam_mem_mgr_reset_presil_params(idx);
 	memset(&tbl.bufq[idx].timestamp, 0, sizeof(struct timespec64));
 	mutex_unlock(&tbl.bufq[idx].q_lock);
-	mutex_destroy(&tbl.bufq[idx].q_lock);
 	clear_bit(idx, tbl.bitmap);
 	mutex_unlock(&tbl.m_lock);
 
@@ -1806,7 +1904,7 @@ int cam_mem_mgr_request_mem(struct cam_mem_mgr_request_desc *inp,
 		goto slot_fail;
 	}
 
-	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_lock(&tbl.bufq[idx].q_lock, &tbl.q_lock_stats);
 	mem_handle = GET_MEM_HANDLE(idx, ion_fd);
 	tbl.bufq[idx].dma_buf = buf;
 	tbl.bufq[idx].fd = -1;
@@ -1973,7 +2071,7 @@ int cam_mem_mgr_reserve_memory_region(struct cam_mem_mgr_request_desc *inp,
 		goto slot_fail;
 	}
 
-	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_lock(&tbl.bufq[idx].q_lock, &tbl.q_lock_stats);
 	mem_handle = GET_MEM_HANDLE(idx, ion_fd);
 	tbl.bufq[idx].fd = -1;
 	tbl.bufq[idx].i_ino = i_ino;
@@ -9,12 +9,16 @@
 
 #include <linux/mutex.h>
 #include <linux/dma-buf.h>
+#include <linux/hashtable.h>
+#include <linux/spinlock.h>
 #if IS_REACHABLE(CONFIG_DMABUF_HEAPS)
 #include <linux/dma-heap.h>
 #endif
 #include <media/cam_req_mgr.h>
 #include "cam_mem_mgr_api.h"
 
+#define CAM_MEM_FD_HASH_BITS 6
+
 /* Enum for possible mem mgr states */
 enum cam_mem_mgr_state {
 	CAM_MEM_MGR_UNINITIALIZED,
@@ -59,6 +63,7 @@ struct cam_presil_dmabuf_params {
  * @smmu_mapping_client: Client buffer (User or kernel)
  * @buf_name:       Name associated with buffer.
  * @presil_params:  Parameters specific to presil environment
+ * @hnode:          Node in the (fd, i_ino) lookup hash of the table
  */
 struct cam_mem_buf_queue {
 	struct dma_buf *dma_buf;
@@ -85,6 +90,22 @@ struct cam_mem_buf_queue {
 #ifdef CONFIG_CAM_PRESIL
 	struct cam_presil_dmabuf_params presil_params;
 #endif
+	struct hlist_node hnode;
+};
+
+/**
+ * struct cam_mem_lock_stats
+ *
+ * @acquired:    Number of times the lock was taken
+ * @contended:   Number of times the lock was found held and had to wait
+ * @wait_ns:     Total time spent waiting for the lock
+ * @max_wait_ns: Longest single wait for the lock
+ */
+struct cam_mem_lock_stats {
+	atomic64_t acquired;
+	atomic64_t contended;
+	atomic64_t wait_ns;
+	atomic64_t max_wait_ns;
 };
 
 /**
@@ -104,6 +125,10 @@ struct cam_mem_buf_queue {
  * @camera_uncached_heap: Handle to camera uncached heap
  * @secure_display_heap: Handle to secure display heap
  * @ubwc_p_heap: Handle to ubwc-p heap
+ * @fd_hash: Index of active user buffers keyed on fd, matched on (fd, i_ino)
+ * @hash_lock: Lock protecting fd_hash
+ * @m_lock_stats: Contention statistics of m_lock
+ * @q_lock_stats: Contention statistics of all buffer q_locks
  */
 struct cam_mem_table {
 	struct mutex m_lock;
@@ -121,7 +146,10 @@ struct cam_mem_table {
 	struct dma_heap *secure_display_heap;
 	struct dma_heap *ubwc_p_heap;
 #endif
-
+	DECLARE_HASHTABLE(fd_hash, CAM_MEM_FD_HASH_BITS);
+	spinlock_t hash_lock;
+	struct cam_mem_lock_stats m_lock_stats;
+	struct cam_mem_lock_stats q_lock_stats;
 };
 
 /**
@@ -78,6 +78,7 @@ void cam_req_mgr_core_link_reset(struct cam_req_mgr_core_link *link)
 	link->cont_empty_slots = 0;
 	link->is_shdr = false;
 	link->wait_for_dual_trigger = false;
+	memset(&link->telemetry, 0, sizeof(link->telemetry));
 	link->debug_data.num_skip_frames = 0;
 	__cam_req_mgr_reset_apply_data(link);
 
@@ -324,6 +325,7 @@ static int __cam_req_mgr_notify_frame_skip(
 	struct cam_req_mgr_tbl_slot         *slot = NULL;
 
 	apply_data = link->req.prev_apply_data;
+	link->telemetry.skip_cnt++;
 
 	for (i = 0; i < link->num_devs; i++) {
 		dev = &link->l_dev[i];
@@ -594,6 +596,83 @@ static int __cam_req_mgr_traverse(struct cam_req_mgr_traverse *traverse_data)
 	return 0;
 }
 
+/**
+ * __cam_req_mgr_lat_hist_add()
+ *
+ * @brief    : Account latency since start in a power of two ms histogram,
+ *             bin i counts latencies below (1 << i) ms, last bin the rest
+ * @hist     : histogram with CAM_REQ_MGR_LAT_HIST_BINS bins
+ * @start    : start time of the measured interval
+ *
+ */
+static void __cam_req_mgr_lat_hist_add(uint32_t *hist, ktime_t start)
+{
+	s64 ms = ktime_ms_delta(ktime_get(), start);
+	int bin = (ms > 0) ? fls((uint32_t)min_t(s64, ms, U32_MAX)) : 0;
+
+	hist[min(bin, CAM_REQ_MGR_LAT_HIST_BINS - 1)]++;
+}
+
+/**
+ * __cam_req_mgr_slot_unmap_req()
+ *
+ * @brief    : Drop req id held by a slot from the req id index
+ * @in_q     : input queue pointer
+ * @idx      : slot index
+ *
+ */
+static void __cam_req_mgr_slot_unmap_req(struct cam_req_mgr_req_queue *in_q,
+	int32_t idx)
+{
+	struct cam_req_mgr_slot *slot = &in_q->slot[idx];
+	int32_t                  key;
+
+	if (slot->req_id < 0)
+		return;
+
+	if (slot->indexed) {
+		key = slot->req_id & (CAM_REQ_MGR_REQ_MAP_SIZE - 1);
+		if (in_q->req_map[key] == idx)
+			in_q->req_map[key] = -1;
+		slot->indexed = false;
+	} else {
+		in_q->num_unindexed--;
+	}
+}
+
+/**
+ * __cam_req_mgr_slot_set_req()
+ *
+ * @brief    : Store req id in a slot and index it by req id. A live req id
+ *             colliding in the index loses its entry and is only found by
+ *             the fallback scan until its slot is reused.
+ * @in_q     : input queue pointer
+ * @idx      : slot index
+ * @req_id   : req id to store, -1 to clear the slot
+ *
+ */
+static void __cam_req_mgr_slot_set_req(struct cam_req_mgr_req_queue *in_q,
+	int32_t idx, int64_t req_id)
+{
+	struct cam_req_mgr_slot *slot = &in_q->slot[idx];
+	int32_t                  key, old;
+
+	__cam_req_mgr_slot_unmap_req(in_q, idx);
+	slot->req_id = req_id;
+	slot->apply_ts = 0;
+	if (req_id < 0)
+		return;
+
+	key = req_id & (CAM_REQ_MGR_REQ_MAP_SIZE - 1);
+	old = in_q->req_map[key];
+	if ((old >= 0) && (old != idx) && in_q->slot[old].indexed) {
+		in_q->slot[old].indexed = false;
+		in_q->num_unindexed++;
+	}
+	in_q->req_map[key] = idx;
+	slot->indexed = true;
+}
+
 /**
  * __cam_req_mgr_in_q_skip_idx()
  *
@@ -607,7 +686,7 @@ static int __cam_req_mgr_traverse(struct cam_req_mgr_traverse *traverse_data)
 static void __cam_req_mgr_in_q_skip_idx(struct cam_req_mgr_req_queue *in_q,
 	int32_t idx)
 {
-	in_q->slot[idx].req_id = -1;
+	__cam_req_mgr_slot_set_req(in_q, idx, -1);
 	in_q->slot[idx].skip_idx = 1;
 	CAM_DBG(CAM_CRM, "SET IDX SKIP on slot= %d", idx);
 }
@@ -679,6 +758,21 @@ static int32_t __cam_req_mgr_find_slot_for_req(
 	int32_t                   idx, i;
 	struct cam_req_mgr_slot  *slot;
 
+	if (req_id >= 0) {
+		idx = in_q->req_map[req_id & (CAM_REQ_MGR_REQ_MAP_SIZE - 1)];
+		if ((idx >= 0) && (in_q->slot[idx].req_id == req_id)) {
+			CAM_DBG(CAM_CRM,
+				"req: %lld found at idx: %d status: %d sync_mode: %d",
+				req_id, idx, in_q->slot[idx].status,
+				in_q->slot[idx].sync_mode);
+			return idx;
+		}
+
+		/* Every live req id is indexed, so the miss is final */
+		if (!in_q->num_unindexed)
+			return -1;
+	}
+
 	idx = in_q->rd_idx;
 	for (i = 0; i < in_q->num_slots; i++) {
 		slot = &in_q->slot[idx];
@@ -769,7 +863,7 @@ static void __cam_req_mgr_flush_req_slot(
 			__cam_req_mgr_disconnect_req_on_sync_link(link, slot);
 
 		/* Reset input queue slot */
-		slot->req_id = -1;
+		__cam_req_mgr_slot_set_req(in_q, idx, -1);
 		slot->skip_idx = 1;
 		slot->recover = 0;
 		slot->additional_timeout = 0;
@@ -834,7 +928,7 @@ static void __cam_req_mgr_reset_req_slot(struct cam_req_mgr_core_link *link,
 		__cam_req_mgr_disconnect_req_on_sync_link(link, slot);
 
 	/* Reset input queue slot */
-	slot->req_id = -1;
+	__cam_req_mgr_slot_set_req(in_q, idx, -1);
 	slot->skip_idx = 0;
 	slot->recover = 0;
 	slot->additional_timeout = 0;
@@ -2304,6 +2398,13 @@ static int __cam_req_mgr_process_req(struct cam_req_mgr_core_link *link,
 			(eof_trigger_type == CAM_REQ_EOF_TRIGGER_APPLIED)) &&
 			(trigger == CAM_TRIGGER_POINT_SOF)) {
 			slot->status = CRM_SLOT_STATUS_REQ_APPLIED;
+			slot->apply_ts = ktime_get();
+			if (link->telemetry.sof_ts) {
+				__cam_req_mgr_lat_hist_add(
+					link->telemetry.sof_to_apply,
+					link->telemetry.sof_ts);
+				link->telemetry.sof_ts = 0;
+			}
 
 			CAM_DBG(CAM_CRM, "req %d is applied on link %x",
 				slot->req_id,
@@ -2450,10 +2551,16 @@ static int  __cam_req_mgr_setup_in_q(struct cam_req_mgr_req_data *req)
 	for (i = 0; i < in_q->num_slots; i++) {
 		in_q->slot[i].idx = i;
 		in_q->slot[i].req_id = -1;
+		in_q->slot[i].indexed = false;
+		in_q->slot[i].apply_ts = 0;
 		in_q->slot[i].skip_idx = 0;
 		in_q->slot[i].status = CRM_SLOT_STATUS_NO_REQ;
 	}
 
+	for (i = 0; i < CAM_REQ_MGR_REQ_MAP_SIZE; i++)
+		in_q->req_map[i] = -1;
+	in_q->num_unindexed = 0;
+
 	in_q->wr_idx = 0;
 	in_q->rd_idx = 0;
 	mutex_unlock(&req->lock);
@@ -2472,6 +2579,7 @@ static int  __cam_req_mgr_setup_in_q(struct cam_req_mgr_req_data *req)
  */
 static int __cam_req_mgr_reset_in_q(struct cam_req_mgr_req_data *req)
 {
+	int                           i;
 	struct cam_req_mgr_req_queue *in_q = req->in_q;
 
 	if (!in_q) {
@@ -2484,6 +2592,10 @@ static int __cam_req_mgr_reset_in_q(struct cam_req_mgr_req_data *req)
 		sizeof(struct cam_req_mgr_slot) * in_q->num_slots);
 	in_q->num_slots = 0;
 
+	for (i = 0; i < CAM_REQ_MGR_REQ_MAP_SIZE; i++)
+		in_q->req_map[i] = -1;
+	in_q->num_unindexed = 0;
+
 	in_q->wr_idx = 0;
 	in_q->rd_idx = 0;
 	mutex_unlock(&req->lock);
@@ -3073,7 +3185,7 @@ int cam_req_mgr_process_sched_req(void *priv, void *data)
 		CAM_WARN(CAM_CRM, "in_q overwrite %d", slot->status);
 
 	slot->status = CRM_SLOT_STATUS_REQ_ADDED;
-	slot->req_id = sched_req->req_id;
+	__cam_req_mgr_slot_set_req(in_q, in_q->wr_idx, sched_req->req_id);
 	slot->sync_mode = sched_req->sync_mode;
 	slot->skip_idx = 0;
 	slot->recover = sched_req->bubble_enable;
@@ -3506,6 +3618,8 @@ int cam_req_mgr_process_error(void *priv, void *data)
 	switch (err_info->error) {
 	case CRM_KMD_ERR_BUBBLE:
 	case CRM_KMD_WARN_INTERNAL_RECOVERY:
+		if (err_info->error == CRM_KMD_ERR_BUBBLE)
+			link->telemetry.bubble_cnt++;
 		idx = __cam_req_mgr_find_slot_for_req(in_q, err_info->req_id);
 		if (idx < 0) {
 			CAM_ERR_RATE_LIMIT(CAM_CRM,
@@ -3683,9 +3797,16 @@ static int cam_req_mgr_process_trigger(void *priv, void *data)
 	mutex_lock(&link->req.lock);
 
 	if (trigger_data->trigger == CAM_TRIGGER_POINT_SOF) {
+		link->telemetry.sof_ts = task_data->queue_ts;
 		idx = __cam_req_mgr_find_slot_for_req(in_q,
 			trigger_data->req_id);
 		if (idx >= 0) {
+			if (in_q->slot[idx].apply_ts) {
+				__cam_req_mgr_lat_hist_add(
+					link->telemetry.apply_to_done,
+					in_q->slot[idx].apply_ts);
+				in_q->slot[idx].apply_ts = 0;
+			}
 			if (idx == in_q->last_applied_idx)
 				in_q->last_applied_idx = -1;
 			if (idx == in_q->rd_idx)
@@ -4176,6 +4297,7 @@ static int cam_req_mgr_cb_notify_trigger(
 		goto end;
 	}
 	task_data = (struct crm_task_payload *)task->payload;
+	task_data->queue_ts = ktime_get();
 	task_data->type = (trigger_data->trigger == CAM_TRIGGER_POINT_SOF) ?
 		CRM_WORKQ_TASK_NOTIFY_SOF : CRM_WORKQ_TASK_NOTIFY_EOF;
 	notify_trigger = (struct cam_req_mgr_trigger_notify *)&task_data->u;
@@ -8,6 +8,7 @@
 #define _CAM_REQ_MGR_CORE_H_
 
 #include <linux/spinlock_types.h>
+#include <linux/ktime.h>
 #include "cam_req_mgr_interface.h"
 #include "cam_req_mgr_core_defs.h"
 #include "cam_req_mgr_workq.h"
@@ -15,6 +16,8 @@
 
 #define CAM_REQ_MGR_MAX_LINKED_DEV     16
 #define MAX_REQ_SLOTS                  48
+#define CAM_REQ_MGR_REQ_MAP_SIZE       64
+#define CAM_REQ_MGR_LAT_HIST_BINS      8
 
 #define CAM_REQ_MGR_WATCHDOG_TIMEOUT          1000
 #define CAM_REQ_MGR_WATCHDOG_TIMEOUT_DEFAULT  5000
@@ -86,10 +89,12 @@ enum crm_workq_task_type {
  * @send_req       : contains info of apply settings to be sent to devs in link
  * @notify_trigger : contains notification from IFE to CRM about trigger
  * @notify_err     : contains error info happened while processing request
+ * @queue_ts       : time at which the task was queued
  * -
  */
 struct crm_task_payload {
 	enum crm_workq_task_type type;
+	ktime_t                  queue_ts;
 	union {
 		struct cam_req_mgr_sched_request_v2     sched_req;
 		struct cam_req_mgr_flush_info           flush_info;
@@ -292,6 +297,8 @@ struct cam_req_mgr_req_tbl {
  * @recovery_counter   : Internal recovery counter
  * @num_sync_links     : Num of sync links
  * @sync_link_hdls     : Array of sync link handles
+ * @indexed            : req_id of this slot is reachable through req_map
+ * @apply_ts           : time at which req in this slot was applied at SOF
  */
 struct cam_req_mgr_slot {
 	int32_t               idx;
@@ -304,6 +311,8 @@ struct cam_req_mgr_slot {
 	int32_t               recovery_counter;
 	int32_t               num_sync_links;
 	int32_t               sync_link_hdls[MAXIMUM_LINKS_PER_SESSION - 1];
+	bool                  indexed;
+	ktime_t               apply_ts;
 };
 
 /**
@@ -313,6 +322,10 @@ struct cam_req_mgr_slot {
  * @rd_idx      : indicates slot index currently in process.
  * @wr_idx      : indicates slot index to hold new upcoming req.
  * @last_applied_idx : indicates slot index last applied successfully.
+ * @req_map     : slot index of a req id, indexed by req_id modulo map size.
+ *                Entries are validated against the req_id of the slot.
+ * @num_unindexed : live slots evicted from req_map by a colliding req id,
+ *                  a lookup miss is only final when this is zero.
  */
 struct cam_req_mgr_req_queue {
 	int32_t                     num_slots;
@@ -320,6 +333,8 @@ struct cam_req_mgr_req_queue {
 	int32_t                     rd_idx;
 	int32_t                     wr_idx;
 	int32_t                     last_applied_idx;
+	int32_t                     req_map[CAM_REQ_MGR_REQ_MAP_SIZE];
+	int32_t                     num_unindexed;
 };
 
 /**
@@ -369,6 +384,23 @@ struct cam_req_mgr_debug_data {
 	uint64_t                       last_applied_req;
 };
 
+/**
+ * struct cam_req_mgr_link_telemetry
+ * @sof_ts        : queue time of the SOF trigger being processed
+ * @sof_to_apply  : histogram of SOF notification to successful apply latency
+ * @apply_to_done : histogram of apply to the SOF at which the device reports
+ *                  the request as consumed
+ * @bubble_cnt    : number of bubbles reported on the link
+ * @skip_cnt      : number of frames skipped on the link
+ */
+struct cam_req_mgr_link_telemetry {
+	ktime_t                        sof_ts;
+	uint32_t                       sof_to_apply[CAM_REQ_MGR_LAT_HIST_BINS];
+	uint32_t                       apply_to_done[CAM_REQ_MGR_LAT_HIST_BINS];
+	uint32_t                       bubble_cnt;
+	uint32_t                       skip_cnt;
+};
+
 /**
  * struct cam_req_mgr_core_link
  * -  Link Properties
@@ -430,6 +462,7 @@ struct cam_req_mgr_debug_data {
  * @is_shdr              : flag to indicate auto shdr usecase without SFE
  * @wait_for_dual_trigger: Flag to indicate whether to wait for second epoch in dual trigger
  * @debug_data           : Debug data to be dump in case of receovery
+ * @telemetry            : Apply latency histograms and bubble statistics
  */
 struct cam_req_mgr_core_link {
 	int32_t                              link_hdl;
@@ -476,6 +509,7 @@ struct cam_req_mgr_core_link {
 	bool                                 is_shdr;
 	bool                                 wait_for_dual_trigger;
 	struct cam_req_mgr_debug_data        debug_data;
+	struct cam_req_mgr_link_telemetry    telemetry;
 };
 
 /**
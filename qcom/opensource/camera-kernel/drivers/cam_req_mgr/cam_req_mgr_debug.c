@@ -6,8 +6,10 @@
 #include "cam_req_mgr_debug.h"
 
 #define MAX_SESS_INFO_LINE_BUFF_LEN 256
+#define MAX_LINK_TELEMETRY_BUFF_LEN 4096
 
 static char sess_info_buffer[MAX_SESS_INFO_LINE_BUFF_LEN];
+static char link_telemetry_buffer[MAX_LINK_TELEMETRY_BUFF_LEN];
 static int cam_debug_mgr_delay_detect;
 
 static int cam_req_mgr_debug_set_bubble_recovery(void *data, u64 val)
@@ -111,6 +113,61 @@ static const struct file_operations session_info = {
 	.write = session_info_write,
 };
 
+static int link_telemetry_print_hist(char *buf, size_t size,
+	const char *name, uint32_t *hist)
+{
+	int i, len;
+
+	len = scnprintf(buf, size, "  %-13s:", name);
+	for (i = 0; i < CAM_REQ_MGR_LAT_HIST_BINS - 1; i++)
+		len += scnprintf(buf + len, size - len, " <%ums:%u",
+			1 << i, hist[i]);
+	len += scnprintf(buf + len, size - len, " >=%ums:%u\n",
+		1 << (CAM_REQ_MGR_LAT_HIST_BINS - 2), hist[i]);
+
+	return len;
+}
+
+static ssize_t link_telemetry_read(struct file *t_file, char *t_char,
+	size_t t_size_t, loff_t *t_loff_t)
+{
+	int i, len = 0;
+	char *out_buffer = link_telemetry_buffer;
+	size_t size = sizeof(link_telemetry_buffer);
+	struct cam_req_mgr_core_device *core_dev =
+		(struct cam_req_mgr_core_device *) t_file->private_data;
+	struct cam_req_mgr_core_session *session;
+	struct cam_req_mgr_link_telemetry *telemetry;
+
+	mutex_lock(&core_dev->crm_lock);
+
+	list_for_each_entry(session, &core_dev->session_head, entry) {
+		for (i = 0; i < session->num_links; i++) {
+			telemetry = &session->links[i]->telemetry;
+			len += scnprintf(out_buffer + len, size - len,
+				"link_hdl 0x%x: bubbles %u skipped %u\n",
+				session->links[i]->link_hdl,
+				telemetry->bubble_cnt, telemetry->skip_cnt);
+			len += link_telemetry_print_hist(out_buffer + len,
+				size - len, "sof_to_apply",
+				telemetry->sof_to_apply);
+			len += link_telemetry_print_hist(out_buffer + len,
+				size - len, "apply_to_done",
+				telemetry->apply_to_done);
+		}
+	}
+
+	mutex_unlock(&core_dev->crm_lock);
+
+	return simple_read_from_buffer(t_char, t_size_t,
+		t_loff_t, out_buffer, len);
+}
+
+static const struct file_operations link_telemetry = {
+	.open = session_info_open,
+	.read = link_telemetry_read,
+};
+
 static struct dentry *debugfs_root;
 int cam_req_mgr_debug_register(struct cam_req_mgr_core_device *core_dev)
 {
@@ -133,6 +190,8 @@ int cam_req_mgr_debug_register(struct cam_req_mgr_core_device *core_dev)
 		core_dev, &session_info);
 	debugfs_create_file("bubble_recovery", 0644,
 		debugfs_root, core_dev, &bubble_recovery);
+	debugfs_create_file("link_telemetry", 0444, debugfs_root,
+		core_dev, &link_telemetry);
 	debugfs_create_bool("recovery_on_apply_fail", 0644,
 		debugfs_root, &core_dev->recovery_on_apply_fail);
 	debugfs_create_u32("delay_detect_count", 0644, debugfs_root,
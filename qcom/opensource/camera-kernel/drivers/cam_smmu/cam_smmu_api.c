@@ -17,6 +17,8 @@
 #include <linux/genalloc.h>
 #include <linux/debugfs.h>
 #include <linux/dma-iommu.h>
+#include <linux/hashtable.h>
+#include <linux/rbtree.h>
 
 #include <soc/qcom/secure_buffer.h>
 
@@ -45,6 +47,7 @@
 #define GET_SMMU_TABLE_IDX(x) (((x) >> COOKIE_SIZE) & COOKIE_MASK)
 
 #define CAM_SMMU_MONITOR_MAX_ENTRIES   100
+#define CAM_SMMU_BUF_HASH_BITS         7
 #define CAM_SMMU_INC_MONITOR_HEAD(head, ret) \
 	div_u64_rem(atomic64_add_return(1, head),\
 	CAM_SMMU_MONITOR_MAX_ENTRIES, (ret))
@@ -163,6 +166,13 @@ struct cam_context_bank_info {
 
 	struct list_head smmu_buf_list;
 	struct list_head smmu_buf_kernel_list;
+	/*
+	 * Lookup indices for non-secure mappings: user mappings hashed by fd,
+	 * kernel mappings hashed by dma_buf, user mappings sorted by iova.
+	 */
+	DECLARE_HASHTABLE(user_buf_hash, CAM_SMMU_BUF_HASH_BITS);
+	DECLARE_HASHTABLE(kernel_buf_hash, CAM_SMMU_BUF_HASH_BITS);
+	struct rb_root iova_tree;
 	struct mutex lock;
 	int handle;
 	enum cam_smmu_ops_param state;
@@ -217,6 +227,8 @@ struct cam_dma_buff_info {
 	int ref_count;
 	dma_addr_t paddr;
 	struct list_head list;
+	struct hlist_node hnode;
+	struct rb_node iova_node;
 	int ion_fd;
 	unsigned long i_ino;
 	size_t len;
@@ -687,9 +699,81 @@ static void cam_smmu_print_table(void)
 	}
 }
 
+static void cam_smmu_iova_tree_insert(struct rb_root *root,
+	struct cam_dma_buff_info *mapping)
+{
+	struct rb_node **link = &root->rb_node, *parent = NULL;
+	struct cam_dma_buff_info *entry;
+
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct cam_dma_buff_info, iova_node);
+		if (mapping->paddr < entry->paddr)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	rb_link_node(&mapping->iova_node, parent, link);
+	rb_insert_color(&mapping->iova_node, root);
+}
+
+/* Returns the mapping with the highest start address not above @addr */
+static struct cam_dma_buff_info *cam_smmu_iova_tree_floor(
+	struct rb_root *root, unsigned long addr)
+{
+	struct rb_node *node = root->rb_node;
+	struct cam_dma_buff_info *entry, *floor = NULL;
+
+	while (node) {
+		entry = rb_entry(node, struct cam_dma_buff_info, iova_node);
+		if ((unsigned long)entry->paddr <= addr) {
+			floor = entry;
+			node = node->rb_right;
+		} else {
+			node = node->rb_left;
+		}
+	}
+
+	return floor;
+}
+
+static void cam_smmu_add_user_mapping(int idx,
+	struct cam_dma_buff_info *mapping)
+{
+	struct cam_context_bank_info *cb_info = &iommu_cb_set.cb_info[idx];
+
+	list_add(&mapping->list, &cb_info->smmu_buf_list);
+	hash_add(cb_info->user_buf_hash, &mapping->hnode, mapping->ion_fd);
+	cam_smmu_iova_tree_insert(&cb_info->iova_tree, mapping);
+}
+
+static void cam_smmu_add_kernel_mapping(int idx,
+	struct cam_dma_buff_info *mapping)
+{
+	struct cam_context_bank_info *cb_info = &iommu_cb_set.cb_info[idx];
+
+	list_add(&mapping->list, &cb_info->smmu_buf_kernel_list);
+	hash_add(cb_info->kernel_buf_hash, &mapping->hnode,
+		(unsigned long)mapping->buf);
+	RB_CLEAR_NODE(&mapping->iova_node);
+}
+
+static void cam_smmu_del_mapping(int idx,
+	struct cam_dma_buff_info *mapping)
+{
+	list_del_init(&mapping->list);
+	hash_del(&mapping->hnode);
+	if (!RB_EMPTY_NODE(&mapping->iova_node)) {
+		rb_erase(&mapping->iova_node, &iommu_cb_set.cb_info[idx].iova_tree);
+		RB_CLEAR_NODE(&mapping->iova_node);
+	}
+}
+
 static uint32_t cam_smmu_find_closest_mapping(int idx, void *vaddr, bool *in_map_region)
 {
 	struct cam_dma_buff_info *mapping, *closest_mapping =  NULL;
+	struct rb_node *next;
 	unsigned long start_addr, end_addr, current_addr;
 	uint32_t buf_info = 0;
 
@@ -697,12 +781,19 @@ static uint32_t cam_smmu_find_closest_mapping(int idx, void *vaddr, bool *in_map
 
 	current_addr = (unsigned long)vaddr;
 	*in_map_region = false;
-	list_for_each_entry(mapping,
-			&iommu_cb_set.cb_info[idx].smmu_buf_list, list) {
+
+	/*
+	 * Mappings of a context bank do not overlap, so only the mapping
+	 * starting at or below the address and the one following it can
+	 * contain or be closest to it.
+	 */
+	mapping = cam_smmu_iova_tree_floor(&iommu_cb_set.cb_info[idx].iova_tree,
+		current_addr);
+	if (mapping) {
 		start_addr = (unsigned long)mapping->paddr;
 		end_addr = (unsigned long)mapping->paddr + mapping->len;
 
-		if (start_addr <= current_addr && current_addr <= end_addr) {
+		if (current_addr <= end_addr) {
 			closest_mapping = mapping;
 			*in_map_region = true;
 			CAM_INFO(CAM_SMMU,
@@ -711,32 +802,31 @@ static uint32_t cam_smmu_find_closest_mapping(int idx, void *vaddr, bool *in_map
 				end_addr, mapping->ion_fd, mapping->i_ino,
 				iommu_cb_set.cb_info[idx].name[0]);
 			goto end;
-		} else {
-			if (start_addr > current_addr)
-				delta =  start_addr - current_addr;
-			else
-				delta = current_addr - end_addr - 1;
-
-			if (delta < lowest_delta || lowest_delta == 0) {
-				lowest_delta = delta;
-				closest_mapping = mapping;
-			}
-			CAM_DBG(CAM_SMMU,
-				"approx va %lx not in range: %lx-%lx fd = %0x i_ino %lu",
-				current_addr, start_addr,
-				end_addr, mapping->ion_fd, mapping->i_ino);
 		}
+
+		lowest_delta = current_addr - end_addr - 1;
+		closest_mapping = mapping;
+		next = rb_next(&mapping->iova_node);
+	} else {
+		next = rb_first(&iommu_cb_set.cb_info[idx].iova_tree);
+	}
+
+	if (next) {
+		mapping = rb_entry(next, struct cam_dma_buff_info, iova_node);
+		delta = (unsigned long)mapping->paddr - current_addr;
+		if (delta < lowest_delta || lowest_delta == 0)
+			closest_mapping = mapping;
 	}
 
 end:
 	if (closest_mapping) {
 		buf_info = closest_mapping->ion_fd;
 		CAM_INFO(CAM_SMMU,
-			"Closest map fd %d i_ino %lu 0x%lx %llu-%llu 0x%lx-0x%lx buf=%pK",
+			"Closest map fd %d i_ino %lu 0x%lx %zu 0x%lx-0x%lx buf=%pK",
 			closest_mapping->ion_fd, closest_mapping->i_ino, current_addr,
-			mapping->len, closest_mapping->len,
+			closest_mapping->len,
 			(unsigned long)closest_mapping->paddr,
-			(unsigned long)closest_mapping->paddr + mapping->len,
+			(unsigned long)closest_mapping->paddr + closest_mapping->len,
 			closest_mapping->buf);
 	} else
 		CAM_ERR(CAM_SMMU,
@@ -985,6 +1075,9 @@ void cam_smmu_reset_iommu_table(enum cam_smmu_init_dir ops)
 		iommu_cb_set.cb_info[i].handle = HANDLE_INIT;
 		INIT_LIST_HEAD(&iommu_cb_set.cb_info[i].smmu_buf_list);
 		INIT_LIST_HEAD(&iommu_cb_set.cb_info[i].smmu_buf_kernel_list);
+		hash_init(iommu_cb_set.cb_info[i].user_buf_hash);
+		hash_init(iommu_cb_set.cb_info[i].kernel_buf_hash);
+		iommu_cb_set.cb_info[i].iova_tree = RB_ROOT;
 		iommu_cb_set.cb_info[i].state = CAM_SMMU_DETACH;
 		iommu_cb_set.cb_info[i].dev = NULL;
 		iommu_cb_set.cb_info[i].cb_count = 0;
@@ -1221,13 +1314,12 @@ static struct cam_dma_buff_info *cam_smmu_find_mapping_by_virt_address(int idx,
 {
 	struct cam_dma_buff_info *mapping;
 
-	list_for_each_entry(mapping, &iommu_cb_set.cb_info[idx].smmu_buf_list,
-			list) {
-		if (mapping->paddr == virt_addr) {
-			CAM_DBG(CAM_SMMU, "Found virtual address %lx",
-				 (unsigned long)virt_addr);
-			return mapping;
-		}
+	mapping = cam_smmu_iova_tree_floor(&iommu_cb_set.cb_info[idx].iova_tree,
+		(unsigned long)virt_addr);
+	if (mapping && mapping->paddr == virt_addr) {
+		CAM_DBG(CAM_SMMU, "Found virtual address %lx",
+			 (unsigned long)virt_addr);
+		return mapping;
 	}
 
 	CAM_ERR(CAM_SMMU, "Error: Cannot find virtual address %lx by index %d",
@@ -1248,9 +1340,8 @@ static struct cam_dma_buff_info *cam_smmu_find_mapping_by_ion_index(int idx,
 
 	i_ino = file_inode(dmabuf->file)->i_ino;
 
-	list_for_each_entry(mapping,
-			&iommu_cb_set.cb_info[idx].smmu_buf_list,
-			list) {
+	hash_for_each_possible(iommu_cb_set.cb_info[idx].user_buf_hash,
+			mapping, hnode, ion_fd) {
 		if ((mapping->ion_fd == ion_fd) && (mapping->i_ino == i_ino)) {
 			CAM_DBG(CAM_SMMU, "find ion_fd %d i_ino %lu", ion_fd, i_ino);
 			return mapping;
@@ -1273,9 +1364,8 @@ static struct cam_dma_buff_info *cam_smmu_find_mapping_by_dma_buf(int idx,
 		return NULL;
 	}
 
-	list_for_each_entry(mapping,
-			&iommu_cb_set.cb_info[idx].smmu_buf_kernel_list,
-			list) {
+	hash_for_each_possible(iommu_cb_set.cb_info[idx].kernel_buf_hash,
+			mapping, hnode, (unsigned long)buf) {
 		if (mapping->buf == buf) {
 			CAM_DBG(CAM_SMMU, "find dma_buf %pK", buf);
 			return mapping;
@@ -2347,8 +2437,7 @@ static int cam_smmu_map_buffer_and_add_to_list(int idx, int ion_fd,
 	mapping_info->is_internal = is_internal;
 	CAM_GET_TIMESTAMP(mapping_info->ts);
 	/* add to the list */
-	list_add(&mapping_info->list,
-		&iommu_cb_set.cb_info[idx].smmu_buf_list);
+	cam_smmu_add_user_mapping(idx, mapping_info);
 
 	CAM_DBG(CAM_SMMU, "fd %d i_ino %lu dmabuf %pK", ion_fd, mapping_info->i_ino, buf);
 
@@ -2379,8 +2468,7 @@ static int cam_smmu_map_kernel_buffer_and_add_to_list(int idx,
 	CAM_GET_TIMESTAMP(mapping_info->ts);
 
 	/* add to the list */
-	list_add(&mapping_info->list,
-		&iommu_cb_set.cb_info[idx].smmu_buf_kernel_list);
+	cam_smmu_add_kernel_mapping(idx, mapping_info);
 
 	CAM_DBG(CAM_SMMU, "fd %d i_ino %lu dmabuf %pK",
 		mapping_info->ion_fd, mapping_info->i_ino, buf);
@@ -2474,7 +2562,7 @@ static int cam_smmu_unmap_buf_and_remove_from_list(
 
 	mapping_info->buf = NULL;
 
-	list_del_init(&mapping_info->list);
+	cam_smmu_del_mapping(idx, mapping_info);
 
 	/* free one buffer */
 	kfree(mapping_info);
@@ -2490,8 +2578,8 @@ static enum cam_smmu_buf_state cam_smmu_check_fd_in_list(int idx,
 
 	i_ino = file_inode(dmabuf->file)->i_ino;
 
-	list_for_each_entry(mapping,
-		&iommu_cb_set.cb_info[idx].smmu_buf_list, list) {
+	hash_for_each_possible(iommu_cb_set.cb_info[idx].user_buf_hash,
+		mapping, hnode, ion_fd) {
 		if ((mapping->ion_fd == ion_fd) && (mapping->i_ino == i_ino)) {
 			*paddr_ptr = mapping->paddr;
 			*len_ptr = mapping->len;
@@ -2512,8 +2600,8 @@ static enum cam_smmu_buf_state cam_smmu_user_reuse_fd_in_list(int idx,
 
 	i_ino = file_inode(dmabuf->file)->i_ino;
 
-	list_for_each_entry(mapping,
-		&iommu_cb_set.cb_info[idx].smmu_buf_list, list) {
+	hash_for_each_possible(iommu_cb_set.cb_info[idx].user_buf_hash,
+		mapping, hnode, ion_fd) {
 		if ((mapping->ion_fd == ion_fd) && (mapping->i_ino == i_ino)) {
 			*paddr_ptr = mapping->paddr;
 			*len_ptr = mapping->len;
@@ -2531,8 +2619,8 @@ static enum cam_smmu_buf_state cam_smmu_check_dma_buf_in_list(int idx,
 {
 	struct cam_dma_buff_info *mapping;
 
-	list_for_each_entry(mapping,
-		&iommu_cb_set.cb_info[idx].smmu_buf_kernel_list, list) {
+	hash_for_each_possible(iommu_cb_set.cb_info[idx].kernel_buf_hash,
+		mapping, hnode, (unsigned long)buf) {
 		if (mapping->buf == buf) {
 			*paddr_ptr = mapping->paddr;
 			*len_ptr = mapping->len;
@@ -2751,7 +2839,7 @@ static int cam_smmu_alloc_scratch_buffer_add_to_list(int idx,
 		(void *)mapping_info->paddr,
 		mapping_info->len, mapping_info->phys_len);
 
-	list_add(&mapping_info->list, &iommu_cb_set.cb_info[idx].smmu_buf_list);
+	cam_smmu_add_user_mapping(idx, mapping_info);
 
 	*virt_addr = (dma_addr_t)iova;
 
@@ -2812,7 +2900,7 @@ static int cam_smmu_free_scratch_buffer_remove_from_list(
 			get_order(mapping_info->phys_len));
 	sg_free_table(mapping_info->table);
 	kfree(mapping_info->table);
-	list_del_init(&mapping_info->list);
+	cam_smmu_del_mapping(idx, mapping_info);
 
 	kfree(mapping_info);
 	mapping_info = NULL;
@@ -10,6 +10,7 @@
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/debugfs.h>
+#include <linux/list_sort.h>
 #if IS_REACHABLE(CONFIG_MSM_GLOBAL_SYNX)
 #include <synx_api.h>
 #endif
@@ -144,7 +145,7 @@ int cam_sync_register_callback(sync_callback cb_func,
 		return -EINVAL;
 	}
 
-	sync_cb = kzalloc(sizeof(*sync_cb), GFP_ATOMIC);
+	sync_cb = kmem_cache_zalloc(sync_dev->cb_cache, GFP_ATOMIC);
 	if (!sync_cb) {
 		spin_unlock_bh(&sync_dev->row_spinlocks[sync_obj]);
 		return -ENOMEM;
@@ -160,7 +161,7 @@ int cam_sync_register_callback(sync_callback cb_func,
 				row->name,
 				sync_obj);
 			status = row->state;
-			kfree(sync_cb);
+			kmem_cache_free(sync_dev->cb_cache, sync_cb);
 			spin_unlock_bh(&sync_dev->row_spinlocks[sync_obj]);
 			cb_func(sync_obj, status, userdata);
 		} else {
@@ -221,7 +222,7 @@ int cam_sync_deregister_callback(sync_callback cb_func,
 		if (sync_cb->callback_func == cb_func &&
 			sync_cb->cb_data == userdata) {
 			list_del_init(&sync_cb->list);
-			kfree(sync_cb);
+			kmem_cache_free(sync_dev->cb_cache, sync_cb);
 			found = true;
 		}
 	}
@@ -263,17 +264,29 @@ static void cam_sync_signal_parent_util(int32_t status,
 	uint32_t event_cause, struct list_head *parents_list)
 {
 	int rc;
+	int32_t locked_id = 0;
 	struct sync_table_row *parent_row = NULL;
 	struct sync_parent_info *parent_info, *temp_parent_info;
 
 	/*
 	 * Now iterate over all parents of this object and if they too need to
-	 * be signaled dispatch cb's
+	 * be signaled dispatch cb's. Nodes of the same parent are adjacent
+	 * when the list comes from a batched signal, keep that parent's row
+	 * lock held across them.
 	 */
-	 list_for_each_entry_safe(parent_info, temp_parent_info,
+	list_for_each_entry_safe(parent_info, temp_parent_info,
 		parents_list, list) {
-		parent_row = sync_dev->sync_table + parent_info->sync_id;
-		spin_lock_bh(&sync_dev->row_spinlocks[parent_info->sync_id]);
+		if (parent_info->sync_id != locked_id) {
+			if (locked_id)
+				spin_unlock_bh(&sync_dev->row_spinlocks[locked_id]);
+			locked_id = parent_info->sync_id;
+			spin_lock_bh(&sync_dev->row_spinlocks[locked_id]);
+		}
+
+		list_del_init(&parent_info->list);
+		kmem_cache_free(sync_dev->parent_cache, parent_info);
+
+		parent_row = sync_dev->sync_table + locked_id;
 		parent_row->remaining--;
 
 		rc = cam_sync_util_update_parent_state(
@@ -282,21 +295,26 @@ static void cam_sync_signal_parent_util(int32_t status,
 		if (rc) {
 			CAM_ERR(CAM_SYNC, "Invalid parent state %d",
 				parent_row->state);
-			spin_unlock_bh(
-				&sync_dev->row_spinlocks[parent_info->sync_id]);
-			kfree(parent_info);
 			continue;
 		}
 
 		if (!parent_row->remaining)
 			cam_sync_util_dispatch_signaled_cb(
-				parent_info->sync_id, parent_row->state,
+				locked_id, parent_row->state,
 				event_cause);
-
-		spin_unlock_bh(&sync_dev->row_spinlocks[parent_info->sync_id]);
-		list_del_init(&parent_info->list);
-		kfree(parent_info);
 	}
+
+	if (locked_id)
+		spin_unlock_bh(&sync_dev->row_spinlocks[locked_id]);
+}
+
+static int cam_sync_parent_cmp(void *priv, const struct list_head *a,
+	const struct list_head *b)
+{
+	struct sync_parent_info *pa = list_entry(a, struct sync_parent_info, list);
+	struct sync_parent_info *pb = list_entry(b, struct sync_parent_info, list);
+
+	return pa->sync_id - pb->sync_id;
 }
 
 static int cam_sync_signal_validate_util(
@@ -336,10 +354,15 @@ static int cam_sync_signal_validate_util(
 	return 0;
 }
 
-int cam_sync_signal(int32_t sync_obj, uint32_t status, uint32_t event_cause)
+/*
+ * Signals a single row and moves its parent links to parents_list. The
+ * caller owns the moved nodes and must pass them to
+ * cam_sync_signal_parent_util.
+ */
+static int cam_sync_signal_row_util(int32_t sync_obj, uint32_t status,
+	uint32_t event_cause, struct list_head *parents_list)
 {
 	struct sync_table_row *row = NULL;
-	struct list_head parents_list;
 	int rc = 0;
 
 	if (sync_obj >= CAM_SYNC_MAX_OBJS || sync_obj <= 0) {
@@ -381,10 +404,23 @@ int cam_sync_signal(int32_t sync_obj, uint32_t status, uint32_t event_cause)
 	cam_sync_util_dispatch_signaled_cb(sync_obj, status, event_cause);
 
 	/* copy parent list to local and release child lock */
-	INIT_LIST_HEAD(&parents_list);
-	list_splice_init(&row->parents_list, &parents_list);
+	list_splice_tail_init(&row->parents_list, parents_list);
 	spin_unlock_bh(&sync_dev->row_spinlocks[sync_obj]);
 
+	return 0;
+}
+
+int cam_sync_signal(int32_t sync_obj, uint32_t status, uint32_t event_cause)
+{
+	struct list_head parents_list;
+	int rc;
+
+	INIT_LIST_HEAD(&parents_list);
+	rc = cam_sync_signal_row_util(sync_obj, status, event_cause,
+		&parents_list);
+	if (rc)
+		return rc;
+
 	if (list_empty(&parents_list))
 		return 0;
 
@@ -393,6 +429,37 @@ int cam_sync_signal(int32_t sync_obj, uint32_t status, uint32_t event_cause)
 	return 0;
 }
 
+int cam_sync_signal_batch(int32_t *sync_objs, uint32_t num_objs,
+	uint32_t status, uint32_t event_cause)
+{
+	struct list_head parents_list;
+	int rc = 0, rc_obj;
+	uint32_t i;
+
+	if (!sync_objs || !num_objs) {
+		CAM_ERR(CAM_SYNC, "Invalid batch sync_objs: %pK num_objs: %u",
+			sync_objs, num_objs);
+		return -EINVAL;
+	}
+
+	INIT_LIST_HEAD(&parents_list);
+	for (i = 0; i < num_objs; i++) {
+		rc_obj = cam_sync_signal_row_util(sync_objs[i], status,
+			event_cause, &parents_list);
+		if (rc_obj && !rc)
+			rc = rc_obj;
+	}
+
+	if (list_empty(&parents_list))
+		return rc;
+
+	/* Group nodes by parent so each parent row is locked once */
+	list_sort(NULL, &parents_list, cam_sync_parent_cmp);
+	cam_sync_signal_parent_util(status, event_cause, &parents_list);
+
+	return rc;
+}
+
 int cam_sync_merge(int32_t *sync_obj, uint32_t num_objs, int32_t *merged_obj)
 {
 	int rc;
@@ -1900,6 +1967,32 @@ static void cam_sync_configure_synx_obj(struct synx_register_params *object)
 }
 #endif
 
+static void cam_sync_destroy_caches(void)
+{
+	kmem_cache_destroy(sync_dev->child_cache);
+	kmem_cache_destroy(sync_dev->parent_cache);
+	kmem_cache_destroy(sync_dev->cb_cache);
+	sync_dev->child_cache = NULL;
+	sync_dev->parent_cache = NULL;
+	sync_dev->cb_cache = NULL;
+}
+
+static int cam_sync_create_caches(void)
+{
+	sync_dev->cb_cache = KMEM_CACHE(sync_callback_info, 0);
+	sync_dev->parent_cache = KMEM_CACHE(sync_parent_info, 0);
+	sync_dev->child_cache = KMEM_CACHE(sync_child_info, 0);
+
+	if (!sync_dev->cb_cache || !sync_dev->parent_cache ||
+		!sync_dev->child_cache) {
+		CAM_ERR(CAM_SYNC, "Error: sync node cache creation failed");
+		cam_sync_destroy_caches();
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 static int cam_sync_component_bind(struct device *dev,
 	struct device *master_dev, void *data)
 {
@@ -1919,6 +2012,10 @@ static int cam_sync_component_bind(struct device *dev,
 
 	sync_dev->sync_table = vzalloc(sizeof(struct sync_table_row) * CAM_SYNC_MAX_OBJS);
 
+	rc = cam_sync_create_caches();
+	if (rc)
+		goto cache_fail;
+
 	sync_dev->vdev = video_device_alloc();
 	if (!sync_dev->vdev) {
 		rc = -ENOMEM;
@@ -2005,6 +2102,8 @@ mcinit_fail:
 	video_unregister_device(sync_dev->vdev);
 	video_device_release(sync_dev->vdev);
 vdev_fail:
+	cam_sync_destroy_caches();
+cache_fail:
 	vfree(sync_dev->sync_table);
 	mutex_destroy(&sync_dev->table_lock);
 	kfree(sync_dev);
@@ -2025,10 +2124,26 @@ static void cam_sync_component_unbind(struct device *dev,
 	video_device_release(sync_dev->vdev);
 	sync_dev->dentry = NULL;
 
+	/* Queued callback nodes are freed to cb_cache from the workq */
+	flush_workqueue(sync_dev->work_queue);
+
+	/*
+	 * Rows never destroyed by their clients still hold cb, parent and
+	 * child nodes, release them before the caches go away.
+	 */
+	mutex_lock(&sync_dev->table_lock);
+	for (i = 1; i < CAM_SYNC_MAX_OBJS; i++) {
+		if (sync_dev->sync_table[i].state != CAM_SYNC_STATE_INVALID)
+			cam_sync_deinit_object(sync_dev->sync_table, i, NULL);
+	}
+	mutex_unlock(&sync_dev->table_lock);
+
 	cam_dma_fence_driver_deinit();
 	for (i = 0; i < CAM_SYNC_MAX_OBJS; i++)
 		spin_lock_init(&sync_dev->row_spinlocks[i]);
 
+	cam_sync_destroy_caches();
+
 	vfree(sync_dev->sync_table);
 	kfree(sync_dev);
 	sync_dev = NULL;
@@ -82,6 +82,24 @@ int cam_sync_deregister_callback(sync_callback cb_func,
  */
 int cam_sync_signal(int32_t sync_obj, uint32_t status, uint32_t evt_param);
 
+/**
+ * @brief: Signals an array of sync objects with the same status.
+ *
+ * Behaves like calling cam_sync_signal on each object, but the parents of
+ * all the objects are collected and sorted first so that the row lock of a
+ * merged object shared by several of the signaled children is taken once.
+ *
+ * @param sync_objs: Array of sync objects to signal
+ * @param num_objs: Number of entries in sync_objs
+ * @param status: Status of the signaling
+ * @param evt_param: Event parameter
+ *
+ * @return Status of operation. The first error seen while signaling, all
+ * valid objects are signaled regardless. Zero otherwise.
+ */
+int cam_sync_signal_batch(int32_t *sync_objs, uint32_t num_objs,
+	uint32_t status, uint32_t evt_param);
+
 /**
  * @brief: Merges multiple sync objects
  *
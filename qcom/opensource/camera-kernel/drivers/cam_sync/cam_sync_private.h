@@ -12,6 +12,7 @@
 #include <linux/workqueue.h>
 #include <linux/interrupt.h>
 #include <linux/debugfs.h>
+#include <linux/slab.h>
 #include <media/v4l2-fh.h>
 #include <media/v4l2-device.h>
 #include <media/v4l2-subdev.h>
@@ -101,7 +102,8 @@ struct sync_child_info {
  * @cb_data            : Callback data, registered by client driver
  * @status             : Status with which callback will be invoked in client
  * @sync_obj           : Sync id of the object for which callback is registered
- * @workq_scheduled_ts : workqueue scheduled timestamp
+ * @workq_scheduled_ts : workqueue scheduled timestamp, i.e. the time the
+ *                      object was signaled for callbacks queued on signal
  * @cb_dispatch_work   : Work representing the call dispatch
  * @list               : List member used to append this node to a linked list
  */
@@ -207,6 +209,9 @@ struct cam_signalable_info {
  * @bitmap          : Bitmap representation of all sync objects
  * @params          : Parameters for synx call back registration
  * @version         : version support
+ * @cb_cache        : Slab cache for kernel callback nodes
+ * @parent_cache    : Slab cache for parent link nodes
+ * @child_cache     : Slab cache for child link nodes
  */
 struct sync_device {
 	struct video_device *vdev;
@@ -224,6 +229,9 @@ struct sync_device {
 	struct synx_register_params params;
 #endif
 	uint32_t version;
+	struct kmem_cache *cb_cache;
+	struct kmem_cache *parent_cache;
+	struct kmem_cache *child_cache;
 };
 
 
@@ -7,6 +7,7 @@
 #include "cam_sync_util.h"
 #include "cam_req_mgr_workq.h"
 #include "cam_common_util.h"
+#include "cam_trace.h"
 
 int cam_sync_util_find_and_set_empty_row(struct sync_device *sync_dev,
 	long *idx)
@@ -104,7 +105,7 @@ int cam_sync_init_group_object(struct sync_table_row *table,
 		row->remaining++;
 
 		/* Add child info */
-		child_info = kzalloc(sizeof(*child_info), GFP_ATOMIC);
+		child_info = kmem_cache_zalloc(sync_dev->child_cache, GFP_ATOMIC);
 		if (!child_info) {
 			spin_unlock_bh(&sync_dev->row_spinlocks[sync_objs[i]]);
 			rc = -ENOMEM;
@@ -114,7 +115,7 @@ int cam_sync_init_group_object(struct sync_table_row *table,
 		list_add_tail(&child_info->list, &row->children_list);
 
 		/* Add parent info */
-		parent_info = kzalloc(sizeof(*parent_info), GFP_ATOMIC);
+		parent_info = kmem_cache_zalloc(sync_dev->parent_cache, GFP_ATOMIC);
 		if (!parent_info) {
 			spin_unlock_bh(&sync_dev->row_spinlocks[sync_objs[i]]);
 			rc = -ENOMEM;
@@ -219,7 +220,7 @@ int cam_sync_deinit_object(struct sync_table_row *table, uint32_t idx,
 			list_del_init(&child_info->list);
 			spin_unlock_bh(&sync_dev->row_spinlocks[
 				child_info->sync_id]);
-			kfree(child_info);
+			kmem_cache_free(sync_dev->child_cache, child_info);
 			continue;
 		}
 
@@ -234,7 +235,7 @@ int cam_sync_deinit_object(struct sync_table_row *table, uint32_t idx,
 
 		list_del_init(&child_info->list);
 		spin_unlock_bh(&sync_dev->row_spinlocks[child_info->sync_id]);
-		kfree(child_info);
+		kmem_cache_free(sync_dev->child_cache, child_info);
 	}
 
 	/* Cleanup the parent to child link */
@@ -249,7 +250,7 @@ int cam_sync_deinit_object(struct sync_table_row *table, uint32_t idx,
 			list_del_init(&parent_info->list);
 			spin_unlock_bh(&sync_dev->row_spinlocks[
 				parent_info->sync_id]);
-			kfree(parent_info);
+			kmem_cache_free(sync_dev->parent_cache, parent_info);
 			continue;
 		}
 
@@ -264,7 +265,7 @@ int cam_sync_deinit_object(struct sync_table_row *table, uint32_t idx,
 
 		list_del_init(&parent_info->list);
 		spin_unlock_bh(&sync_dev->row_spinlocks[parent_info->sync_id]);
-		kfree(parent_info);
+		kmem_cache_free(sync_dev->parent_cache, parent_info);
 	}
 
 	spin_lock_bh(&sync_dev->row_spinlocks[idx]);
@@ -277,7 +278,7 @@ int cam_sync_deinit_object(struct sync_table_row *table, uint32_t idx,
 	list_for_each_entry_safe(sync_cb, temp_cb,
 			&row->callback_list, list) {
 		list_del_init(&sync_cb->list);
-		kfree(sync_cb);
+		kmem_cache_free(sync_dev->cb_cache, sync_cb);
 	}
 
 	/* Decrement ref cnt for imported dma fence */
@@ -314,14 +315,20 @@ void cam_sync_util_cb_dispatch(struct work_struct *cb_dispatch_work)
 		cb_dispatch_work);
 	sync_callback sync_data = cb_info->callback_func;
 	void *cb = cb_info->callback_func;
+	ktime_t cb_start_ts;
 
 	cam_common_util_thread_switch_delay_detect(
 		"cam_sync_workq", "schedule", cb,
 		cb_info->workq_scheduled_ts,
 		CAM_WORKQ_SCHEDULE_TIME_THRESHOLD);
+	cb_start_ts = ktime_get();
 	sync_data(cb_info->sync_obj, cb_info->status, cb_info->cb_data);
 
-	kfree(cb_info);
+	trace_cam_sync_cb_latency(cb_info->sync_obj, cb_info->status, cb,
+		ktime_us_delta(cb_start_ts, cb_info->workq_scheduled_ts),
+		ktime_us_delta(ktime_get(), cb_start_ts));
+
+	kmem_cache_free(sync_dev->cb_cache, cb_info);
 }
 
 void cam_sync_util_dispatch_signaled_cb(int32_t sync_obj,
@@ -345,6 +352,7 @@ void cam_sync_util_dispatch_signaled_cb(int32_t sync_obj,
 	list_for_each_entry_safe(sync_cb,
 		temp_sync_cb, &signalable_row->callback_list, list) {
 		sync_cb->status = status;
+		sync_cb->workq_scheduled_ts = ktime_get();
 		list_del_init(&sync_cb->list);
 		queue_work(sync_dev->work_queue,
 			&sync_cb->cb_dispatch_work);
@@ -464,7 +472,7 @@ void cam_sync_util_cleanup_children_list(struct sync_table_row *row,
 
 		curr_sync_obj = child_info->sync_id;
 		list_del_init(&child_info->list);
-		kfree(child_info);
+		kmem_cache_free(sync_dev->child_cache, child_info);
 
 		if ((list_clean_type == SYNC_LIST_CLEAN_ONE) &&
 			(curr_sync_obj == sync_obj))
@@ -487,7 +495,7 @@ void cam_sync_util_cleanup_parents_list(struct sync_table_row *row,
 
 		curr_sync_obj = parent_info->sync_id;
 		list_del_init(&parent_info->list);
-		kfree(parent_info);
+		kmem_cache_free(sync_dev->parent_cache, parent_info);
 
 		if ((list_clean_type == SYNC_LIST_CLEAN_ONE) &&
 			(curr_sync_obj == sync_obj))
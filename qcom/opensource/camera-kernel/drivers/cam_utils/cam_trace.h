@@ -402,6 +402,31 @@ TRACE_EVENT(cam_cdm_cb,
 	)
 );
 
+TRACE_EVENT(cam_sync_cb_latency,
+	TP_PROTO(int32_t sync_obj, int status, void *cb,
+		int64_t signal_to_cb_us, int64_t cb_exec_us),
+	TP_ARGS(sync_obj, status, cb, signal_to_cb_us, cb_exec_us),
+	TP_STRUCT__entry(
+		__field(int32_t, sync_obj)
+		__field(int, status)
+		__field(void *, cb)
+		__field(int64_t, signal_to_cb_us)
+		__field(int64_t, cb_exec_us)
+	),
+	TP_fast_assign(
+		__entry->sync_obj        = sync_obj;
+		__entry->status          = status;
+		__entry->cb              = cb;
+		__entry->signal_to_cb_us = signal_to_cb_us;
+		__entry->cb_exec_us      = cb_exec_us;
+	),
+	TP_printk(
+		"sync_obj=%d status=%d cb=%ps signal_to_cb=%lldus cb_exec=%lldus",
+			__entry->sync_obj, __entry->status, __entry->cb,
+			__entry->signal_to_cb_us, __entry->cb_exec_us
+	)
+);
+
 #endif /* _CAM_TRACE_H */
 
 /* This part must be outside protection */
@@ -1116,6 +1116,7 @@ static void sde_reg_dma_aspace_cb_locked(void *cb_data, bool is_detach)
 		dma_buf->iova = dma_buf->iova + offset;
 		dma_buf->vaddr = (void *)(((u8 *)dma_buf->vaddr) + offset);
 		dma_buf->next_op_allowed = DECODE_SEL_OP;
+		dma_buf->lut_cache.valid = false;
 	}
 }
 
@@ -1219,6 +1220,7 @@ static int dealloc_reg_dma_v1(struct sde_reg_dma_buffer *dma_buf)
 		mutex_unlock(&reg_dma->drm_dev->struct_mutex);
 	}
 
+	kvfree(dma_buf->lut_cache.data);
 	kfree(dma_buf);
 	return 0;
 }
@@ -1232,6 +1234,7 @@ static int reset_reg_dma_buffer_v1(struct sde_reg_dma_buffer *lut_buf)
 	lut_buf->ops_completed = 0;
 	lut_buf->next_op_allowed = DECODE_SEL_OP;
 	lut_buf->abs_write_cnt = 0;
+	lut_buf->lut_cache.valid = false;
 	return 0;
 }
 
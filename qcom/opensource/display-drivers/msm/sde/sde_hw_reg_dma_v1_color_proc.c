@@ -5,6 +5,8 @@
  */
 
 #include <drm/msm_drm_pp.h>
+#include <linux/debugfs.h>
+#include <linux/jhash.h>
 #include "sde_reg_dma.h"
 #include "sde_hw_reg_dma_v1_color_proc.h"
 #include "sde_hw_color_proc_common_v4.h"
@@ -294,6 +296,108 @@ static int reg_dma_buf_init(struct sde_reg_dma_buffer **buf, u32 size)
 	return 0;
 }
 
+static struct {
+	atomic64_t hits;
+	atomic64_t misses;
+	atomic64_t encodes;
+	atomic64_t bytes_saved;
+	atomic64_t encode_ns;
+} lut_cache_stats;
+
+/*
+ * reg_dma_lut_cache_check - returns true if @buf still holds the encoding of
+ * an identical @payload for the same @blk and @op, in which case the caller
+ * can kick off @buf as is. Otherwise the payload is remembered and the caller
+ * re-encodes it, then calls reg_dma_lut_cache_commit.
+ */
+static bool reg_dma_lut_cache_check(struct sde_reg_dma_buffer *buf,
+		const void *payload, u32 len, u32 blk, u32 op)
+{
+	struct sde_reg_dma_lut_cache *cache = &buf->lut_cache;
+	u32 key = jhash(payload, len, blk ^ op);
+
+	if (cache->valid && cache->key == key && cache->len == len &&
+			cache->blk == blk && cache->op == op &&
+			!memcmp(cache->data, payload, len)) {
+		atomic64_inc(&lut_cache_stats.hits);
+		atomic64_add(len, &lut_cache_stats.bytes_saved);
+		return true;
+	}
+
+	atomic64_inc(&lut_cache_stats.misses);
+	cache->valid = false;
+	cache->len = 0;
+
+	if (cache->size < len) {
+		kvfree(cache->data);
+		cache->size = 0;
+		cache->data = kvmalloc(len, GFP_KERNEL);
+		if (!cache->data)
+			return false;
+		cache->size = len;
+	}
+
+	/* copy now, some features modify the payload while encoding it */
+	memcpy(cache->data, payload, len);
+	cache->key = key;
+	cache->blk = blk;
+	cache->op = op;
+	cache->len = len;
+	cache->miss_ts = ktime_get();
+
+	return false;
+}
+
+static void reg_dma_lut_cache_commit(struct sde_reg_dma_buffer *buf)
+{
+	struct sde_reg_dma_lut_cache *cache = &buf->lut_cache;
+
+	if (!cache->len)
+		return;
+
+	atomic64_inc(&lut_cache_stats.encodes);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), cache->miss_ts)),
+			&lut_cache_stats.encode_ns);
+	cache->valid = true;
+}
+
+static int reg_dma_lut_cache_show(struct seq_file *s, void *data)
+{
+	u64 hits = atomic64_read(&lut_cache_stats.hits);
+	u64 encodes = atomic64_read(&lut_cache_stats.encodes);
+	u64 encode_ns = atomic64_read(&lut_cache_stats.encode_ns);
+	u64 avg_ns = encodes ? div64_u64(encode_ns, encodes) : 0;
+
+	seq_printf(s, "hits: %llu\n", hits);
+	seq_printf(s, "misses: %llu\n",
+			atomic64_read(&lut_cache_stats.misses));
+	seq_printf(s, "encodes: %llu\n", encodes);
+	seq_printf(s, "avg_encode_ns: %llu\n", avg_ns);
+	seq_printf(s, "bytes_saved: %llu\n",
+			atomic64_read(&lut_cache_stats.bytes_saved));
+	seq_printf(s, "est_saved_ns: %llu\n", hits * avg_ns);
+
+	return 0;
+}
+
+static int reg_dma_lut_cache_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, reg_dma_lut_cache_show, inode->i_private);
+}
+
+static const struct file_operations reg_dma_lut_cache_fops = {
+	.open = reg_dma_lut_cache_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+void reg_dmav1_lut_cache_debugfs_init(struct dentry *debugfs_root)
+{
+	debugfs_create_file("reg_dma_lut_cache", 0400, debugfs_root, NULL,
+			&reg_dma_lut_cache_fops);
+}
+
 static int reg_dma_dspp_check(struct sde_hw_dspp *ctx, void *cfg,
 		enum sde_reg_dma_features feature)
 {
@@ -750,6 +854,10 @@ static void reg_dmav1_setup_dspp_3d_gamutv4_common(struct sde_hw_dspp *ctx,
 	}
 
 	dma_ops = sde_reg_dma_get_ops();
+	if (reg_dma_lut_cache_check(dspp_buf[GAMUT][ctx->idx], payload,
+			hw_cfg->len, blk, op_mode))
+		goto kickoff;
+
 	dma_ops->reset_reg_dma_buf(dspp_buf[GAMUT][ctx->idx]);
 
 	REG_DMA_INIT_OPS(dma_write_cfg, blk, GAMUT, dspp_buf[GAMUT][ctx->idx]);
@@ -812,7 +920,9 @@ static void reg_dmav1_setup_dspp_3d_gamutv4_common(struct sde_hw_dspp *ctx,
 		DRM_ERROR("opmode write single reg failed ret %d\n", rc);
 		return;
 	}
+	reg_dma_lut_cache_commit(dspp_buf[GAMUT][ctx->idx]);
 
+kickoff:
 	REG_DMA_SETUP_KICKOFF(kick_off, hw_cfg->ctl, dspp_buf[GAMUT][ctx->idx],
 			REG_DMA_WRITE, DMA_CTL_QUEUE0, WRITE_IMMEDIATE, GAMUT);
 	LOG_FEATURE_ON;
@@ -914,6 +1024,10 @@ void reg_dmav1_setup_dspp_gcv18(struct sde_hw_dspp *ctx, void *cfg)
 
 	lut_cfg = hw_cfg->payload;
 	dma_ops = sde_reg_dma_get_ops();
+	if (reg_dma_lut_cache_check(dspp_buf[GC][ctx->idx], lut_cfg,
+			hw_cfg->len, blk, 0))
+		goto kickoff;
+
 	dma_ops->reset_reg_dma_buf(dspp_buf[GC][ctx->idx]);
 
 	REG_DMA_INIT_OPS(dma_write_cfg, blk, GC, dspp_buf[GC][ctx->idx]);
@@ -972,7 +1086,9 @@ void reg_dmav1_setup_dspp_gcv18(struct sde_hw_dspp *ctx, void *cfg)
 		DRM_ERROR("enabling gamma correction failed ret %d\n", rc);
 		return;
 	}
+	reg_dma_lut_cache_commit(dspp_buf[GC][ctx->idx]);
 
+kickoff:
 	REG_DMA_SETUP_KICKOFF(kick_off, hw_cfg->ctl, dspp_buf[GC][ctx->idx],
 			REG_DMA_WRITE, DMA_CTL_QUEUE0, WRITE_IMMEDIATE, GC);
 	LOG_FEATURE_ON;
@@ -1083,6 +1199,10 @@ void reg_dmav1_setup_dspp_igcv31(struct sde_hw_dspp *ctx, void *cfg)
 	lut_cfg = hw_cfg->payload;
 
 	dma_ops = sde_reg_dma_get_ops();
+	if (reg_dma_lut_cache_check(dspp_buf[IGC][ctx->idx], lut_cfg,
+			hw_cfg->len, blk, 0))
+		goto kickoff;
+
 	dma_ops->reset_reg_dma_buf(dspp_buf[IGC][ctx->idx]);
 
 	REG_DMA_INIT_OPS(dma_write_cfg, DSPP_IGC, IGC, dspp_buf[IGC][ctx->idx]);
@@ -1151,7 +1271,9 @@ void reg_dmav1_setup_dspp_igcv31(struct sde_hw_dspp *ctx, void *cfg)
 		DRM_ERROR("setting opcode failed ret %d\n", rc);
 		return;
 	}
+	reg_dma_lut_cache_commit(dspp_buf[IGC][ctx->idx]);
 
+kickoff:
 	REG_DMA_SETUP_KICKOFF(kick_off, hw_cfg->ctl, dspp_buf[IGC][ctx->idx],
 			REG_DMA_WRITE, DMA_CTL_QUEUE0, WRITE_IMMEDIATE, IGC);
 	LOG_FEATURE_ON;
@@ -2498,6 +2620,10 @@ void reg_dmav1_setup_vig_gamutv5(struct sde_hw_pipe *ctx, void *cfg)
 	}
 
 	dma_ops = sde_reg_dma_get_ops();
+	if (reg_dma_lut_cache_check(sspp_buf[idx][GAMUT][ctx->idx], payload,
+			hw_cfg->len, sspp_mapping[ctx->idx], op_mode))
+		goto kickoff;
+
 	dma_ops->reset_reg_dma_buf(sspp_buf[idx][GAMUT][ctx->idx]);
 
 	REG_DMA_INIT_OPS(dma_write_cfg, sspp_mapping[ctx->idx], GAMUT,
@@ -2561,7 +2687,9 @@ void reg_dmav1_setup_vig_gamutv5(struct sde_hw_pipe *ctx, void *cfg)
 		DRM_ERROR("opmode write single reg failed ret %d\n", rc);
 		return;
 	}
+	reg_dma_lut_cache_commit(sspp_buf[idx][GAMUT][ctx->idx]);
 
+kickoff:
 	REG_DMA_SETUP_KICKOFF(kick_off, hw_cfg->ctl,
 			sspp_buf[idx][GAMUT][ctx->idx], REG_DMA_WRITE,
 			DMA_CTL_QUEUE0, WRITE_IMMEDIATE, GAMUT);
@@ -332,4 +332,10 @@ void reg_dmav1_setup_spr_pu_cfgv1(struct sde_hw_dspp *ctx, void *cfg);
  */
 void reg_dmav1_setup_demurav1(struct sde_hw_dspp *ctx, void *cfg);
 
+/**
+ * reg_dmav1_lut_cache_debugfs_init() - expose the LUT payload cache stats.
+ * @debugfs_root: debugfs directory to create the stats node in
+ */
+void reg_dmav1_lut_cache_debugfs_init(struct dentry *debugfs_root);
+
 #endif /* _SDE_HW_REG_DMA_V1_COLOR_PROC_H */
@@ -232,6 +232,30 @@ enum sde_reg_dma_last_cmd_mode {
 	REG_DMA_NOWAIT,
 };
 
+/**
+ * struct sde_reg_dma_lut_cache - remembers which LUT payload a reg dma buffer
+ *                                holds so an identical payload can be kicked
+ *                                off again without being re-encoded.
+ * @key: hash of the payload
+ * @blk: decode select the payload was encoded for
+ * @op: feature specific op mode the payload was encoded with
+ * @len: length of the payload
+ * @size: allocated size of @data
+ * @data: copy of the payload, compared on a hash match
+ * @valid: buffer still holds the encoding of @data, cleared on buffer reset
+ * @miss_ts: time at which the current encoding started
+ */
+struct sde_reg_dma_lut_cache {
+	u32 key;
+	u32 blk;
+	u32 op;
+	u32 len;
+	u32 size;
+	void *data;
+	bool valid;
+	ktime_t miss_ts;
+};
+
 /**
  * struct sde_reg_dma_buffer - defines reg dma buffer structure.
  * @drm_gem_object *buf: drm gem handle for the buffer
@@ -243,6 +267,7 @@ enum sde_reg_dma_last_cmd_mode {
  * @next_op_allowed: operation allowed on the buffer
  * @ops_completed: operations completed on buffer
  * @abs_write_cnt: count of mdss absolute addr writes in the current buffer
+ * @lut_cache: source of the LUT payload currently encoded in the buffer
  */
 struct sde_reg_dma_buffer {
 	struct drm_gem_object *buf;
@@ -254,6 +279,7 @@ struct sde_reg_dma_buffer {
 	u32 next_op_allowed;
 	u32 ops_completed;
 	u32 abs_write_cnt;
+	struct sde_reg_dma_lut_cache lut_cache;
 };
 
 /**
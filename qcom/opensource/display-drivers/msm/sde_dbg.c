@@ -1560,9 +1560,7 @@ static int sde_dbg_debugfs_open(struct inode *inode, struct file *file)
 	file->private_data = inode->i_private;
 	mutex_lock(&sde_dbg_base.mutex);
 	sde_dbg_base.cur_evt_index = 0;
-	sde_dbg_base.evtlog->first = (u32)atomic_add_return(0, &sde_dbg_base.evtlog->curr) + 1;
-	sde_dbg_base.evtlog->last =
-		sde_dbg_base.evtlog->first + SDE_EVTLOG_ENTRY;
+	sde_evtlog_dump_rewind(sde_dbg_base.evtlog);
 	mutex_unlock(&sde_dbg_base.mutex);
 	return 0;
 }
@@ -1654,6 +1652,60 @@ static const struct file_operations sde_evtlog_fops = {
 	.write = sde_evtlog_dump_write,
 };
 
+/*
+ * sde_evtlog_bin_open - debugfs open handler for binary evtlog dump,
+ *	snapshots the held evtlog entries for the lifetime of the file
+ * @inode: debugfs inode
+ * @file: file handle
+ */
+static int sde_evtlog_bin_open(struct inode *inode, struct file *file)
+{
+	size_t size;
+
+	if (!inode || !file)
+		return -EINVAL;
+
+	file->private_data = sde_evtlog_dump_bin(sde_dbg_base.evtlog, &size);
+	if (!file->private_data)
+		return -ENOMEM;
+
+	return 0;
+}
+
+/**
+ * sde_evtlog_bin_read - debugfs read handler for binary evtlog dump
+ * @file: file handler
+ * @buff: user buffer content for debugfs
+ * @count: size of user buffer
+ * @ppos: position offset of user buffer
+ */
+static ssize_t sde_evtlog_bin_read(struct file *file, char __user *buff,
+		size_t count, loff_t *ppos)
+{
+	struct sde_dbg_evtlog_bin_hdr *hdr = file->private_data;
+
+	if (!hdr)
+		return -EINVAL;
+
+	return simple_read_from_buffer(buff, count, ppos, hdr,
+			sizeof(*hdr) + hdr->count * hdr->rec_size);
+}
+
+static int sde_evtlog_bin_release(struct inode *inode, struct file *file)
+{
+	vfree(file->private_data);
+	file->private_data = NULL;
+
+	return 0;
+}
+
+static const struct file_operations sde_evtlog_bin_fops = {
+	.open = sde_evtlog_bin_open,
+	.read = sde_evtlog_bin_read,
+	.release = sde_evtlog_bin_release,
+	.llseek = default_llseek,
+};
+
 /**
  * sde_dbg_ctrl_read - debugfs read handler for debug ctrl read
  * @file: file handler
@@ -2519,6 +2571,7 @@ int sde_dbg_debugfs_register(struct device *dev)
 
 	debugfs_create_file("dbg_ctrl", 0600, debugfs_root, NULL, &sde_dbg_ctrl_fops);
 	debugfs_create_file("dump", 0600, debugfs_root, NULL, &sde_evtlog_fops);
+	debugfs_create_file("dump_bin", 0400, debugfs_root, NULL, &sde_evtlog_bin_fops);
 	debugfs_create_file("recovery_reg", 0400, debugfs_root, NULL, &sde_recovery_reg_fops);
 
 	debugfs_create_u32("enable", 0600, debugfs_root, &(sde_dbg_base.evtlog->enable));
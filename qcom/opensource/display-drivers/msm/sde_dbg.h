@@ -140,12 +140,20 @@ enum sde_dbg_dump_context {
 #define SDE_EVTLOG_BUF_MAX 512
 #define SDE_EVTLOG_BUF_ALIGN 32
 
+#define SDE_EVTLOG_BIN_MAGIC	0x53444545 /* "SDEE" */
+#define SDE_EVTLOG_BIN_VERSION	1
+#define SDE_EVTLOG_BIN_NAME_LEN	32
+
 struct sde_dbg_power_ctrl {
 	void *handle;
 	void *client;
 	int (*enable_fn)(void *handle, void *client, bool enable);
 };
 
+/**
+ * @seq: sequence number of the entry once complete, 0 while it is being
+ *	written; it sits in the former tail padding
+ */
 struct sde_dbg_evtlog_log {
 	s64 time;
 	const char *name;
@@ -154,11 +162,17 @@ struct sde_dbg_evtlog_log {
 	u32 data_cnt;
 	int pid;
 	u8 cpu;
+	u32 seq;
 };
 
 /**
- * @last_dump: Index of last entry to be output during evtlog dumps
+ * @first: Sequence number of the first entry of the current text dump
+ * @last: Sequence number of the newest published entry
+ * @last_dump: Sequence number of last entry to be output during evtlog dumps
+ * @curr: Sequence number of the newest reserved entry, logs are lock free
+ * @next: Sequence number of the next entry to be output during evtlog dumps
  * @filter_list: Linked list of currently active filter strings
+ * @dump_time: timestamp of the previously dumped entry
  */
 struct sde_dbg_evtlog {
 	struct sde_dbg_evtlog_log logs[SDE_EVTLOG_ENTRY];
@@ -173,10 +187,38 @@ struct sde_dbg_evtlog {
 	u32 log_size;
 	spinlock_t spin_lock;
 	struct list_head filter_list;
+	s64 dump_time;
 };
 
 extern struct sde_dbg_evtlog *sde_dbg_base_evtlog;
 
+/**
+ * struct sde_dbg_evtlog_bin_hdr - header of the binary evtlog dump
+ * @magic: SDE_EVTLOG_BIN_MAGIC
+ * @version: SDE_EVTLOG_BIN_VERSION
+ * @count: number of records following the header
+ * @rec_size: size of each record in bytes
+ */
+struct sde_dbg_evtlog_bin_hdr {
+	u32 magic;
+	u32 version;
+	u32 count;
+	u32 rec_size;
+};
+
+/**
+ * struct sde_dbg_evtlog_bin_rec - one binary evtlog record, oldest first
+ */
+struct sde_dbg_evtlog_bin_rec {
+	s64 time;
+	s32 pid;
+	u32 line;
+	u32 cpu;
+	u32 data_cnt;
+	u32 data[SDE_EVTLOG_MAX_DATA];
+	char name[SDE_EVTLOG_BIN_NAME_LEN];
+};
+
 /*
  * reglog keeps this number of entries in memory for debug purpose. This
  * number must be greater than number of possible writes in at least one
@@ -370,6 +412,22 @@ ssize_t sde_evtlog_dump_to_buffer(struct sde_dbg_evtlog *evtlog,
  */
 u32 sde_evtlog_count(struct sde_dbg_evtlog *evtlog);
 
+/**
+ * sde_evtlog_dump_rewind - make the next text dump restart from the oldest
+ *	entry still held in the log, including already dumped ones
+ * @evtlog:	pointer to evtlog
+ */
+void sde_evtlog_dump_rewind(struct sde_dbg_evtlog *evtlog);
+
+/**
+ * sde_evtlog_dump_bin - snapshot all held entries into an oldest first binary
+ *	dump made of a struct sde_dbg_evtlog_bin_hdr and its records
+ * @evtlog:	pointer to evtlog
+ * @size:	returns the size of the snapshot in bytes
+ * Returns:	vmalloc'ed snapshot to be released with vfree, or NULL
+ */
+void *sde_evtlog_dump_bin(struct sde_dbg_evtlog *evtlog, size_t *size);
+
 /**
  * sde_evtlog_is_enabled - check whether log collection is enabled for given
  *	event log and log area flag
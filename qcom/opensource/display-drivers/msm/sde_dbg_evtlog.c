@@ -62,21 +62,30 @@ void sde_evtlog_log(struct sde_dbg_evtlog *evtlog, const char *name, int line,
 	int i, val = 0;
 	va_list args;
 	struct sde_dbg_evtlog_log *log;
-	u32 index;
+	unsigned long flags;
+	u32 seq;
 
 	if (!evtlog || !sde_evtlog_is_enabled(evtlog, flag) ||
 			_sde_evtlog_is_filtered_no_lock(evtlog, name))
 		return;
 
-	index = abs(atomic_inc_return(&evtlog->curr) % SDE_EVTLOG_ENTRY);
+	/*
+	 * No lock is taken: the slot is reserved from the atomic index and
+	 * readers check the stamp. irqs stay off so the entry is published
+	 * before anything else on this cpu can log.
+	 */
+	local_irq_save(flags);
+	seq = (u32)atomic_inc_return(&evtlog->curr);
+	log = &evtlog->logs[seq % SDE_EVTLOG_ENTRY];
 
-	log = &evtlog->logs[index];
+	WRITE_ONCE(log->seq, 0);
+	smp_wmb();
 	log->time = local_clock();
 	log->name = name;
 	log->line = line;
 	log->data_cnt = 0;
 	log->pid = current->pid;
-	log->cpu = raw_smp_processor_id();
+	log->cpu = smp_processor_id();
 
 	va_start(args, flag);
 	for (i = 0; i < SDE_EVTLOG_MAX_DATA; i++) {
@@ -89,7 +98,10 @@ void sde_evtlog_log(struct sde_dbg_evtlog *evtlog, const char *name, int line,
 	}
 	va_end(args);
 	log->data_cnt = i;
-	evtlog->last++;
+	smp_wmb();
+	WRITE_ONCE(log->seq, seq);
+	WRITE_ONCE(evtlog->last, seq);
+	local_irq_restore(flags);
 
 	trace_sde_evtlog(name, line, log->data_cnt, log->data);
 }
@@ -114,36 +126,50 @@ void sde_reglog_log(u8 blk_id, u32 val, u32 addr)
 	reglog->last++;
 }
 
-/* always dump the last entries which are not dumped yet */
-static bool _sde_evtlog_dump_calc_range(struct sde_dbg_evtlog *evtlog,
-		bool update_last_entry, bool full_dump)
+/*
+ * Copy out entry @seq. Fails if the entry is still being written or has
+ * been overwritten, either before or during the copy.
+ */
+static bool _sde_evtlog_read(struct sde_dbg_evtlog *evtlog, u32 seq,
+		struct sde_dbg_evtlog_log *log)
 {
-	int max_entries = full_dump ? SDE_EVTLOG_ENTRY : SDE_EVTLOG_PRINT_ENTRY;
+	struct sde_dbg_evtlog_log *src = &evtlog->logs[seq % SDE_EVTLOG_ENTRY];
 
-	if (!evtlog)
+	if (!seq || READ_ONCE(src->seq) != seq)
 		return false;
+	smp_rmb();
+	*log = *src;
+	smp_rmb();
 
-	evtlog->first = evtlog->next;
+	return READ_ONCE(src->seq) == seq;
+}
 
-	if (update_last_entry)
-		evtlog->last_dump = evtlog->last;
+/* oldest sequence number still held in the ring for newest @end */
+static inline u32 _sde_evtlog_oldest(u32 end)
+{
+	return end > SDE_EVTLOG_ENTRY ? end - SDE_EVTLOG_ENTRY + 1 : 1;
+}
 
-	if (evtlog->last_dump == evtlog->first)
-		return false;
+/* always dump the last entries which are not dumped yet */
+static bool _sde_evtlog_dump_calc_range(struct sde_dbg_evtlog *evtlog,
+		u32 max_entries)
+{
+	u32 end = (u32)atomic_read(&evtlog->curr);
+	u32 oldest = _sde_evtlog_oldest(end);
 
-	if (evtlog->last_dump < evtlog->first) {
-		evtlog->first %= SDE_EVTLOG_ENTRY;
-		if (evtlog->last_dump < evtlog->first)
-			evtlog->last_dump += SDE_EVTLOG_ENTRY;
-	}
+	if ((s32)(evtlog->next - oldest) < 0)
+		evtlog->next = oldest;
+
+	if ((s32)(end - evtlog->next) < 0)
+		return false;
 
-	if ((evtlog->last_dump - evtlog->first) > max_entries) {
-		pr_info("evtlog skipping %d entries, last=%d\n",
-			evtlog->last_dump - evtlog->first -
-			max_entries, evtlog->last_dump - 1);
-		evtlog->first = evtlog->last_dump - max_entries;
+	if (end - evtlog->next + 1 > max_entries) {
+		pr_info("evtlog skipping %u entries, last=%u\n",
+			end - evtlog->next + 1 - max_entries, end);
+		evtlog->next = end - max_entries + 1;
 	}
-	evtlog->next = evtlog->first + 1;
+	evtlog->first = evtlog->next;
+	evtlog->last_dump = end;
 
 	return true;
 }
@@ -154,24 +180,43 @@ ssize_t sde_evtlog_dump_to_buffer(struct sde_dbg_evtlog *evtlog,
 {
 	int i;
 	ssize_t off = 0;
-	struct sde_dbg_evtlog_log *log, *prev_log;
+	struct sde_dbg_evtlog_log log;
 	unsigned long flags;
+	s64 prev_time;
+	u32 seq;
 
 	if (!evtlog || !evtlog_buf)
 		return 0;
 
+	/* only pick the next entry under the lock, format it outside */
 	spin_lock_irqsave(&evtlog->spin_lock, flags);
 
 	/* update markers, exit if nothing to print */
-	if (!_sde_evtlog_dump_calc_range(evtlog, update_last_entry, full_dump))
-		goto exit;
+	if (update_last_entry && !_sde_evtlog_dump_calc_range(evtlog,
+			full_dump ? SDE_EVTLOG_ENTRY : SDE_EVTLOG_PRINT_ENTRY)) {
+		spin_unlock_irqrestore(&evtlog->spin_lock, flags);
+		return 0;
+	}
+
+	/* entries overwritten since the range was taken are skipped */
+	if ((s32)(evtlog->next - _sde_evtlog_oldest(evtlog->last_dump)) < 0)
+		evtlog->next = _sde_evtlog_oldest(evtlog->last_dump);
 
-	log = &evtlog->logs[evtlog->first % SDE_EVTLOG_ENTRY];
+	do {
+		if ((s32)(evtlog->last_dump - evtlog->next) < 0) {
+			spin_unlock_irqrestore(&evtlog->spin_lock, flags);
+			return 0;
+		}
+		seq = evtlog->next++;
+	} while (!_sde_evtlog_read(evtlog, seq, &log));
+
+	prev_time = seq == evtlog->first ? log.time : evtlog->dump_time;
+	evtlog->dump_time = log.time;
 
-	prev_log = &evtlog->logs[(evtlog->first - 1) % SDE_EVTLOG_ENTRY];
+	spin_unlock_irqrestore(&evtlog->spin_lock, flags);
 
 	off = snprintf((evtlog_buf + off), (evtlog_buf_size - off), "%s:%-4d",
-		log->name, log->line);
+		log.name, log.line);
 
 	if (off < SDE_EVTLOG_BUF_ALIGN) {
 		memset((evtlog_buf + off), 0x20, (SDE_EVTLOG_BUF_ALIGN - off));
@@ -179,48 +224,85 @@ ssize_t sde_evtlog_dump_to_buffer(struct sde_dbg_evtlog *evtlog,
 	}
 
 	off += snprintf((evtlog_buf + off), (evtlog_buf_size - off),
-		"=>[%-8d:%-11llu:%9llu][%-4d]:[%-4d]:", evtlog->first,
-		log->time, (log->time - prev_log->time), log->pid, log->cpu);
+		"=>[%-8u:%-11llu:%9llu][%-4d]:[%-4d]:", seq,
+		log.time, (log.time - prev_time), log.pid, log.cpu);
 
-	for (i = 0; i < log->data_cnt; i++)
+	for (i = 0; i < log.data_cnt; i++)
 		off += snprintf((evtlog_buf + off), (evtlog_buf_size - off),
-			"%x ", log->data[i]);
+			"%x ", log.data[i]);
 
 	off += snprintf((evtlog_buf + off), (evtlog_buf_size - off), "\n");
-exit:
-	spin_unlock_irqrestore(&evtlog->spin_lock, flags);
 
 	return off;
 }
 
 u32 sde_evtlog_count(struct sde_dbg_evtlog *evtlog)
 {
-	u32 first, next, last, last_dump;
+	u32 end, next;
 
 	if (!evtlog)
 		return 0;
 
-	first = evtlog->first;
-	next = evtlog->next;
-	last = evtlog->last;
-	last_dump = evtlog->last_dump;
+	end = (u32)atomic_read(&evtlog->curr);
+	next = READ_ONCE(evtlog->next);
+	if ((s32)(next - _sde_evtlog_oldest(end)) < 0)
+		next = _sde_evtlog_oldest(end);
 
-	first = next;
-	last_dump = last;
+	return (s32)(end - next) < 0 ? 0 : end - next + 1;
+}
 
-	if (last_dump == first)
-		return 0;
+void sde_evtlog_dump_rewind(struct sde_dbg_evtlog *evtlog)
+{
+	unsigned long flags;
 
-	if (last_dump < first) {
-		first %= SDE_EVTLOG_ENTRY;
-		if (last_dump < first)
-			last_dump += SDE_EVTLOG_ENTRY;
+	if (!evtlog)
+		return;
+
+	/* the next range starts over from the oldest entry held */
+	spin_lock_irqsave(&evtlog->spin_lock, flags);
+	evtlog->next = 0;
+	spin_unlock_irqrestore(&evtlog->spin_lock, flags);
+}
+
+void *sde_evtlog_dump_bin(struct sde_dbg_evtlog *evtlog, size_t *size)
+{
+	struct sde_dbg_evtlog_bin_hdr *hdr;
+	struct sde_dbg_evtlog_bin_rec *rec;
+	struct sde_dbg_evtlog_log log;
+	u32 seq, end;
+
+	if (!evtlog || !size)
+		return NULL;
+
+	hdr = vzalloc(sizeof(*hdr) + SDE_EVTLOG_ENTRY * sizeof(*rec));
+	if (!hdr)
+		return NULL;
+
+	hdr->magic = SDE_EVTLOG_BIN_MAGIC;
+	hdr->version = SDE_EVTLOG_BIN_VERSION;
+	hdr->rec_size = sizeof(*rec);
+	rec = (struct sde_dbg_evtlog_bin_rec *)(hdr + 1);
+
+	/* independent of the text dump markers, always the whole history */
+	end = (u32)atomic_read(&evtlog->curr);
+	for (seq = _sde_evtlog_oldest(end); (s32)(end - seq) >= 0; seq++) {
+		if (!_sde_evtlog_read(evtlog, seq, &log))
+			continue;
+
+		rec->time = log.time;
+		rec->pid = log.pid;
+		rec->line = log.line;
+		rec->cpu = log.cpu;
+		rec->data_cnt = min_t(u32, log.data_cnt, SDE_EVTLOG_MAX_DATA);
+		memcpy(rec->data, log.data, rec->data_cnt * sizeof(u32));
+		strscpy(rec->name, log.name ? log.name : "", sizeof(rec->name));
+		rec++;
+		hdr->count++;
 	}
 
-	if ((last_dump - first) > SDE_EVTLOG_ENTRY)
-		return SDE_EVTLOG_ENTRY;
+	*size = sizeof(*hdr) + hdr->count * sizeof(*rec);
 
-	return last_dump - first;
+	return hdr;
 }
 
 struct sde_dbg_evtlog *sde_evtlog_init(void)
@@ -231,6 +313,9 @@ struct sde_dbg_evtlog *sde_evtlog_init(void)
 	if (!evtlog)
 		return ERR_PTR(-ENOMEM);
 
+	/* a power of two keeps seq % SDE_EVTLOG_ENTRY steady across u32 wrap */
+	BUILD_BUG_ON(SDE_EVTLOG_ENTRY & (SDE_EVTLOG_ENTRY - 1));
+
 	spin_lock_init(&evtlog->spin_lock);
 	atomic_set(&evtlog->curr, 0);
 	evtlog->enable = SDE_EVTLOG_DEFAULT_ENABLE;
@@ -261,6 +261,8 @@ struct hw_fence_client_queue_size_desc {
  * @dev: device driver pointer
  * @resources_ready: value set by driver at end of probe, once all resources are ready
  * @hw_fence_table_entries: total number of hw-fences in the global table
+ * @hw_fence_table_mask: hw_fence_table_entries - 1 if entries is a power of two, zero otherwise
+ * @hw_fence_max_probe: largest probe distance used so far to place a fence in the table
  * @hw_fence_mem_fences_table_size: hw-fences global table total size
  * @hw_fence_queue_entries: total number of entries that can be available in the queue
  * @hw_fence_ctrl_queue_size: size of the ctrl queue for the payload
@@ -312,6 +314,8 @@ struct hw_fence_driver_data {
 
 	/* Table & Queues info */
 	u32 hw_fence_table_entries;
+	u32 hw_fence_table_mask;
+	u32 hw_fence_max_probe;
 	u32 hw_fence_mem_fences_table_size;
 	u32 hw_fence_queue_entries;
 	/* ctrl queues */
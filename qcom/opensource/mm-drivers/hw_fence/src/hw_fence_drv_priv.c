@@ -666,8 +666,13 @@ void hw_fence_cleanup_client(struct hw_fence_driver_data *drv_data,
 	kfree(hw_fence_client);
 }
 
-static inline int _calculate_hash(u32 table_total_entries, u64 context, u64 seqno,
-	u64 step, u64 *hash)
+static inline u64 _hash_wrap(u64 val, u64 m_size, u32 mask)
+{
+	return mask ? (val & mask) : (val % m_size);
+}
+
+static inline int _calculate_hash(u32 table_total_entries, u32 table_mask, u64 context,
+	u64 seqno, u64 step, u64 *hash)
 {
 	u64 m_size = table_total_entries;
 	int val = 0;
@@ -677,19 +682,17 @@ static inline int _calculate_hash(u32 table_total_entries, u64 context, u64 seqn
 		u64 c_multiplier = HW_FENCE_HASH_C_MULT;
 		u64 b_multiplier = context + (context - 1); /* odd multiplier */
 
-		/*
-		 * if m, is power of 2, we can optimize with right shift,
-		 * for now we don't do it, to avoid assuming a power of two
-		 */
-		*hash = (a_multiplier * seqno * b_multiplier + (c_multiplier * context)) % m_size;
+		/* if m is a power of 2, the mask replaces the division */
+		*hash = _hash_wrap(a_multiplier * seqno * b_multiplier + (c_multiplier * context),
+			m_size, table_mask);
 	} else {
 		if (step >= m_size) {
 			/*
 			 * If we already traversed the whole table, return failure since this means
 			 * there are not available spots, table is either full or full-enough
 			 * that we couldn't find an available spot after traverse the whole table.
-			 * Ideally table shouldn't be so full that we cannot find a value after some
-			 * iterations, so this maximum step size could be optimized to fail earlier.
+			 * Lookups of existing fences stop earlier, at the max probe distance
+			 * used by any insertion (see _hw_fence_probe_limit).
 			 */
 			HWFNC_ERR("Fence Table tranversed and no available space!\n");
 			val = -EINVAL;
@@ -700,7 +703,7 @@ static inline int _calculate_hash(u32 table_total_entries, u64 context, u64 seqn
 			 * Also, add a mod division to wrap-around in case that we reached the
 			 * end of the table
 			 */
-			*hash = (*hash + 1) % m_size;
+			*hash = _hash_wrap(*hash + 1, m_size, table_mask);
 		}
 	}
 
@@ -830,6 +833,35 @@ static void  _fence_found(struct hw_fence_driver_data *drv_data,
 		client_id, context, seqno, hash);
 }
 
+/*
+ * Fences are never moved once reserved, since clients and firmware address them by
+ * hash, and destroy leaves no tombstone. A fence can therefore only be found within
+ * the largest probe distance used to insert any fence, which bounds every lookup of
+ * an existing fence; only an insertion may walk the whole table.
+ */
+static inline u64 _hw_fence_probe_limit(struct hw_fence_driver_data *drv_data,
+	enum hw_fence_lookup_ops op_code)
+{
+	if (op_code == HW_FENCE_LOOKUP_OP_CREATE || op_code == HW_FENCE_LOOKUP_OP_CREATE_JOIN)
+		return drv_data->hw_fence_table_entries;
+
+	return min_t(u64, (u64)READ_ONCE(drv_data->hw_fence_max_probe) + 1,
+		drv_data->hw_fence_table_entries);
+}
+
+static inline void _hw_fence_update_max_probe(struct hw_fence_driver_data *drv_data, u32 step)
+{
+	u32 old = READ_ONCE(drv_data->hw_fence_max_probe);
+
+	while (step > old) {
+		u32 prev = cmpxchg(&drv_data->hw_fence_max_probe, old, step);
+
+		if (prev == old)
+			break;
+		old = prev;
+	}
+}
+
 char *_get_op_mode(enum hw_fence_lookup_ops op_code)
 {
 	switch (op_code) {
@@ -857,6 +889,7 @@ struct msm_hw_fence *_hw_fence_lookup_and_process(struct hw_fence_driver_data *d
 			u32 client_id, u64 context, u64 seqno, u32 hash, u32 pending);
 	struct msm_hw_fence *hw_fence = NULL;
 	u64 step = 0;
+	u64 max_step;
 	int ret = 0;
 	bool hw_fence_found = false;
 
@@ -891,10 +924,12 @@ struct msm_hw_fence *_hw_fence_lookup_and_process(struct hw_fence_driver_data *d
 		return NULL;
 	}
 
-	while (!hw_fence_found && (step < drv_data->hw_fence_table_entries)) {
+	max_step = _hw_fence_probe_limit(drv_data, op_code);
+	while (!hw_fence_found && (step < max_step)) {
 
 		/* Calculate the Hash for the Fence */
-		ret = _calculate_hash(drv_data->hw_fence_table_entries, context, seqno, step, hash);
+		ret = _calculate_hash(drv_data->hw_fence_table_entries,
+			drv_data->hw_fence_table_mask, context, seqno, step, hash);
 		if (ret) {
 			HWFNC_ERR("error calculating hash ctx:%llu seqno:%llu hash:%llu\n",
 				context, seqno, *hash);
@@ -927,6 +962,10 @@ struct msm_hw_fence *_hw_fence_lookup_and_process(struct hw_fence_driver_data *d
 				wmb();
 			}
 
+			if (op_code == HW_FENCE_LOOKUP_OP_CREATE ||
+					op_code == HW_FENCE_LOOKUP_OP_CREATE_JOIN)
+				_hw_fence_update_max_probe(drv_data, step);
+
 			HWFNC_DBG_L("client_id:%lu op:%s ctx:%llu seqno:%llu hash:%llu step:%llu\n",
 				client_id, _get_op_mode(op_code), context, seqno, *hash, step);
 
@@ -954,7 +993,7 @@ struct msm_hw_fence *_hw_fence_lookup_and_process(struct hw_fence_driver_data *d
 
 	/* If we iterated through the whole list and didn't find the fence, return null */
 	if (!hw_fence_found) {
-		HWFNC_ERR("fail to create hw-fence step:%llu\n", step);
+		HWFNC_ERR("fail to %s hw-fence step:%llu\n", _get_op_mode(op_code), step);
 		hw_fence = NULL;
 	}
 
@@ -6,6 +6,7 @@
 #include <linux/of_platform.h>
 #include <linux/of_address.h>
 #include <linux/io.h>
+#include <linux/log2.h>
 #include <linux/gunyah/gh_rm_drv.h>
 #include <linux/gunyah/gh_dbl.h>
 #include <linux/qcom_scm.h>
@@ -740,6 +741,8 @@ int hw_fence_utils_parse_dt_props(struct hw_fence_driver_data *drv_data)
 	}
 	drv_data->hw_fence_mem_fences_table_size = (sizeof(struct msm_hw_fence) *
 		drv_data->hw_fence_table_entries);
+	drv_data->hw_fence_table_mask = is_power_of_2(drv_data->hw_fence_table_entries) ?
+		drv_data->hw_fence_table_entries - 1 : 0;
 
 	ret = of_property_read_u32(drv_data->dev->of_node, "qcom,hw-fence-queue-entries", &val);
 	if (ret || !val) {
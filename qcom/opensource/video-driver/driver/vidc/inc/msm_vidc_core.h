@@ -46,6 +46,21 @@ struct msm_vidc_iface_q_info {
 	struct msm_vidc_mem_addr q_array;
 };
 
+/*
+ * Command queue batching: packets written while a batch is open are copied
+ * into the cmdq but the queue header write index is published (and the
+ * doorbell raised) only once when the batch is closed.
+ */
+struct msm_vidc_cmdq_batch {
+	void                                  *owner;             /* inst owning the open batch */
+	u32                                    write_idx;         /* unpublished cmdq write index */
+	u32                                    pending;           /* packets not yet published */
+	u32                                    queued;            /* packets since last doorbell */
+	u64                                    packets;
+	u64                                    doorbells;
+	u32                                    max_per_doorbell;
+};
+
 struct msm_video_device {
 	enum msm_vidc_domain_type              type;
 	struct video_device                    vdev;
@@ -89,6 +104,7 @@ struct msm_vidc_core {
 	struct msm_vidc_mem_addr               sfr;
 	struct msm_vidc_mem_addr               iface_q_table;
 	struct msm_vidc_iface_q_info           iface_queues[VIDC_IFACEQ_NUMQ];
+	struct msm_vidc_cmdq_batch             cmdq_batch;
 	struct delayed_work                    pm_work;
 	struct workqueue_struct               *pm_workq;
 	struct workqueue_struct               *batch_workq;
@@ -494,6 +494,11 @@ struct msm_vidc_buffers *msm_vidc_get_buffers(struct msm_vidc_inst *inst,
 	enum msm_vidc_buffer_type buffer_type, const char *func);
 struct msm_vidc_mappings *msm_vidc_get_mappings(struct msm_vidc_inst *inst,
 	enum msm_vidc_buffer_type buffer_type, const char *func);
+struct msm_vidc_map *msm_vidc_find_map(struct msm_vidc_inst *inst,
+	enum msm_vidc_buffer_type buffer_type, struct dma_buf *dmabuf);
+void msm_vidc_add_map(struct msm_vidc_inst *inst,
+	struct msm_vidc_mappings *mappings, struct msm_vidc_map *map);
+void msm_vidc_del_map(struct msm_vidc_inst *inst, struct msm_vidc_map *map);
 struct msm_vidc_allocations *msm_vidc_get_allocations(
 	struct msm_vidc_inst *inst, enum msm_vidc_buffer_type buffer_type,
 	const char *func);
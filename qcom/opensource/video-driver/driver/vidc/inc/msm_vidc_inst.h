@@ -158,6 +158,8 @@ struct msm_vidc_inst {
 	struct workqueue_struct           *workq;
 	struct list_head                   enc_input_crs;
 	struct list_head                   dmabuf_tracker; /* list of struct msm_memory_dmabuf */
+	DECLARE_HASHTABLE(dmabuf_hash, MSM_VIDC_DMABUF_HASH_BITS); /* struct msm_memory_dmabuf */
+	DECLARE_HASHTABLE(map_hash, MSM_VIDC_DMABUF_HASH_BITS); /* struct msm_vidc_map */
 	struct list_head                   input_timer_list; /* list of struct msm_vidc_input_timer */
 	struct list_head                   caps_list;
 	struct list_head                   children_list; /* struct msm_vidc_inst_cap_entry */
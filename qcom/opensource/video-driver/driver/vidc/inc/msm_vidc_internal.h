@@ -8,6 +8,7 @@
 
 #include <linux/version.h>
 #include <linux/bits.h>
+#include <linux/hashtable.h>
 #include <linux/workqueue.h>
 #include <linux/spinlock.h>
 #include <linux/sync_file.h>
@@ -143,6 +144,8 @@
   * dpb payload size = 16 * 4 * 4
   */
 #define MAX_DPB_LIST_ARRAY_SIZE (16 * 4)
+/* hash buckets for per instance dmabuf tracker and mapping lookups */
+#define MSM_VIDC_DMABUF_HASH_BITS 6
 #define MAX_DPB_LIST_PAYLOAD_SIZE (16 * 4 * 4)
 
 enum msm_vidc_domain_type {
@@ -602,6 +605,10 @@ struct msm_vidc_statistics {
 	struct debug_buf_count             count;
 	u64                                data_size;
 	u64                                time_ms;
+	u64                                dmabuf_lookups;
+	u64                                dmabuf_probes;
+	u64                                map_lookups;
+	u64                                map_probes;
 };
 
 enum efuse_purpose {
@@ -880,6 +887,7 @@ struct msm_vidc_allocations {
 
 struct msm_vidc_map {
 	struct list_head            list;
+	struct hlist_node           hnode; /* inst->map_hash, keyed by dmabuf */
 	enum msm_vidc_buffer_type   type;
 	enum msm_vidc_buffer_region region;
 	struct dma_buf             *dmabuf;
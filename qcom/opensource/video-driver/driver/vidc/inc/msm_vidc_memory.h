@@ -15,6 +15,7 @@ struct msm_vidc_inst;
 
 struct msm_memory_dmabuf {
 	struct list_head       list;
+	struct hlist_node      hnode; /* inst->dmabuf_hash, keyed by dmabuf */
 	struct dma_buf        *dmabuf;
 	u32                    refcount;
 };
@@ -43,6 +43,8 @@ int venus_hfi_queue_buffer(struct msm_vidc_inst *inst,
 	struct msm_vidc_buffer *buffer, struct msm_vidc_buffer *metabuf);
 int venus_hfi_queue_super_buffer(struct msm_vidc_inst *inst,
 	struct msm_vidc_buffer *buffer, struct msm_vidc_buffer *metabuf);
+void venus_hfi_batch_begin(struct msm_vidc_inst *inst);
+int venus_hfi_batch_end(struct msm_vidc_inst *inst);
 int venus_hfi_release_buffer(struct msm_vidc_inst *inst,
 	struct msm_vidc_buffer *buffer);
 int venus_hfi_start(struct msm_vidc_inst *inst, enum msm_vidc_port_type port);
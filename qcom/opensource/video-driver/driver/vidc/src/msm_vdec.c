@@ -2092,7 +2092,7 @@ static int msm_vidc_unmap_excessive_mappings(struct msm_vidc_inst *inst)
 			if (rc)
 				return rc;
 			if (!map->refcount) {
-				list_del_init(&map->list);
+				msm_vidc_del_map(inst, map);
 				msm_vidc_memory_put_dmabuf(inst, map->dmabuf);
 				msm_memory_pool_free(inst, map);
 			}
@@ -231,6 +231,10 @@ static ssize_t core_info_read(struct file* file, char __user* buf,
 	cur += write_str(cur, end - cur,
 		"register_size: %u\n", core->dt->register_size);
 	cur += write_str(cur, end - cur, "irq: %u\n", core->dt->irq);
+	cur += write_str(cur, end - cur,
+		"cmdq packets: %llu doorbells: %llu max packets/doorbell: %u\n",
+		core->cmdq_batch.packets, core->cmdq_batch.doorbells,
+		core->cmdq_batch.max_per_doorbell);
 
 	len = simple_read_from_buffer(buf, count, ppos,
 		dbuf, cur - dbuf);
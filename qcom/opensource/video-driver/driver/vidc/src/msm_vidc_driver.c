@@ -1303,6 +1303,35 @@ struct msm_vidc_mappings *msm_vidc_get_mappings(
 	}
 }
 
+struct msm_vidc_map *msm_vidc_find_map(struct msm_vidc_inst *inst,
+	enum msm_vidc_buffer_type buffer_type, struct dma_buf *dmabuf)
+{
+	struct msm_vidc_map *map;
+
+	/* each buffer type has its own mappings list, so match type as well */
+	inst->stats.map_lookups++;
+	hash_for_each_possible(inst->map_hash, map, hnode, (unsigned long)dmabuf) {
+		inst->stats.map_probes++;
+		if (map->dmabuf == dmabuf && map->type == buffer_type)
+			return map;
+	}
+
+	return NULL;
+}
+
+void msm_vidc_add_map(struct msm_vidc_inst *inst,
+	struct msm_vidc_mappings *mappings, struct msm_vidc_map *map)
+{
+	list_add_tail(&map->list, &mappings->list);
+	hash_add(inst->map_hash, &map->hnode, (unsigned long)map->dmabuf);
+}
+
+void msm_vidc_del_map(struct msm_vidc_inst *inst, struct msm_vidc_map *map)
+{
+	list_del_init(&map->list);
+	hash_del(&map->hnode);
+}
+
 struct msm_vidc_allocations *msm_vidc_get_allocations(
 	struct msm_vidc_inst *inst, enum msm_vidc_buffer_type buffer_type,
 	const char *func)
@@ -2685,7 +2714,7 @@ int msm_vidc_memory_unmap_completely(struct msm_vidc_inst *inst,
 			break;
 		if (!map->refcount) {
 			msm_vidc_memory_put_dmabuf(inst, map->dmabuf);
-			list_del(&map->list);
+			msm_vidc_del_map(inst, map);
 			msm_memory_pool_free(inst, map);
 			break;
 		}
@@ -3193,7 +3222,6 @@ int msm_vidc_unmap_driver_buf(struct msm_vidc_inst *inst,
 	int rc = 0;
 	struct msm_vidc_mappings *mappings;
 	struct msm_vidc_map *map = NULL;
-	bool found = false;
 
 	if (!inst || !buf) {
 		d_vpr_e("%s: invalid params\n", __func__);
@@ -3205,13 +3233,8 @@ int msm_vidc_unmap_driver_buf(struct msm_vidc_inst *inst,
 		return -EINVAL;
 
 	/* sanity check to see if it was not removed */
-	list_for_each_entry(map, &mappings->list, list) {
-		if (map->dmabuf == buf->dmabuf) {
-			found = true;
-			break;
-		}
-	}
-	if (!found) {
+	map = msm_vidc_find_map(inst, buf->type, buf->dmabuf);
+	if (!map) {
 		print_vidc_buffer(VIDC_ERR, "err ", "no buf in mappings", inst, buf);
 		return -EINVAL;
 	}
@@ -3225,7 +3248,7 @@ int msm_vidc_unmap_driver_buf(struct msm_vidc_inst *inst,
 	/* finally delete if refcount is zero */
 	if (!map->refcount) {
 		msm_vidc_memory_put_dmabuf(inst, map->dmabuf);
-		list_del(&map->list);
+		msm_vidc_del_map(inst, map);
 		msm_memory_pool_free(inst, map);
 	}
 
@@ -3253,12 +3276,8 @@ int msm_vidc_map_driver_buf(struct msm_vidc_inst *inst,
 	 * new buffer: map twice for delayed unmap feature sake
 	 * existing buffer: map once
 	 */
-	list_for_each_entry(map, &mappings->list, list) {
-		if (map->dmabuf == buf->dmabuf) {
-			found = true;
-			break;
-		}
-	}
+	map = msm_vidc_find_map(inst, buf->type, buf->dmabuf);
+	found = !!map;
 	if (!found) {
 		/* new buffer case */
 		map = msm_memory_pool_alloc(inst, MSM_MEM_POOL_MAP);
@@ -3267,13 +3286,13 @@ int msm_vidc_map_driver_buf(struct msm_vidc_inst *inst,
 			return -ENOMEM;
 		}
 		INIT_LIST_HEAD(&map->list);
-		list_add_tail(&map->list, &mappings->list);
 		map->type = buf->type;
 		map->dmabuf = msm_vidc_memory_get_dmabuf(inst, buf->fd);
 		if (!map->dmabuf) {
 			rc = -EINVAL;
 			goto error;
 		}
+		msm_vidc_add_map(inst, mappings, map);
 		map->region = msm_vidc_get_buffer_region(inst, buf->type, __func__);
 		/* delayed unmap feature needed for decoder output buffers */
 		if (is_decode_session(inst) && is_output_buffer(buf->type)) {
@@ -3293,8 +3312,9 @@ error:
 	if (!found) {
 		if (is_decode_session(inst) && is_output_buffer(buf->type))
 			msm_vidc_put_delayed_unmap(inst, map);
-		msm_vidc_memory_put_dmabuf(inst, map->dmabuf);
-		list_del_init(&map->list);
+		if (map->dmabuf)
+			msm_vidc_memory_put_dmabuf(inst, map->dmabuf);
+		msm_vidc_del_map(inst, map);
 		msm_memory_pool_free(inst, map);
 	}
 	return rc;
@@ -3675,10 +3695,18 @@ void msm_vidc_print_stats(struct msm_vidc_inst *inst)
 		etb, ebd, ftb, fbd, inst->debug_count.etb, inst->debug_count.ebd,
 		inst->debug_count.ftb, inst->debug_count.fbd,
 		bitrate_kbps, achieved_fps, frame_rate, operating_rate, priority, dt_ms);
+	i_vpr_hs(inst,
+		"stats: lookups (dmabuf,map): %llu %llu, probes (dmabuf,map): %llu %llu\n",
+		inst->stats.dmabuf_lookups, inst->stats.map_lookups,
+		inst->stats.dmabuf_probes, inst->stats.map_probes);
 
 	inst->stats.count = inst->debug_count;
 	inst->stats.data_size = 0;
 	inst->stats.time_ms = time_ms;
+	inst->stats.dmabuf_lookups = 0;
+	inst->stats.dmabuf_probes = 0;
+	inst->stats.map_lookups = 0;
+	inst->stats.map_probes = 0;
 }
 
 int schedule_stats_work(struct msm_vidc_inst *inst)
@@ -3922,15 +3950,21 @@ int msm_vidc_queue_deferred_buffers(struct msm_vidc_inst *inst, enum msm_vidc_bu
 
 	msm_vidc_scale_power(inst, true);
 
+	/* ring the doorbell once for the whole burst of deferred buffers */
+	venus_hfi_batch_begin(inst);
 	list_for_each_entry(buf, &buffers->list, list) {
 		if (!(buf->attr & MSM_VIDC_ATTR_DEFERRED))
 			continue;
 		rc = msm_vidc_queue_buffer(inst, buf);
 		if (rc)
-			return rc;
+			break;
+	}
+	if (rc) {
+		venus_hfi_batch_end(inst);
+		return rc;
 	}
 
-	return 0;
+	return venus_hfi_batch_end(inst);
 }
 
 int msm_vidc_queue_buffer_single(struct msm_vidc_inst *inst, struct vb2_buffer *vb2)
@@ -3991,7 +4025,7 @@ int msm_vidc_destroy_internal_buffer(struct msm_vidc_inst *inst,
 	struct msm_vidc_allocations *allocations;
 	struct msm_vidc_mappings *mappings;
 	struct msm_vidc_alloc *alloc, *alloc_dummy;
-	struct msm_vidc_map  *map, *map_dummy;
+	struct msm_vidc_map  *map;
 	struct msm_vidc_buffer *buf, *dummy;
 
 	if (!inst || !inst->core) {
@@ -4018,13 +4052,11 @@ int msm_vidc_destroy_internal_buffer(struct msm_vidc_inst *inst,
 	if (!mappings)
 		return -EINVAL;
 
-	list_for_each_entry_safe(map, map_dummy, &mappings->list, list) {
-		if (map->dmabuf == buffer->dmabuf) {
-			msm_vidc_memory_unmap(inst->core, map);
-			list_del(&map->list);
-			msm_memory_pool_free(inst, map);
-			break;
-		}
+	map = msm_vidc_find_map(inst, buffer->type, buffer->dmabuf);
+	if (map) {
+		msm_vidc_memory_unmap(inst->core, map);
+		msm_vidc_del_map(inst, map);
+		msm_memory_pool_free(inst, map);
 	}
 
 	list_for_each_entry_safe(alloc, alloc_dummy, &allocations->list, list) {
@@ -4163,7 +4195,7 @@ int msm_vidc_create_internal_buffer(struct msm_vidc_inst *inst,
 	rc = msm_vidc_memory_map(inst->core, map);
 	if (rc)
 		return -ENOMEM;
-	list_add_tail(&map->list, &mappings->list);
+	msm_vidc_add_map(inst, mappings, map);
 
 	buffer->dmabuf = alloc->dmabuf;
 	buffer->device_addr = map->device_addr;
@@ -4239,6 +4271,7 @@ int msm_vidc_queue_internal_buffers(struct msm_vidc_inst *inst,
 		return 0;
 	}
 
+	venus_hfi_batch_begin(inst);
 	list_for_each_entry_safe(buffer, dummy, &buffers->list, list) {
 		/* do not queue pending release buffers */
 		if (buffer->flags & MSM_VIDC_ATTR_PENDING_RELEASE)
@@ -4248,15 +4281,19 @@ int msm_vidc_queue_internal_buffers(struct msm_vidc_inst *inst,
 			continue;
 		rc = venus_hfi_queue_buffer(inst, buffer, NULL);
 		if (rc)
-			return rc;
+			break;
 		/* mark queued */
 		buffer->attr |= MSM_VIDC_ATTR_QUEUED;
 
 		i_vpr_h(inst, "%s: queue: type: %8s, size: %9u, device_addr %#x\n", __func__,
 			buf_name(buffer->type), buffer->buffer_size, buffer->device_addr);
 	}
+	if (rc) {
+		venus_hfi_batch_end(inst);
+		return rc;
+	}
 
-	return 0;
+	return venus_hfi_batch_end(inst);
 }
 
 int msm_vidc_alloc_and_queue_session_internal_buffers(struct msm_vidc_inst *inst,
@@ -63,11 +63,25 @@ exit:
 	return NULL;
 }
 
+static struct msm_memory_dmabuf *msm_vidc_memory_find_dmabuf(
+	struct msm_vidc_inst *inst, struct dma_buf *dmabuf)
+{
+	struct msm_memory_dmabuf *buf;
+
+	inst->stats.dmabuf_lookups++;
+	hash_for_each_possible(inst->dmabuf_hash, buf, hnode, (unsigned long)dmabuf) {
+		inst->stats.dmabuf_probes++;
+		if (buf->dmabuf == dmabuf)
+			return buf;
+	}
+
+	return NULL;
+}
+
 struct dma_buf *msm_vidc_memory_get_dmabuf(struct msm_vidc_inst *inst, int fd)
 {
 	struct msm_memory_dmabuf *buf = NULL;
 	struct dma_buf *dmabuf = NULL;
-	bool found = false;
 
 	if (!inst) {
 		d_vpr_e("%s: invalid params\n", __func__);
@@ -83,14 +97,9 @@ struct dma_buf *msm_vidc_memory_get_dmabuf(struct msm_vidc_inst *inst, int fd)
 	}
 
 	/* track dmabuf - inc refcount if already present */
-	list_for_each_entry(buf, &inst->dmabuf_tracker, list) {
-		if (buf->dmabuf == dmabuf) {
-			buf->refcount++;
-			found = true;
-			break;
-		}
-	}
-	if (found) {
+	buf = msm_vidc_memory_find_dmabuf(inst, dmabuf);
+	if (buf) {
+		buf->refcount++;
 		/* put local dmabuf ref */
 		dma_buf_put(dmabuf);
 		return dmabuf;
@@ -110,6 +119,7 @@ struct dma_buf *msm_vidc_memory_get_dmabuf(struct msm_vidc_inst *inst, int fd)
 
 	/* add new dmabuf entry to tracker */
 	list_add_tail(&buf->list, &inst->dmabuf_tracker);
+	hash_add(inst->dmabuf_hash, &buf->hnode, (unsigned long)dmabuf);
 
 	return dmabuf;
 }
@@ -117,7 +127,6 @@ struct dma_buf *msm_vidc_memory_get_dmabuf(struct msm_vidc_inst *inst, int fd)
 void msm_vidc_memory_put_dmabuf(struct msm_vidc_inst *inst, struct dma_buf *dmabuf)
 {
 	struct msm_memory_dmabuf *buf = NULL;
-	bool found = false;
 
 	if (!inst || !dmabuf) {
 		d_vpr_e("%s: invalid params\n", __func__);
@@ -125,17 +134,12 @@ void msm_vidc_memory_put_dmabuf(struct msm_vidc_inst *inst, struct dma_buf *dmab
 	}
 
 	/* track dmabuf - dec refcount if already present */
-	list_for_each_entry(buf, &inst->dmabuf_tracker, list) {
-		if (buf->dmabuf == dmabuf) {
-			buf->refcount--;
-			found = true;
-			break;
-		}
-	}
-	if (!found) {
+	buf = msm_vidc_memory_find_dmabuf(inst, dmabuf);
+	if (!buf) {
 		i_vpr_e(inst, "%s: invalid dmabuf %#x\n", __func__, dmabuf);
 		return;
 	}
+	buf->refcount--;
 
 	/* non-zero refcount - do nothing */
 	if (buf->refcount)
@@ -143,6 +147,7 @@ void msm_vidc_memory_put_dmabuf(struct msm_vidc_inst *inst, struct dma_buf *dmab
 
 	/* remove dmabuf entry from tracker */
 	list_del(&buf->list);
+	hash_del(&buf->hnode);
 
 	/* release dmabuf strong ref from tracker */
 	dma_buf_put(buf->dmabuf);
@@ -164,6 +169,7 @@ void msm_vidc_memory_put_dmabuf_completely(struct msm_vidc_inst *inst,
 		if (!buf->refcount) {
 			/* remove dmabuf entry from tracker */
 			list_del(&buf->list);
+			hash_del(&buf->hnode);
 
 			/* release dmabuf strong ref from tracker */
 			dma_buf_put(buf->dmabuf);
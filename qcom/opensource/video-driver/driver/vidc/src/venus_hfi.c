@@ -734,8 +734,13 @@ int __scale_clocks(struct msm_vidc_core *core)
 	return 0;
 }
 
+/*
+ * When deferred_idx is set, the packet is copied at *deferred_idx and the
+ * advanced index is returned there without publishing it in the queue
+ * header; the caller publishes it later via __cmdq_batch_publish().
+ */
 static int __write_queue(struct msm_vidc_iface_q_info *qinfo, u8 *packet,
-		bool *rx_req_is_set)
+		bool *rx_req_is_set, u32 *deferred_idx)
 {
 	struct hfi_queue_header *queue;
 	u32 packet_size_in_words, new_write_idx;
@@ -773,7 +778,7 @@ static int __write_queue(struct msm_vidc_iface_q_info *qinfo, u8 *packet,
 	}
 
 	read_idx = queue->qhdr_read_idx;
-	write_idx = queue->qhdr_write_idx;
+	write_idx = deferred_idx ? *deferred_idx : queue->qhdr_write_idx;
 
 	empty_space = (write_idx >=  read_idx) ?
 		((qinfo->q_array.mem_size>>2) - (write_idx -  read_idx)) :
@@ -808,6 +813,11 @@ static int __write_queue(struct msm_vidc_iface_q_info *qinfo, u8 *packet,
 			new_write_idx  << 2);
 	}
 
+	if (deferred_idx) {
+		*deferred_idx = new_write_idx;
+		return 0;
+	}
+
 	/*
 	 * Memory barrier to make sure packet is written before updating the
 	 * write index
@@ -942,10 +952,56 @@ static int __read_queue(struct msm_vidc_iface_q_info *qinfo, u8 *packet,
 	return rc;
 }
 
-/* Writes into cmdq without raising an interrupt */
+/* Publishes the cmdq write index of packets deferred by an open batch */
+static void __cmdq_batch_publish(struct msm_vidc_core *core,
+		bool *requires_interrupt)
+{
+	struct msm_vidc_cmdq_batch *batch = &core->cmdq_batch;
+	struct msm_vidc_iface_q_info *q_info;
+	struct hfi_queue_header *queue;
+
+	if (!batch->pending)
+		return;
+	batch->pending = 0;
+
+	q_info = &core->iface_queues[VIDC_IFACEQ_CMDQ_IDX];
+	queue = (struct hfi_queue_header *)q_info->q_hdr;
+	if (!queue || !q_info->q_array.align_virtual_addr)
+		return;
+
+	/*
+	 * Memory barrier to make sure all batched packets are written before
+	 * updating the write index, and the write index is updated before an
+	 * interrupt is raised on venus.
+	 */
+	mb();
+	queue->qhdr_write_idx = batch->write_idx;
+	mb();
+	if (requires_interrupt)
+		*requires_interrupt = true;
+}
+
+static void __cmdq_raise_interrupt(struct msm_vidc_core *core)
+{
+	struct msm_vidc_cmdq_batch *batch = &core->cmdq_batch;
+
+	call_venus_op(core, raise_interrupt, core);
+
+	batch->doorbells++;
+	if (batch->queued > batch->max_per_doorbell)
+		batch->max_per_doorbell = batch->queued;
+	batch->queued = 0;
+}
+
+/*
+ * Writes into cmdq without raising an interrupt. Packets of a batched write
+ * are not made visible to firmware until the batch is published, any other
+ * write publishes the open batch first so that ordering is preserved.
+ */
 static int __iface_cmdq_write_relaxed(struct msm_vidc_core *core,
-		void *pkt, bool *requires_interrupt)
+		void *pkt, bool *requires_interrupt, bool batched)
 {
+	struct msm_vidc_cmdq_batch *batch;
 	struct msm_vidc_iface_q_info *q_info;
 	//struct vidc_hal_cmd_pkt_hdr *cmd_packet;
 	int rc = -E2BIG;
@@ -987,7 +1043,19 @@ static int __iface_cmdq_write_relaxed(struct msm_vidc_core *core,
 		goto err_q_write;
 	}
 
-	if (!__write_queue(q_info, (u8 *)pkt, requires_interrupt)) {
+	batch = &core->cmdq_batch;
+	if (!batched)
+		__cmdq_batch_publish(core, requires_interrupt);
+	else if (!batch->pending)
+		batch->write_idx =
+			((struct hfi_queue_header *)q_info->q_hdr)->qhdr_write_idx;
+
+	if (!__write_queue(q_info, (u8 *)pkt, requires_interrupt,
+			batched ? &batch->write_idx : NULL)) {
+		if (batched)
+			batch->pending++;
+		batch->queued++;
+		batch->packets++;
 		__schedule_power_collapse_work(core);
 		rc = 0;
 	} else {
@@ -1003,10 +1071,10 @@ int __iface_cmdq_write(struct msm_vidc_core *core,
 	void *pkt)
 {
 	bool needs_interrupt = false;
-	int rc = __iface_cmdq_write_relaxed(core, pkt, &needs_interrupt);
+	int rc = __iface_cmdq_write_relaxed(core, pkt, &needs_interrupt, false);
 
 	if (!rc && needs_interrupt)
-		call_venus_op(core, raise_interrupt, core);
+		__cmdq_raise_interrupt(core);
 
 	return rc;
 }
@@ -1015,10 +1083,27 @@ static int __iface_cmdq_write_intr(struct msm_vidc_core *core,
 	void *pkt, bool allow)
 {
 	bool needs_interrupt = false;
-	int rc = __iface_cmdq_write_relaxed(core, pkt, &needs_interrupt);
+	int rc = __iface_cmdq_write_relaxed(core, pkt, &needs_interrupt, false);
 
 	if (!rc && allow && needs_interrupt)
-		call_venus_op(core, raise_interrupt, core);
+		__cmdq_raise_interrupt(core);
+
+	return rc;
+}
+
+/* Defers the doorbell while @inst owns the cmdq batch */
+static int __iface_cmdq_write_batched(struct msm_vidc_inst *inst, void *pkt)
+{
+	struct msm_vidc_core *core = inst->core;
+	bool needs_interrupt = false;
+	int rc;
+
+	if (core->cmdq_batch.owner != inst)
+		return __iface_cmdq_write(core, pkt);
+
+	rc = __iface_cmdq_write_relaxed(core, pkt, &needs_interrupt, true);
+	if (!rc && needs_interrupt)
+		__cmdq_raise_interrupt(core);
 
 	return rc;
 }
@@ -1257,6 +1342,14 @@ static int __power_collapse(struct msm_vidc_core *core, bool force)
 
 	__flush_debug_queue(core, (!force ? core->packet : NULL), core->packet_size);
 
+	if (core->cmdq_batch.pending) {
+		bool needs_interrupt = false;
+
+		__cmdq_batch_publish(core, &needs_interrupt);
+		if (needs_interrupt)
+			__cmdq_raise_interrupt(core);
+	}
+
 	rc = call_venus_op(core, prepare_pc, core);
 	if (rc)
 		goto skip_power_off;
@@ -2252,6 +2345,9 @@ static int venus_hfi_reset_queue_header(struct msm_vidc_core *core)
 		iface_q = &core->iface_queues[i];
 		__set_queue_hdr_defaults(iface_q->q_hdr);
 	}
+	core->cmdq_batch.owner = NULL;
+	core->cmdq_batch.pending = 0;
+	core->cmdq_batch.queued = 0;
 
 	iface_q = &core->iface_queues[VIDC_IFACEQ_CMDQ_IDX];
 	q_hdr = iface_q->q_hdr;
@@ -3783,7 +3879,7 @@ int venus_hfi_queue_buffer(struct msm_vidc_inst *inst,
 	if (rc)
 		goto unlock;
 
-	rc = __iface_cmdq_write(inst->core, inst->packet);
+	rc = __iface_cmdq_write_batched(inst, inst->packet);
 	if (rc)
 		goto unlock;
 
@@ -3792,6 +3888,70 @@ unlock:
 	return rc;
 }
 
+/*
+ * Opens a cmdq batch for @inst: buffer packets queued by this instance are
+ * written to the cmdq but published to firmware with a single write index
+ * update and doorbell from venus_hfi_batch_end(). Only one instance can
+ * own the batch at a time, others keep writing unbatched.
+ */
+void venus_hfi_batch_begin(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_core *core;
+
+	if (!inst || !inst->core) {
+		d_vpr_e("%s: invalid params\n", __func__);
+		return;
+	}
+	core = inst->core;
+
+	core_lock(core, __func__);
+	if (!core->cmdq_batch.owner)
+		core->cmdq_batch.owner = inst;
+	core_unlock(core, __func__);
+}
+
+int venus_hfi_batch_end(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_core *core;
+	bool needs_interrupt = false;
+	int rc = 0;
+
+	if (!inst || !inst->core) {
+		d_vpr_e("%s: invalid params\n", __func__);
+		return -EINVAL;
+	}
+	core = inst->core;
+
+	core_lock(core, __func__);
+	if (core->cmdq_batch.owner != inst)
+		goto unlock;
+	core->cmdq_batch.owner = NULL;
+
+	if (!core->cmdq_batch.pending)
+		goto unlock;
+
+	if (!__core_in_valid_state(core)) {
+		d_vpr_e("%s: fw not in init state\n", __func__);
+		core->cmdq_batch.pending = 0;
+		rc = -EINVAL;
+		goto unlock;
+	}
+
+	rc = __resume(core);
+	if (rc) {
+		d_vpr_e("%s: Power on failed\n", __func__);
+		goto unlock;
+	}
+
+	__cmdq_batch_publish(core, &needs_interrupt);
+	if (needs_interrupt)
+		__cmdq_raise_interrupt(core);
+
+unlock:
+	core_unlock(core, __func__);
+	return rc;
+}
+
 int venus_hfi_release_buffer(struct msm_vidc_inst *inst,
 	struct msm_vidc_buffer *buffer)
 {